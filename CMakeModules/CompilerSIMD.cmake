@@ -105,6 +105,41 @@ __m128 Y = _mm_movehdup_ps(X);
 SET(CMAKE_REQUIRED_FLAGS "")
 ENDMACRO(CHECK_SSE3)
 
+MACRO(CHECK_AVX2)
+IF(CMAKE_COMPILER_IS_GNUCC)
+  SET(AVX2_FLAGS "-mmmx -msse -msse2 -msse3 -mavx -mavx2 -mfma")
+  SET(AVX_FLAGS "-mmmx -msse -msse2 -msse3 -mavx")
+ENDIF(CMAKE_COMPILER_IS_GNUCC)
+
+SET(CMAKE_REQUIRED_FLAGS "${AVX2_FLAGS}")
+CHECK_C_SOURCE_COMPILES(
+"#include <immintrin.h>
+int main() {
+__m256 X = _mm256_setzero_ps();
+__m256 Y = _mm256_fmadd_ps(X, X, X);
+__m256i Z = _mm256_permutevar8x32_epi32(_mm256_castps_si256(Y), _mm256_setzero_si256());
+}
+" HAVE_AVX2)
+SET(CMAKE_REQUIRED_FLAGS "")
+ENDMACRO(CHECK_AVX2)
+
+MACRO(CHECK_AVX512BW)
+IF(CMAKE_COMPILER_IS_GNUCC)
+  SET(AVX512BW_FLAGS "-mavx512f -mavx512bw")
+ENDIF(CMAKE_COMPILER_IS_GNUCC)
+
+SET(CMAKE_REQUIRED_FLAGS "${AVX2_FLAGS} ${AVX512BW_FLAGS}")
+CHECK_C_SOURCE_COMPILES(
+"#include <immintrin.h>
+int main() {
+__m512i X = _mm512_setzero_si512();
+__m512i Y = _mm512_maskz_loadu_epi8(1, &X);
+__m512i Z = _mm512_min_epu8(X, Y);
+}
+" HAVE_AVX512BW)
+SET(CMAKE_REQUIRED_FLAGS "")
+ENDMACRO(CHECK_AVX512BW)
+
 MACRO(CHECK_ALTIVEC)
 IF(CMAKE_COMPILER_IS_GNUCC)
   SET(ALTIVEC_FLAGS "-maltivec")
@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <limits.h>
 
 #ifdef _WIN32
 #include <io.h>
@@ -70,6 +71,14 @@ print_simd_in_use(FILE *out, AftenSimdInstructions *simd_instructions)
         fprintf(out, " SSE3");
     if (simd_instructions->ssse3)
         fprintf(out, " SSSE3");
+    if (simd_instructions->avx)
+        fprintf(out, " AVX");
+    if (simd_instructions->avx2)
+        fprintf(out, " AVX2");
+    if (simd_instructions->fma)
+        fprintf(out, " FMA");
+    if (simd_instructions->avx512bw)
+        fprintf(out, " AVX512BW");
     if (simd_instructions->amd_3dnow)
         fprintf(out, " 3DNOW");
     if (simd_instructions->amd_3dnowext)
@@ -81,6 +90,96 @@ print_simd_in_use(FILE *out, AftenSimdInstructions *simd_instructions)
     fprintf(out, "\n");
 }
 
+/**
+ * Reads all of the input and encodes it in one go with aften_encode_buffer,
+ * which lets the threads work on independent parts of the stream.  If
+ * seg_start is not negative, only the segment starting at that frame is
+ * encoded.
+ */
+static int
+encode_whole_file(AftenContext *s, PcmContext *pf, FILE *ofp,
+                  void (*aften_remap)(void *samples, int n, int ch,
+                                      A52SampleFormat fmt, int acmod),
+                  int seg_start, int seg_frames)
+{
+    FLOAT *wav = NULL;
+    FLOAT *tmp;
+    uint8_t *output;
+    int n_samples = 0;
+    int max_samples = 0;
+    int nr, size, n_frames;
+    FLOAT kbps;
+
+    // start with the size from the header, if there is one
+    if (pf->samples > 0 && pf->samples < INT_MAX / 2)
+        max_samples = (int)pf->samples;
+
+    do {
+        FLOAT *dst;
+        if (n_samples + A52_SAMPLES_PER_FRAME > max_samples || wav == NULL) {
+            max_samples = MAX(max_samples, n_samples * 2) + A52_SAMPLES_PER_FRAME;
+            tmp = realloc(wav, (size_t)max_samples * s->channels * sizeof(FLOAT));
+            if (tmp == NULL) {
+                fprintf(stderr, "error allocating memory for input audio\n");
+                free(wav);
+                return -1;
+            }
+            wav = tmp;
+        }
+        dst = wav + (size_t)n_samples * s->channels;
+        nr = pcm_read_samples(pf, dst, A52_SAMPLES_PER_FRAME);
+        if (aften_remap)
+            aften_remap(dst, nr, s->channels, s->sample_format, s->acmod);
+        n_samples += nr;
+    } while (nr > 0);
+
+    n_frames = (n_samples + 256 + A52_SAMPLES_PER_FRAME - 1) / A52_SAMPLES_PER_FRAME;
+    if (seg_start >= 0)
+        n_frames = seg_frames ? seg_frames : n_frames - seg_start;
+    if (n_frames <= 0 || n_frames > INT_MAX / A52_SAMPLES_PER_FRAME ||
+            seg_start > INT_MAX / A52_SAMPLES_PER_FRAME) {
+        fprintf(stderr, "invalid segment\n");
+        free(wav);
+        return -1;
+    }
+    // room for n_frames frames of the largest size
+    size = aften_encode_buffer_bound(s, n_frames * A52_SAMPLES_PER_FRAME - 256);
+    output = size < 0 ? NULL : malloc(size);
+    if (output == NULL) {
+        fprintf(stderr, "error allocating memory for output stream\n");
+        free(wav);
+        return -1;
+    }
+
+    if (seg_start >= 0) {
+        // skip the input before the pre-roll
+        int n_preroll = MIN(seg_start, A52_PREROLL_FRAMES);
+        int skip = MIN((seg_start - n_preroll) * A52_SAMPLES_PER_FRAME, n_samples);
+        size = aften_encode_segment(s, output, size,
+                                    wav + (size_t)skip * s->channels,
+                                    n_samples - skip, n_preroll, seg_start,
+                                    seg_frames);
+    } else {
+        size = aften_encode_buffer(s, output, size, wav, n_samples);
+    }
+    free(wav);
+    if (size < 0) {
+        fprintf(stderr, "Error encoding input\n");
+        free(output);
+        return -1;
+    }
+    fwrite(output, 1, size, ofp);
+    free(output);
+
+    if (s->verbose > 0) {
+        kbps = (size * FCONST(8.0) * pf->sample_rate) /
+               (FCONST(1000.0) * n_frames * A52_SAMPLES_PER_FRAME);
+        fprintf(stderr, "average bitrate:   %4.1f kbps\n\n", kbps);
+    }
+
+    return 0;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -95,7 +194,7 @@ main(int argc, char **argv)
     CommandOptions opts;
     AftenContext s;
     uint32_t samplecount, bytecount, t0, t1, percent;
-    FLOAT kbps, qual, bw;
+    FLOAT kbps, qual, bw, exps, snr_iter, snr_hits;
     int frame_cnt;
     int input_file_format;
     enum PcmSampleFormat read_format;
@@ -259,7 +358,7 @@ main(int argc, char **argv)
         goto error_end;
 
     samplecount = bytecount = t0 = t1 = percent = 0;
-    qual = bw = 0.0;
+    qual = bw = exps = snr_iter = snr_hits = 0.0;
     frame_cnt = 0;
     fs = 0;
     nr = 0;
@@ -294,6 +393,13 @@ main(int argc, char **argv)
     // print number of threads used
     fprintf(stderr, "Threads: %i\n\n", s.system.n_threads);
 
+    if (opts.whole_file || opts.seg_start >= 0) {
+        if (encode_whole_file(&s, &pf, ofp, aften_remap, opts.seg_start,
+                              opts.seg_frames))
+            goto error_end;
+        goto end;
+    }
+
     do {
         nr = pcm_read_samples(&pf, fwav, A52_SAMPLES_PER_FRAME);
         if (aften_remap)
@@ -310,6 +416,9 @@ main(int argc, char **argv)
                 bytecount += fs;
                 qual += s.status.quality;
                 bw += s.status.bwcode;
+                exps += s.status.expstr_search_avg;
+                snr_iter += s.status.snr_iterations;
+                snr_hits += s.status.snr_cache_hits;
                 if (s.verbose == 1) {
                     current_clock = clock();
                     if (current_clock - last_update_clock >= update_clock_span) {
@@ -356,6 +465,10 @@ main(int argc, char **argv)
             fprintf(stderr, "\n");
             fprintf(stderr, "average quality:   %4.1f\n", (qual / frame_cnt));
             fprintf(stderr, "average bandwidth: %2.1f\n", (bw / frame_cnt));
+            if (s.params.expstr_search_avg)
+                fprintf(stderr, "average exps size: %4.1f\n", (exps / frame_cnt));
+            fprintf(stderr, "average snr iters: %4.1f (%.1f cached)\n",
+                    (snr_iter / frame_cnt), (snr_hits / frame_cnt));
             fprintf(stderr, "average bitrate:   %4.1f kbps\n\n", kbps);
         }
     }
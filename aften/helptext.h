@@ -27,7 +27,7 @@
 
 static const char *usage_heading = "usage: aften [options] <input.wav> <output.ac3>\n";
 
-#define HELP_OPTIONS_COUNT 43
+#define HELP_OPTIONS_COUNT 49
 
 static const char *help_options[HELP_OPTIONS_COUNT] = {
 "    [-h]           Print out list of commandline options\n",
@@ -44,8 +44,22 @@ static const char *help_options[HELP_OPTIONS_COUNT] = {
 "    [-threads #]   Number of parallel threads to use\n"
 "                       0 = detect number of CPUs (default)\n",
 
+"    [-threadmode #] Threading mode\n"
+"                       0 = encode several frames at once (default)\n"
+"                       1 = encode the channels of one frame at once\n"
+"                       2 = encode each stage of a frame on its own thread\n",
+
+"    [-wholefile #] Encode the whole input at once\n"
+"                       0 = encode frame by frame (default)\n"
+"                       1 = read all input, then encode it in parallel chunks\n",
+
+"    [-segstart #]  Only encode the segment starting at this frame\n",
+
+"    [-segframes #] Number of frames in the segment (default: up to the end)\n",
+
 "    [-nosimd X]    Comma-separated list of SIMD instruction sets not to use\n"
-"                       Available sets are mmx, sse, sse2, sse3 and altivec.\n"
+"                       Available sets are mmx, sse, sse2, sse3, avx, avx2,\n"
+"                       fma, avx512bw and altivec.\n"
 "                       No spaces are allowed between the sets and the commas.\n",
 
 "    [-b #]         CBR bitrate in kbps (default: about 96kbps per channel)\n",
@@ -59,6 +73,9 @@ static const char *help_options[HELP_OPTIONS_COUNT] = {
 "    [-exps #]      Exponent strategy search size (default: 8)\n"
 "                       1 to 32 (lower is faster, higher is better quality)\n",
 
+"    [-expsavg #]   Adaptive exponent strategy search (default: 0)\n"
+"                       0 = off, 1 to 32 = average search size per channel\n",
+
 "    [-pad #]       Start-of-stream padding\n"
 "                       0 = no padding\n"
 "                       1 = 256 samples of padding (default)\n",
@@ -72,6 +89,8 @@ static const char *help_options[HELP_OPTIONS_COUNT] = {
 
 "    [-wmax #]      Maximum bandwidth [0 - 60] (default: 60)\n",
 
+"    [-lookahead #] Lookahead for -w -2 only [0 - 32] (default: 0)\n",
+
 "    [-m #]         Stereo rematrixing\n"
 "                       0 = independent L+R channels\n"
 "                       1 = mid/side rematrixing (default)\n",
@@ -233,7 +252,7 @@ static const char *console_options[CONSOLE_OPTIONS_COUNT] = {
 "                       2 - Shows the statistics for each frame.\n"
 };
 
-#define ENCODING_OPTIONS_COUNT 12
+#define ENCODING_OPTIONS_COUNT 18
 
 static const char encoding_heading[18] = "ENCODING OPTIONS\n";
 static const char *encoding_options[ENCODING_OPTIONS_COUNT] = {
@@ -244,11 +263,53 @@ static const char *encoding_options[ENCODING_OPTIONS_COUNT] = {
 "                       value of 0 is the default and indicates that Aften\n"
 "                       should try to detect the number of CPUs.\n",
 
+"    [-threadmode #] Threading mode\n"
+"                       0 = Frame mode (default). Several consecutive frames\n"
+"                           are encoded at the same time. This scales with the\n"
+"                           number of threads, but holds back 2 frames of\n"
+"                           output per thread.\n"
+"                       1 = Channel mode. Only one frame is encoded at a time\n"
+"                           and its channels are spread over the threads. This\n"
+"                           adds no latency, which is useful for live streams,\n"
+"                           but uses at most one thread per channel.\n"
+"                       2 = Pipeline mode. Analysis, bit allocation and\n"
+"                           bitstream packing run on separate threads, each on\n"
+"                           a different frame. This holds back 3 frames of\n"
+"                           output and uses at most 3 threads.\n",
+
+"    [-wholefile #] Encode the whole input at once\n"
+"                       0 = Frame by frame (default). The input is read and\n"
+"                           encoded one frame at a time.\n"
+"                       1 = The complete input is read into memory first and\n"
+"                           then cut into chunks, which the threads encode\n"
+"                           independently. This scales better with many\n"
+"                           threads, but needs memory for all of the input\n"
+"                           and output. Each chunk starts from the input\n"
+"                           filters warmed up on the second of audio before\n"
+"                           it, so with -dcfilter, -bwfilter or -lfefilter\n"
+"                           the output can differ slightly from frame by\n"
+"                           frame encoding.\n",
+
+"    [-segstart #]  First frame of a segment to encode\n"
+"                       Only the frames of one segment of the input are\n"
+"                       output, so a long input can be encoded in parts, e.g.\n"
+"                       on several machines, and the parts joined afterwards.\n"
+"                       Frame n starts at input sample n * 1536 - 256.  The\n"
+"                       second of input before the segment is only used to\n"
+"                       prime the encoder.  The parts are byte-identical to\n"
+"                       the frames of the complete stream unless -dcfilter,\n"
+"                       -bwfilter or -lfefilter is used.  This implies\n"
+"                       -wholefile 1.\n",
+
+"    [-segframes #] Number of frames in the segment\n"
+"                       0 = up to the end of the input (default)\n",
+
 "    [-nosimd X]    Comma-separated list of SIMD instruction sets not to use\n"
 "                       Aften will auto-detect available SIMD instruction sets\n"
 "                       for your CPU, so you shouldn't need to disable sets\n"
 "                       explicitly - unless for speed or debugging reasons.\n"
-"                       Available sets are mmx, sse, sse2, sse3 and altivec.\n"
+"                       Available sets are mmx, sse, sse2, sse3, avx, avx2,\n"
+"                       fma, avx512bw and altivec.\n"
 "                       No spaces are allowed between the sets and the commas.\n"
 "                       Example: -nosimd sse2,sse3\n",
 
@@ -282,7 +343,17 @@ static const char *encoding_options[ENCODING_OPTIONS_COUNT] = {
 "                       a list of pre-defined exponent strategies.  This option\n"
 "                       controls the size of the list to be searched.  The\n"
 "                       value can range from 1 (lower quality but faster) to\n"
-"                       32 (higher quality but slower).  The default value is 8.\n",
+"                       32 (higher quality but slower).  The default value is 8.\n"
+"                       With -expsavg, this is the maximum search size.\n",
+
+"    [-expsavg #]  Adaptive exponent strategy search\n"
+"                       If set, the search size follows how much the spectrum\n"
+"                       of each channel changes between the blocks of a frame.\n"
+"                       Channels with typical spectral flux search this many\n"
+"                       strategies, stationary or silent ones fewer, down to 1,\n"
+"                       and transient ones more, up to the -exps value.  The\n"
+"                       value can range from 1 to 32, 0 turns the adaptive\n"
+"                       search off.  The default value is 0.\n",
 
 "    [-pad #]      Start-of-stream padding\n"
 "                       The AC-3 format uses an overlap/add cycle for encoding\n"
@@ -323,6 +394,18 @@ static const char *encoding_options[ENCODING_OPTIONS_COUNT] = {
 "                       to speed up encoding by using a lower value than 60,\n"
 "                       which is the default.\n",
 
+"    [-lookahead #] Variable bandwidth lookahead\n"
+"                       Only for variable bandwidth mode (-w -2); with any\n"
+"                       other -w setting it is an error.  This option sets\n"
+"                       the number of frames after each frame which are\n"
+"                       analyzed before its bandwidth is chosen.  The\n"
+"                       bandwidth then goes up by at most one code per frame,\n"
+"                       and starts to go down early enough to reach frames\n"
+"                       which need a lower one, instead of jumping from frame\n"
+"                       to frame.  This needs threads, and cannot be used\n"
+"                       with the channel thread mode or -wholefile.  The\n"
+"                       default value is 0, which is off.\n",
+
 "    [-m #]         Stereo rematrixing\n"
 "                       Using stereo rematrixing can increase quality by\n"
 "                       removing redundant information between the left and\n"
@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stddef.h>
+#include <limits.h>
 
 #include "opts.h"
 #include "pcm.h"
@@ -160,10 +161,18 @@ parse_nosimd(PARSE_PARAMS)
             wanted_simd_instructions->sse2 = 0;
         else if (!strncmp(&simd[i], "sse3", 5))
             wanted_simd_instructions->sse3 = 0;
+        else if (!strncmp(&simd[i], "avx", 4))
+            wanted_simd_instructions->avx = 0;
+        else if (!strncmp(&simd[i], "avx2", 5))
+            wanted_simd_instructions->avx2 = 0;
+        else if (!strncmp(&simd[i], "fma", 4))
+            wanted_simd_instructions->fma = 0;
+        else if (!strncmp(&simd[i], "avx512bw", 9))
+            wanted_simd_instructions->avx512bw = 0;
         else if (!strncmp(&simd[i], "altivec", 8))
             wanted_simd_instructions->altivec = 0;
         else {
-            fprintf(stderr, "invalid simd instruction set: %s. must be mmx, sse, sse2, sse3 or altivec.\n", &simd[i]);
+            fprintf(stderr, "invalid simd instruction set: %s. must be mmx, sse, sse2, sse3, avx, avx2, fma, avx512bw or altivec.\n", &simd[i]);
             return 1;
         }
         if (last)
@@ -354,7 +363,7 @@ parse_xbsi2_opt(PARSE_PARAMS)
     return parse_simple_int_s(arg, param, item, opts, priv);
 }
 
-#define OPTION_ITEM_COUNT 43
+#define OPTION_ITEM_COUNT 49
 
 /**
  * list of commandline options, in alphabetical order.
@@ -378,10 +387,12 @@ static const OptionItem options_list[OPTION_ITEM_COUNT] = {
     { "dsurexmod",  OPTION_FLAGS_NONE,              0,              2,  parse_xbsi2_opt,    offsetof(AftenContext, meta.dsurexmod)              },
     { "dynrng",     OPTION_FLAGS_NONE,              0,              5,  parse_simple_int_s, offsetof(AftenContext, params.dynrng_profile)       },
     { "exps",       OPTION_FLAGS_NONE,              1,             32,  parse_simple_int_s, offsetof(AftenContext, params.expstr_search)        },
+    { "expsavg",    OPTION_FLAGS_NONE,              0,             32,  parse_simple_int_s, offsetof(AftenContext, params.expstr_search_avg)    },
     { "fba",        OPTION_FLAGS_NONE,              0,              1,  parse_simple_int_s, offsetof(AftenContext, params.bitalloc_fast)        },
     { "h",          OPTION_FLAG_NO_PARAM,           0,              0,  parse_h,            0                                                   },
     { "lfe",        OPTION_FLAGS_NONE,              0,              1,  parse_simple_int_s, offsetof(AftenContext, lfe)                         },
     { "lfefilter",  OPTION_FLAGS_NONE,              0,              1,  parse_simple_int_s, offsetof(AftenContext, params.use_lfe_filter)       },
+    { "lookahead",  OPTION_FLAGS_NONE,              0,             32,  parse_simple_int_s, offsetof(AftenContext, params.lookahead)            },
     { "longhelp",   OPTION_FLAG_NO_PARAM,           0,              0,  parse_longhelp,     0                                                   },
     { "lorocmix",   OPTION_FLAGS_NONE,              0,              7,  parse_xbsi1_opt,    offsetof(AftenContext, meta.lorocmixlev)            },
     { "lorosmix",   OPTION_FLAGS_NONE,              0,              7,  parse_xbsi1_opt,    offsetof(AftenContext, meta.lorosmixlev)            },
@@ -396,11 +407,15 @@ static const OptionItem options_list[OPTION_ITEM_COUNT] = {
     { "raw_sr",     OPTION_FLAGS_NONE,              1,          48000,  parse_raw_option,   offsetof(CommandOptions, raw_sr)                    },
     { "readtoeof",  OPTION_FLAGS_NONE,              0,              1,  parse_simple_int_o, offsetof(CommandOptions, read_to_eof)               },
     { "s",          OPTION_FLAGS_NONE,              0,              1,  parse_simple_int_s, offsetof(AftenContext, params.use_block_switching)  },
+    { "segframes",  OPTION_FLAGS_NONE,              0,        INT_MAX,  parse_simple_int_o, offsetof(CommandOptions, seg_frames)                },
+    { "segstart",   OPTION_FLAGS_NONE,              0,        INT_MAX,  parse_simple_int_o, offsetof(CommandOptions, seg_start)                 },
     { "smix",       OPTION_FLAGS_NONE,              0,              2,  parse_simple_int_s, offsetof(AftenContext, meta.surmixlev)              },
+    { "threadmode", OPTION_FLAGS_NONE,              0,              2,  parse_simple_int_s, offsetof(AftenContext, system.thread_mode)          },
     { "threads",    OPTION_FLAGS_NONE,              0,MAX_NUM_THREADS,  parse_simple_int_s, offsetof(AftenContext, system.n_threads)            },
     { "v",          OPTION_FLAGS_NONE,              0,              2,  parse_simple_int_s, offsetof(AftenContext, verbose)                     },
     { "version",    OPTION_FLAG_NO_PARAM,           0,              0,  parse_version,      0                                                   },
     { "w",          OPTION_FLAGS_NONE,             -2,             60,  parse_simple_int_s, offsetof(AftenContext, params.bwcode)               },
+    { "wholefile",  OPTION_FLAGS_NONE,              0,              1,  parse_simple_int_o, offsetof(CommandOptions, whole_file)                },
     { "wmax",       OPTION_FLAGS_NONE,              0,             60,  parse_simple_int_s, offsetof(AftenContext, params.max_bwcode)           },
     { "wmin",       OPTION_FLAGS_NONE,              0,             60,  parse_simple_int_s, offsetof(AftenContext, params.min_bwcode)           },
     { "xbsi1",      OPTION_FLAGS_NONE,              0,              1,  parse_simple_int_s, offsetof(AftenContext, meta.xbsi1e)                 },
@@ -424,6 +439,9 @@ parse_commandline(int argc, char **argv, CommandOptions *opts)
     opts->outfile = NULL;
     opts->pad_start = 1;
     opts->read_to_eof = 0;
+    opts->whole_file = 0;
+    opts->seg_start = -1;
+    opts->seg_frames = 0;
     opts->raw_input = 0;
     opts->raw_fmt = PCM_SAMPLE_FMT_S16;
     opts->raw_order = PCM_BYTE_ORDER_LE;
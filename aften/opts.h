@@ -40,6 +40,9 @@ typedef struct {
     AftenContext *s;
     int pad_start;
     int read_to_eof;
+    int whole_file;
+    int seg_start;
+    int seg_frames;
     int raw_input;
     enum PcmSampleFormat raw_fmt;
     int raw_order;
@@ -60,6 +60,25 @@ namespace Aften
 		Vbr
 	}
 
+	/// <summary>
+	/// Threading Mode
+	/// </summary>
+	public enum ThreadMode
+	{
+		/// <summary>
+		/// Several frames are encoded at once
+		/// </summary>
+		Frame = 0,
+		/// <summary>
+		/// The channels of one frame are encoded at once
+		/// </summary>
+		Channel,
+		/// <summary>
+		/// Analysis, bit allocation and packing work on consecutive frames at once
+		/// </summary>
+		Pipeline
+	}
+
 	/// <summary>
 	/// Floating-Point Data Types
 	/// </summary>
@@ -225,6 +244,22 @@ namespace Aften
 		/// PowerPC Altivec
 		/// </summary>
 		public bool Altivec;
+		/// <summary>
+		/// AVX
+		/// </summary>
+		public bool Avx;
+		/// <summary>
+		/// AVX2
+		/// </summary>
+		public bool Avx2;
+		/// <summary>
+		/// FMA3
+		/// </summary>
+		public bool Fma;
+		/// <summary>
+		/// AVX-512 Byte and Word
+		/// </summary>
+		public bool Avx512Bw;
 	}
 
 	/// <summary>
@@ -240,6 +275,31 @@ namespace Aften
 		/// </summary>
 		public int ThreadsCount;
 
+		/// <summary>
+		/// Spin count
+		/// How many times an idle encoding thread polls for new work, and the
+		/// calling thread polls for finished frames, before going to sleep.
+		/// This is ignored on single-CPU systems.
+		/// Default value is 1000.
+		/// </summary>
+		public int SpinCount;
+
+		/// <summary>
+		/// Threading mode
+		/// Frame mode adds 2 * ThreadsCount frames of latency.
+		/// Channel mode adds no latency, but scales only up to the number of channels.
+		/// Pipeline mode adds 3 frames of latency and uses up to 3 threads.
+		/// Default value is ThreadMode.Frame.
+		/// </summary>
+		public ThreadMode ThreadMode;
+
+		/// <summary>
+		/// Thread pool
+		/// Set by aften_pool_attach.
+		/// Default value is IntPtr.Zero, which means that the encoder starts its own threads.
+		/// </summary>
+		public IntPtr Pool;
+
 		/// <summary>
 		/// Available SIMD instruction sets; shouldn't be modified
 		/// </summary>
@@ -354,6 +414,19 @@ namespace Aften
 		/// </summary>
 		public int ExponentStrategySearchSize;
 
+		/// <summary>
+		/// Adaptive exponent strategy search
+		/// If set, each channel searches a number of sets that follows the
+		/// spectral flux between its blocks: this many sets for a channel
+		/// with typical flux, fewer down to 1 for more stationary or silent
+		/// channels, and more up to ExponentStrategySearchSize for transient
+		/// ones.
+		/// 0 is off (every channel searches ExponentStrategySearchSize sets)
+		/// maximum is 32
+		/// default is 0
+		/// </summary>
+		public int ExponentStrategySearchAverage;
+
 		/// <summary>
 		/// Dynamic Range Compression profile
 		/// This determines which DRC profile to use.
@@ -382,6 +455,22 @@ namespace Aften
 		/// default is 60.
 		/// </summary>
 		public int MaximumBandwidthCode;
+
+		/// <summary>
+		/// Variable bandwidth lookahead.
+		/// Only for variable bandwidth mode (bwcode -2), any other bwcode with a
+		/// non-zero lookahead is an error.  This is the number of frames
+		/// after each frame whose bandwidth estimates are known before the
+		/// bandwidth of the frame is chosen.  The bandwidth then changes by at
+		/// most one bandwidth code per frame, and starts going down ahead of
+		/// frames which need a lower one.  The frames are held back until those
+		/// after them have been analyzed, which needs threads, and does not work
+		/// with the channel thread mode.
+		/// 0 is off (each frame uses its own estimate)
+		/// maximum is 32
+		/// default is 0
+		/// </summary>
+		public int Lookahead;
 	}
 
 	/// <summary>
@@ -482,6 +571,30 @@ namespace Aften
 		/// BandwidthCode
 		/// </summary>
 		public int BandwidthCode;
+
+		/// <summary>
+		/// Number of times encoding threads had to go to sleep waiting for
+		/// work. Only used in threaded mode.
+		/// </summary>
+		public int ThreadParks;
+
+		/// <summary>
+		/// Average number of exponent strategy sets searched per channel,
+		/// not counting the LFE channel.
+		/// </summary>
+		public float ExponentStrategySearchAverage;
+
+		/// <summary>
+		/// Number of bit allocation passes the snroffst search needed for
+		/// the frame.
+		/// </summary>
+		public int SnrIterations;
+
+		/// <summary>
+		/// Number of snroffst values the search tried again for the frame,
+		/// whose bit counts were remembered from an earlier pass.
+		/// </summary>
+		public int SnrCacheHits;
 	}
 
 	/// <summary>
@@ -27,8 +27,8 @@
 
 #include "a52.h"
 
-static uint8_t band_start_tab[51];
-static uint8_t bin_to_band_tab[253];
+uint8_t a52_band_start_tab[51];
+uint8_t a52_bin_to_band_tab[253];
 
 
 static inline int calc_lowcomp1(int a, int b0, int b1, int c)
@@ -53,25 +53,33 @@ static inline int calc_lowcomp(int a, int b0, int b1, int bin)
 void a52_bit_alloc_calc_psd(uint8_t *exp, int start, int end, int16_t *psd,
                                int16_t *band_psd)
 {
-    int bin, band;
+    int bin;
 
     /* exponent mapping to PSD */
     for (bin = start; bin < end; bin++)
         psd[bin] = 3072 - (exp[bin] << 7);
 
+    a52_bit_alloc_calc_band_psd(psd, start, end, band_psd);
+}
+
+void a52_bit_alloc_calc_band_psd(int16_t *psd, int start, int end,
+                                 int16_t *band_psd)
+{
+    int bin, band;
+
     /* PSD integration */
     bin  = start;
-    band = bin_to_band_tab[start];
+    band = a52_bin_to_band_tab[start];
     do {
         int v = psd[bin++];
-        int band_end = MIN(band_start_tab[band+1], end);
+        int band_end = MIN(a52_band_start_tab[band+1], end);
         for (; bin < band_end; bin++) {
             /* logadd */
             int adr = MIN(ABS(v - psd[bin]) >> 1, 255);
             v = MAX(v, psd[bin]) + a52_log_add_tab[adr];
         }
         band_psd[band++] = v;
-    } while (end > band_start_tab[band]);
+    } while (end > a52_band_start_tab[band]);
 }
 
 void a52_bit_alloc_calc_mask(A52BitAllocParams *s, int16_t *band_psd,
@@ -86,8 +94,8 @@ void a52_bit_alloc_calc_mask(A52BitAllocParams *s, int16_t *band_psd,
     int lowcomp, fastleak, slowleak;
 
     /* excitation function */
-    band_start = bin_to_band_tab[start];
-    band_end = bin_to_band_tab[end-1] + 1;
+    band_start = a52_bin_to_band_tab[start];
+    band_end = a52_bin_to_band_tab[end-1] + 1;
 
     if (band_start == 0) {
         lowcomp = 0;
@@ -180,10 +188,10 @@ void a52_bit_alloc_calc_bap(int16_t *mask, int16_t *psd, int start, int end,
     }
 
     bin = start;
-    band = bin_to_band_tab[start];
+    band = a52_bin_to_band_tab[start];
     do {
         int m = (MAX(mask[band] - snr_offset - floor, 0) & 0x1FE0) + floor;
-        int band_end = MIN(band_start_tab[band+1], end);
+        int band_end = MIN(a52_band_start_tab[band+1], end);
         if ((band_end - bin) & 1) {
             int address = CLIP((psd[bin] - m) >> 5, 0, 63);
             bap[bin++] = a52_bap_tab[address];
@@ -195,7 +203,59 @@ void a52_bit_alloc_calc_bap(int16_t *mask, int16_t *psd, int start, int end,
             bap[bin+1] = a52_bap_tab[address2];
             bin += 2;
         }
-    } while (end > band_start_tab[band++]);
+        band++;
+    } while (end > a52_band_start_tab[band]);
+}
+
+void a52_bit_alloc_calc_hist(uint8_t *exp, int start, int end, A52ExpHist *hist)
+{
+    uint8_t count[256];
+    int bin, band, first, i, n;
+
+    memset(count, 0, sizeof(count));
+    n = 0;
+    bin  = start;
+    band = a52_bin_to_band_tab[start];
+    do {
+        int band_end = MIN(a52_band_start_tab[band+1], end);
+        first = n;
+        for (; bin < band_end; bin++) {
+            if (!count[exp[bin]]++)
+                hist->exp[n++] = exp[bin];
+        }
+        for (i = first; i < n; i++) {
+            hist->count[i] = count[hist->exp[i]];
+            count[hist->exp[i]] = 0;
+        }
+        hist->band_end[band++] = n;
+    } while (end > a52_band_start_tab[band]);
+    memset(&hist->exp[n], 0, A52_EXP_HIST_PAD);
+    memset(&hist->count[n], 0, A52_EXP_HIST_PAD);
+}
+
+void a52_bit_alloc_count_bap(int16_t *mask, A52ExpHist *hist, int start, int end,
+                             int snr_offset, int floor, int bap_count[16])
+{
+    int i, band;
+
+    memset(bap_count, 0, 16 * sizeof(int));
+    if (snr_offset == -960) {
+        bap_count[0] = end - start;
+        return;
+    }
+
+    i = 0;
+    band = a52_bin_to_band_tab[start];
+    do {
+        int m = (MAX(mask[band] - snr_offset - floor, 0) & 0x1FE0) + floor;
+        // psd is 3072 - (exp << 7), so (psd - m) >> 5 is this minus exp * 4
+        int address0 = (3072 - m) >> 5;
+        for (; i < hist->band_end[band]; i++) {
+            int address = CLIP(address0 - (hist->exp[i] << 2), 0, 63);
+            bap_count[a52_bap_tab[address]] += hist->count[i];
+        }
+        band++;
+    } while (end > a52_band_start_tab[band]);
 }
 
 /**
@@ -203,14 +263,14 @@ void a52_bit_alloc_calc_bap(int16_t *mask, int16_t *psd, int start, int end,
  */
 void a52_common_init(void)
 {
-    /* populate band_start_tab[] and bin_to_band_tab[]
+    /* populate a52_band_start_tab[] and a52_bin_to_band_tab[]
        from a52_critical_band_size_tab[] */
     int bin = 0, band;
     for (band = 0; band < 50; band++) {
         int band_end = bin + a52_critical_band_size_tab[band];
-        band_start_tab[band] = bin;
+        a52_band_start_tab[band] = bin;
         while (bin < band_end)
-            bin_to_band_tab[bin++] = band;
+            a52_bin_to_band_tab[bin++] = band;
     }
-    band_start_tab[50] = bin;
+    a52_band_start_tab[50] = bin;
 }
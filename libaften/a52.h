@@ -74,6 +74,19 @@ typedef enum {
     DBA_RESERVED
 } AC3DeltaStrategy;
 
+/** zeroed entries after the last one, so it can be read in whole vectors */
+#define A52_EXP_HIST_PAD 32
+
+/**
+ * Distinct exponents in each critical band, with the number of bins that
+ * have them.  The entries of a band end at band_end[band].
+ */
+typedef struct A52ExpHist {
+    uint8_t exp[253+A52_EXP_HIST_PAD];
+    uint8_t count[253+A52_EXP_HIST_PAD];
+    uint8_t band_end[50];
+} A52ExpHist;
+
 typedef struct A52Block {
     FLOAT *input_samples[A52_MAX_CHANNELS]; /* 512 per ch */
     FLOAT *mdct_coef[A52_MAX_CHANNELS]; /* 256 per ch */
@@ -85,6 +98,7 @@ typedef struct A52Block {
     uint8_t exp[A52_MAX_CHANNELS][256];
     int16_t psd[A52_MAX_CHANNELS][256];
     int16_t mask[A52_MAX_CHANNELS][50];
+    A52ExpHist exp_hist[A52_MAX_CHANNELS];
     uint8_t exp_strategy[A52_MAX_CHANNELS];
     uint8_t nexpgrps[A52_MAX_CHANNELS];
     uint8_t grp_exp[A52_MAX_CHANNELS][85];
@@ -102,6 +116,16 @@ typedef struct A52BitAllocParams {
     int cplfleak, cplsleak;
 } A52BitAllocParams;
 
+#define A52_SNR_CACHE_SIZE 32
+
+/** mantissa bits of the snroffst values already tried for a frame */
+typedef struct A52SnrCache {
+    int count;
+    int16_t snroffst[A52_SNR_CACHE_SIZE];
+    int bits[A52_SNR_CACHE_SIZE];
+    int min_bits[A52_SNR_CACHE_SIZE];
+} A52SnrCache;
+
 typedef struct A52Frame {
     int quality;
     int bit_rate;
@@ -112,6 +136,7 @@ typedef struct A52Frame {
     int frame_bits;
     int exp_bits;
     int mant_bits;
+    uint32_t frame_num;          // position of the frame in the stream
     unsigned int frame_size_min; // minimum frame size
     unsigned int frame_size;     // current frame size in words
     unsigned int frmsizecod;
@@ -123,9 +148,18 @@ typedef struct A52Frame {
     int fsnroffst;
     int ncoefs[A52_MAX_CHANNELS];
     int expstr_set[A52_MAX_CHANNELS];
+    int expstr_search[A52_MAX_CHANNELS]; // number of strategy sets searched
+    int snr_iterations;          // bit allocation passes of the snroffst search
+    int snr_cache_hits;          // passes of the search saved by snr_cache
+    A52SnrCache snr_cache;
     uint8_t rematflg[4];
 } A52Frame;
 
+/** first bin of each critical band, with the end of the last band at [50] */
+extern uint8_t a52_band_start_tab[51];
+/** critical band of each bin */
+extern uint8_t a52_bin_to_band_tab[253];
+
 void a52_common_init(void);
 
 /**
@@ -145,6 +179,19 @@ void a52_common_init(void);
 void a52_bit_alloc_calc_psd(uint8_t *exp, int start, int end, int16_t *psd,
                                int16_t *band_psd);
 
+/**
+ * Integrates the psd of the bins into the critical bands.  This is the
+ * second half of a52_bit_alloc_calc_psd, for versions which compute the psd
+ * of the bins themselves.
+ *
+ * @param[in]  psd        signal power for each frequency bin
+ * @param[in]  start      starting bin location
+ * @param[in]  end        ending bin location
+ * @param[out] band_psd   signal power for each critical band
+ */
+void a52_bit_alloc_calc_band_psd(int16_t *psd, int start, int end,
+                                 int16_t *band_psd);
+
 /**
  * Calculates the masking curve.
  * First, the excitation is calculated using parameters in \p s and the signal
@@ -188,4 +235,32 @@ void a52_bit_alloc_calc_mask(A52BitAllocParams *s, int16_t *band_psd,
 void a52_bit_alloc_calc_bap(int16_t *mask, int16_t *psd, int start, int end,
                                int snr_offset, int floor, uint8_t *bap);
 
+/**
+ * Builds the histogram of the exponents in each critical band.
+ * The bit allocation pointer of a bin only depends on its exponent and its
+ * band, so it is enough to know how many bins of a band share an exponent.
+ *
+ * @param[in]  exp        frequency coefficient exponents
+ * @param[in]  start      starting bin location
+ * @param[in]  end        ending bin location
+ * @param[out] hist       exponent histogram
+ */
+void a52_bit_alloc_calc_hist(uint8_t *exp, int start, int end, A52ExpHist *hist);
+
+/**
+ * Counts the bins for each bit allocation pointer value, giving the same
+ * result as a52_bit_alloc_calc_bap with the psd of the same exponents.
+ * Works on the distinct exponents of each band instead of on each bin.
+ *
+ * @param[in]  mask       masking curve
+ * @param[in]  hist       exponent histogram
+ * @param[in]  start      starting bin location
+ * @param[in]  end        ending bin location
+ * @param[in]  snr_offset SNR adjustment
+ * @param[in]  floor      noise floor
+ * @param[out] bap_count  number of bins for each bap value
+ */
+void a52_bit_alloc_count_bap(int16_t *mask, A52ExpHist *hist, int start, int end,
+                             int snr_offset, int floor, int bap_count[16]);
+
 #endif /* A52_H */
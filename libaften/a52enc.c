@@ -26,6 +26,8 @@
  * A/52 encoder
  */
 
+#include <limits.h>
+
 #include "a52enc.h"
 #include "bitalloc.h"
 #include "crc.h"
@@ -49,6 +51,10 @@ static int convert_samples_from_src(A52ThreadContext *tctx, const void *vsrc,
 
 static int begin_encode_frame(A52ThreadContext *tctx);
 static int begin_transcode_frame(A52ThreadContext *tctx);
+#ifndef NO_THREADS
+static void init_stages(A52Context *ctx);
+static int process_frame_channels(A52ThreadContext *tctx);
+#endif
 
 static int
 prepare_transcode_common(A52ThreadContext *tctx, const void *input_frame_buffer,
@@ -77,8 +83,6 @@ prepare_transcode_common(A52ThreadContext *tctx, const void *input_frame_buffer,
 }
 
 #ifndef NO_THREADS
-static int threaded_worker(void* vtctx);
-
 static int
 prepare_encode(A52ThreadContext *tctx, const void *samples, int count, UNUSED(int *info))
 {
@@ -86,10 +90,10 @@ prepare_encode(A52ThreadContext *tctx, const void *samples, int count, UNUSED(in
     // append extra silent frame if final frame is > 1280 samples, to flush 256 samples in mdct
     if (ctx->last_samples_count <= (A52_SAMPLES_PER_FRAME - 256) && ctx->last_samples_count != -1) {
         tctx->state = END;
-        --ctx->ts.threads_running;
     } else { // convert sample format and de-interleave channels
         convert_samples_from_src(tctx, samples, count);
         ctx->last_samples_count = count;
+        tctx->state = WORK;
     }
 
     return 0;
@@ -100,13 +104,15 @@ prepare_transcode(A52ThreadContext *tctx, const void *input_frame_buffer, int in
 {
     if (!input_frame_buffer_size) {
         tctx->state = END;
-        --tctx->ctx->ts.threads_running;
         *want_bytes = 0;
 
         return 0;
     }
+    if (prepare_transcode_common(tctx, input_frame_buffer, input_frame_buffer_size, want_bytes))
+        return -1;
+    tctx->state = WORK;
 
-    return prepare_transcode_common(tctx, input_frame_buffer, input_frame_buffer_size, want_bytes);
+    return 0;
 }
 #endif
 
@@ -141,6 +147,16 @@ set_available_simd_instructions(AftenSimdInstructions *simd_instructions)
 #ifdef HAVE_SSE3
     simd_instructions->sse3 = cpu_caps_have_sse3();
 #endif
+#ifdef HAVE_AVX
+    simd_instructions->avx = cpu_caps_have_avx();
+#endif
+#ifdef HAVE_AVX2
+    simd_instructions->avx2 = cpu_caps_have_avx2();
+    simd_instructions->fma = cpu_caps_have_fma();
+#endif
+#ifdef HAVE_AVX512BW
+    simd_instructions->avx512bw = cpu_caps_have_avx512bw();
+#endif
 /* Following SIMD code doesn't exist yet, so don't set it available */
 #if 0
 #ifdef HAVE_SSSE3
@@ -179,6 +195,9 @@ aften_set_defaults(AftenContext *s)
     set_available_simd_instructions(&s->system.available_simd_instructions);
     s->system.wanted_simd_instructions = s->system.available_simd_instructions;
     s->system.n_threads = 0;
+    s->system.spin_count = 1000;
+    s->system.thread_mode = AFTEN_THREAD_MODE_FRAME;
+    s->system.pool = NULL;
 
     s->verbose = 1;
     s->channels = -1;
@@ -200,9 +219,11 @@ aften_set_defaults(AftenContext *s)
     s->params.use_lfe_filter = 0;
     s->params.bitalloc_fast = 0;
     s->params.expstr_search = 8;
+    s->params.expstr_search_avg = 0;
     s->params.dynrng_profile = DYNRNG_PROFILE_NONE;
     s->params.min_bwcode = 0;
     s->params.max_bwcode = 60;
+    s->params.lookahead = 0;
 
     s->meta.cmixlev = 0;
     s->meta.surmixlev = 0;
@@ -222,6 +243,10 @@ aften_set_defaults(AftenContext *s)
     s->status.quality = 0;
     s->status.bit_rate = 0;
     s->status.bwcode = 0;
+    s->status.thread_parks = 0;
+    s->status.expstr_search_avg = 0;
+    s->status.snr_iterations = 0;
+    s->status.snr_cache_hits = 0;
 
     s->initial_samples = NULL;
 }
@@ -232,6 +257,7 @@ aften_encode_init(AftenContext *s)
     A52Context *ctx;
     int i, j, brate;
     int last_quality;
+    int use_threads;
 
     if (s == NULL) {
         fprintf(stderr, "NULL parameter passed to aften_encode_init\n");
@@ -395,10 +421,15 @@ found:
                 ctx->params.expstr_search);
         return -1;
     }
+    if (ctx->params.expstr_search_avg < 0 || ctx->params.expstr_search_avg > 32) {
+        fprintf(stderr, "invalid average exponent strategy search size: %d\n",
+                ctx->params.expstr_search_avg);
+        return -1;
+    }
 
     crc_init();
-    a52_window_init(&ctx->winf);
     exponent_init(&ctx->expf);
+    bit_alloc_init(&ctx->baf);
     dynrng_init();
 
     last_quality = 240;
@@ -407,6 +438,8 @@ found:
     else if (ctx->params.encoding_mode == AFTEN_ENC_MODE_CBR)
         last_quality = ((((ctx->target_bitrate/ctx->n_channels)*35)/24)+95)+(25*ctx->halfratecod);
 
+    ctx->start_quality = CLIP(last_quality, 0, 1023);
+
     if (s->params.bwcode < -2 || s->params.bwcode > 60) {
         fprintf(stderr, "invalid bandwidth code\n");
         return -1;
@@ -432,6 +465,23 @@ found:
         ctx->fixed_bwcode = ctx->params.bwcode;
     }
 
+    if (ctx->params.lookahead < 0 || ctx->params.lookahead > A52_MAX_LOOKAHEAD) {
+        fprintf(stderr, "invalid lookahead: %d\n", ctx->params.lookahead);
+        return -1;
+    }
+    // only the variable bandwidth is chosen looking ahead
+    if (ctx->params.lookahead && ctx->params.bwcode != -2) {
+        fprintf(stderr, "lookahead can only be used with variable bandwidth mode\n");
+        return -1;
+    }
+    ctx->lookahead = ctx->params.lookahead;
+#ifdef NO_THREADS
+    if (ctx->lookahead) {
+        fprintf(stderr, "lookahead cannot be used without threads\n");
+        return -1;
+    }
+#endif
+
     if (s->mode == AFTEN_ENCODE) {
         // can't do block switching with low sample rate due to the high-pass filter
         if (ctx->sample_rate <= 16000)
@@ -441,11 +491,11 @@ found:
         // cascaded biquad direct form I high-pass w/ cutoff of 8 kHz
         if (ctx->params.use_block_switching) {
             for (i = 0; i < ctx->n_all_channels; i++) {
-                ctx->bs_filter[i].type = FILTER_TYPE_HIGHPASS;
-                ctx->bs_filter[i].cascaded = 1;
-                ctx->bs_filter[i].cutoff = 8000;
-                ctx->bs_filter[i].samplerate = (FLOAT)ctx->sample_rate;
-                if (filter_init(&ctx->bs_filter[i], FILTER_ID_BIQUAD_I)) {
+                ctx->input.bs_filter[i].type = FILTER_TYPE_HIGHPASS;
+                ctx->input.bs_filter[i].cascaded = 1;
+                ctx->input.bs_filter[i].cutoff = 8000;
+                ctx->input.bs_filter[i].samplerate = (FLOAT)ctx->sample_rate;
+                if (filter_init(&ctx->input.bs_filter[i], FILTER_ID_BIQUAD_I)) {
                     fprintf(stderr, "error initializing transient-detect filter\n");
                     return -1;
                 }
@@ -456,11 +506,11 @@ found:
         // one-pole high-pass w/ cutoff of 3 Hz
         if (ctx->params.use_dc_filter) {
             for (i = 0; i < ctx->n_all_channels; i++) {
-                ctx->dc_filter[i].type = FILTER_TYPE_HIGHPASS;
-                ctx->dc_filter[i].cascaded = 0;
-                ctx->dc_filter[i].cutoff = 3;
-                ctx->dc_filter[i].samplerate = (FLOAT)ctx->sample_rate;
-                if (filter_init(&ctx->dc_filter[i], FILTER_ID_ONEPOLE)) {
+                ctx->input.dc_filter[i].type = FILTER_TYPE_HIGHPASS;
+                ctx->input.dc_filter[i].cascaded = 0;
+                ctx->input.dc_filter[i].cutoff = 3;
+                ctx->input.dc_filter[i].samplerate = (FLOAT)ctx->sample_rate;
+                if (filter_init(&ctx->input.dc_filter[i], FILTER_ID_ONEPOLE)) {
                     fprintf(stderr, "error initializing dc filter\n");
                     return -1;
                 }
@@ -479,11 +529,11 @@ found:
                 ctx->params.use_bw_filter = 0;
             } else {
                 for (i = 0; i < ctx->n_channels; i++) {
-                    ctx->bw_filter[i].type = FILTER_TYPE_LOWPASS;
-                    ctx->bw_filter[i].cascaded = 1;
-                    ctx->bw_filter[i].cutoff = (FLOAT)cutoff;
-                    ctx->bw_filter[i].samplerate = (FLOAT)ctx->sample_rate;
-                    if (filter_init(&ctx->bw_filter[i], FILTER_ID_BUTTERWORTH_II)) {
+                    ctx->input.bw_filter[i].type = FILTER_TYPE_LOWPASS;
+                    ctx->input.bw_filter[i].cascaded = 1;
+                    ctx->input.bw_filter[i].cutoff = (FLOAT)cutoff;
+                    ctx->input.bw_filter[i].samplerate = (FLOAT)ctx->sample_rate;
+                    if (filter_init(&ctx->input.bw_filter[i], FILTER_ID_BUTTERWORTH_II)) {
                         fprintf(stderr, "error initializing bandwidth filter\n");
                         return -1;
                     }
@@ -498,11 +548,11 @@ found:
                 fprintf(stderr, "cannot use lfe filter. no lfe channel\n");
                 return -1;
             }
-            ctx->lfe_filter.type = FILTER_TYPE_LOWPASS;
-            ctx->lfe_filter.cascaded = 1;
-            ctx->lfe_filter.cutoff = 120;
-            ctx->lfe_filter.samplerate = (FLOAT)ctx->sample_rate;
-            if (filter_init(&ctx->lfe_filter, FILTER_ID_BUTTERWORTH_II)) {
+            ctx->input.lfe_filter.type = FILTER_TYPE_LOWPASS;
+            ctx->input.lfe_filter.cascaded = 1;
+            ctx->input.lfe_filter.cutoff = 120;
+            ctx->input.lfe_filter.samplerate = (FLOAT)ctx->sample_rate;
+            if (filter_init(&ctx->input.lfe_filter, FILTER_ID_BUTTERWORTH_II)) {
                 fprintf(stderr, "error initializing lfe filter\n");
                 return -1;
             }
@@ -511,62 +561,103 @@ found:
 
     // Initialize thread specific contexts
     ctx->n_threads = (s->system.n_threads > 0) ? s->system.n_threads : get_ncpus();
+#ifndef NO_THREADS
+    ctx->ts.pool = s->system.pool;
+    if (ctx->ts.pool) {
+        int pool_threads = ctx->ts.pool->sched.n_workers;
+        if (s->system.n_threads <= 0 || s->system.n_threads > pool_threads)
+            ctx->n_threads = pool_threads;
+    }
+#endif
     ctx->n_threads = MIN(ctx->n_threads, MAX_NUM_THREADS);
+    if (s->system.thread_mode == AFTEN_THREAD_MODE_CHANNEL) {
+        // there is nothing to share beyond one thread per channel
+        ctx->n_threads = MIN(ctx->n_threads, ctx->n_all_channels);
+    } else if (s->system.thread_mode == AFTEN_THREAD_MODE_PIPELINE) {
+        // one thread per stage
+        ctx->n_threads = MIN(ctx->n_threads, A52_PIPELINE_STAGES);
+    } else if (s->system.thread_mode != AFTEN_THREAD_MODE_FRAME) {
+        fprintf(stderr, "invalid thread mode\n");
+        return -1;
+    }
     s->system.n_threads = ctx->n_threads;
-    ctx->tctx = calloc(sizeof(A52ThreadContext), ctx->n_threads);
-
-    for (j = 0; j < ctx->n_threads; j++) {
+    use_threads = 0;
+    ctx->thread_mode = AFTEN_THREAD_MODE_FRAME;
+#ifndef NO_THREADS
+    // a pool is used even for a single thread, so the work leaves the caller,
+    // and so are workers with lookahead, where frames wait for later ones
+    use_threads = ctx->n_threads > 1 || ctx->ts.pool || ctx->lookahead;
+    // only encoding has per-channel stages
+    if (use_threads && s->mode == AFTEN_ENCODE)
+        ctx->thread_mode = s->system.thread_mode;
+    if (ctx->lookahead && ctx->thread_mode == AFTEN_THREAD_MODE_CHANNEL) {
+        fprintf(stderr, "lookahead cannot be used with the channel thread mode\n");
+        return -1;
+    }
+#endif
+    // the frames held for the lookahead come on top of those being encoded
+    ctx->n_tctx = 1;
+    if (use_threads && ctx->thread_mode == AFTEN_THREAD_MODE_FRAME)
+        ctx->n_tctx = ctx->n_threads * A52_FRAMES_PER_THREAD + ctx->lookahead;
+    else if (use_threads && ctx->thread_mode == AFTEN_THREAD_MODE_PIPELINE)
+        ctx->n_tctx = A52_PIPELINE_STAGES + ctx->lookahead;
+    ctx->tctx = calloc(sizeof(A52ThreadContext), ctx->n_tctx);
+
+    for (j = 0; j < ctx->n_tctx; j++) {
         A52ThreadContext *cur_tctx = &ctx->tctx[j];
         cur_tctx->ctx = ctx;
         cur_tctx->thread_num = j;
+        cur_tctx->state = START;
+        cur_tctx->input = &ctx->input;
 
         mdct_thread_init(cur_tctx);
 
-        cur_tctx->bit_cnt = 0;
-        cur_tctx->sample_cnt = 0;
-
-        cur_tctx->last_quality = last_quality;
-
-        if (ctx->n_threads > 1) {
-            cur_tctx->state = START;
-
-            posix_cond_init(&cur_tctx->ts.enter_cond);
-            posix_cond_init(&cur_tctx->ts.confirm_cond);
-            posix_cond_init(&cur_tctx->ts.samples_cond);
-
-            posix_mutex_init(&cur_tctx->ts.enter_mutex);
-            posix_mutex_init(&cur_tctx->ts.confirm_mutex);
-
-            windows_event_init(&cur_tctx->ts.ready_event);
-            windows_event_init(&cur_tctx->ts.enter_event);
-            windows_event_init(&cur_tctx->ts.samples_event);
-
-            posix_mutex_lock(&cur_tctx->ts.enter_mutex);
-            thread_create(&cur_tctx->ts.thread, threaded_worker, cur_tctx);
-            posix_cond_wait(&cur_tctx->ts.enter_cond, &cur_tctx->ts.enter_mutex);
-            posix_mutex_unlock(&cur_tctx->ts.enter_mutex);
-            windows_event_wait(&cur_tctx->ts.ready_event);
-            windows_event_set(&cur_tctx->ts.ready_event);
-        }
-    }
-    for (j = 0; j < ctx->n_threads; j++) {
-#ifdef HAVE_POSIX_THREADS
-        ctx->tctx[j].ts.next_samples_cond = &ctx->tctx[(j + 1) % ctx->n_threads].ts.samples_cond;
-#endif
-#ifdef HAVE_WINDOWS_THREADS
-        ctx->tctx[j].ts.next_samples_event = &ctx->tctx[(j + 1) % ctx->n_threads].ts.samples_event;
+#ifndef NO_THREADS
+        cur_tctx->task.arg = cur_tctx;
 #endif
     }
-    if (ctx->n_threads > 1) {
-        posix_mutex_init(&ctx->ts.samples_mutex);
-        windows_cs_init(&ctx->ts.samples_cs);
+#ifndef NO_THREADS
+    if (use_threads) {
+        // spinning only makes sense with more than one cpu
+        int spin_count = get_ncpus() > 1 ? s->system.spin_count : 0;
+        int n_workers = ctx->n_threads;
+
+        a52_waiter_init(&ctx->ts.waiter);
+        thread_mutex_init(&ctx->ts.la.mutex);
+        ctx->ts.la.depth = ctx->lookahead;
+        init_stages(ctx);
+        if (ctx->thread_mode == AFTEN_THREAD_MODE_CHANNEL) {
+            // the calling thread encodes one of the channels itself
+            n_workers--;
+            ctx->tctx->channel_tasks = 1;
+            for (i = 0; i < ctx->n_all_channels; i++) {
+                A52ChannelTask *cht = &ctx->ts.ch_tasks[i];
+                cht->task.arg = cht;
+                cht->tctx = ctx->tctx;
+                cht->ch = i;
+                mdct_tctx_init(&cht->mdct_tctx_512, &ctx->mdct_ctx_512);
+                mdct_tctx_init(&cht->mdct_tctx_256, &ctx->mdct_ctx_256);
+            }
+        }
+        if (ctx->ts.pool) {
+            atomic_add(&ctx->ts.pool->n_attached, 1);
+            ctx->ts.sched = &ctx->ts.pool->sched;
+        } else {
+            if (a52_sched_init(&ctx->ts.private_sched, n_workers, spin_count)) {
+                fprintf(stderr, "error starting encoder threads\n");
+                return -1;
+            }
+            ctx->ts.sched = &ctx->ts.private_sched;
+        }
     }
+#endif
 
     switch(s->mode) {
     case AFTEN_ENCODE:
 #ifndef NO_THREADS
         ctx->prepare_work = prepare_encode;
 #endif
+        ctx->serial_process_frame = copy_samples;
         ctx->begin_process_frame = begin_encode_frame;
         // copy initial samples
         if (s->initial_samples) {
@@ -576,18 +667,16 @@ found:
             convert_samples_from_src(&ctx->tctx[0], samples, A52_SAMPLES_PER_FRAME);
             free(samples);
             // copy samples with filters applied
-            // HACK: set threads temporarily to 1 to avoid locking
-            ctx->n_threads = 1;
             copy_samples(&ctx->tctx[0]);
-            ctx->n_threads = s->system.n_threads;
         }
         break;
     case AFTEN_TRANSCODE:
 #ifndef NO_THREADS
         ctx->prepare_work = prepare_transcode;
 #endif
+        ctx->serial_process_frame = NULL;
         ctx->begin_process_frame = begin_transcode_frame;
-        for (j = 0; j < ctx->n_threads; j++) {
+        for (j = 0; j < ctx->n_tctx; j++) {
             A52ThreadContext *tctx = ctx->tctx + j;
             tctx->dctx = calloc(sizeof(A52DecodeContext), 1);
             a52_decode_init_thread(tctx);
@@ -635,6 +724,7 @@ frame_init(A52ThreadContext *tctx)
     if (ctx->lfe)
         frame->ncoefs[ctx->lfe_channel] = 7;
 
+    frame->frame_num = tctx->input->frame_cnt++;
     frame->frame_bits = 0;
     frame->exp_bits = 0;
     frame->mant_bits = 0;
@@ -646,6 +736,15 @@ frame_init(A52ThreadContext *tctx)
     frame->dbkneecod = 2;
     frame->floorcod = 7;
 
+    // read bit allocation table values
+    frame->bit_alloc.fscod = ctx->fscod;
+    frame->bit_alloc.halfratecod = ctx->halfratecod;
+    frame->bit_alloc.sdecay = a52_slow_decay_tab[frame->sdecaycod] >> ctx->halfratecod;
+    frame->bit_alloc.fdecay = a52_fast_decay_tab[frame->fdecaycod] >> ctx->halfratecod;
+    frame->bit_alloc.sgain = a52_slow_gain_tab[frame->sgaincod];
+    frame->bit_alloc.dbknee = a52_db_per_bit_tab[frame->dbkneecod];
+    frame->bit_alloc.floor = a52_floor_tab[frame->floorcod];
+
     return 0;
 }
 
@@ -995,6 +1094,7 @@ static void
 copy_samples(A52ThreadContext *tctx)
 {
     A52Context *ctx = tctx->ctx;
+    A52InputState *in = tctx->input;
     A52Frame *frame = &tctx->frame;
     FLOAT buffer[A52_SAMPLES_PER_FRAME];
     FLOAT *in_audio;
@@ -1003,64 +1103,48 @@ copy_samples(A52ThreadContext *tctx)
     int ch, blk;
 #define SWAP_BUFFERS temp=in_audio;in_audio=out_audio;out_audio=temp;
 
-#ifndef NO_THREADS
-    if (ctx->n_threads > 1) {
-        posix_mutex_lock(&ctx->ts.samples_mutex);
-
-        windows_cs_enter(&ctx->ts.samples_cs);
-
-        while (ctx->ts.samples_thread_num != tctx->thread_num) {
-            posix_cond_wait(&tctx->ts.samples_cond, &ctx->ts.samples_mutex);
-
-            windows_cs_leave(&ctx->ts.samples_cs);
-            windows_event_wait(&tctx->ts.samples_event);
-            windows_cs_enter(&ctx->ts.samples_cs);
-        }
-        windows_event_reset(&tctx->ts.samples_event);
-    }
-#endif
     for (ch = 0; ch < ctx->n_all_channels; ch++) {
         out_audio = buffer;
         in_audio = frame->input_audio[ch];
         // DC-removal high-pass filter
         if (ctx->params.use_dc_filter) {
-            filter_run(&ctx->dc_filter[ch], out_audio, in_audio,
+            filter_run(&in->dc_filter[ch], out_audio, in_audio,
                        A52_SAMPLES_PER_FRAME);
             SWAP_BUFFERS
         }
         if (ch < ctx->n_channels) {
             // channel bandwidth filter
             if (ctx->params.use_bw_filter) {
-                filter_run(&ctx->bw_filter[ch], out_audio, in_audio,
+                filter_run(&in->bw_filter[ch], out_audio, in_audio,
                            A52_SAMPLES_PER_FRAME);
                 SWAP_BUFFERS
             }
             // block-switching high-pass filter
             if (ctx->params.use_block_switching) {
-                filter_run(&ctx->bs_filter[ch], out_audio, in_audio,
+                filter_run(&in->bs_filter[ch], out_audio, in_audio,
                            A52_SAMPLES_PER_FRAME);
                 memcpy(frame->blocks[0].transient_samples[ch],
-                       ctx->last_transient_samples[ch], 256 * sizeof(FLOAT));
+                       in->last_transient_samples[ch], 256 * sizeof(FLOAT));
                 memcpy(&frame->blocks[0].transient_samples[ch][256], out_audio,
                        256 * sizeof(FLOAT));
                 for (blk = 1; blk < A52_NUM_BLOCKS; blk++) {
                     memcpy(frame->blocks[blk].transient_samples[ch],
                            &out_audio[256*(blk-1)], 512 * sizeof(FLOAT));
                 }
-                memcpy(ctx->last_transient_samples[ch],
+                memcpy(in->last_transient_samples[ch],
                        &out_audio[256*5], 256 * sizeof(FLOAT));
             }
         } else {
             // LFE bandwidth low-pass filter
             if (ctx->params.use_lfe_filter) {
                 assert(ch == ctx->lfe_channel);
-                filter_run(&ctx->lfe_filter, out_audio, in_audio,
+                filter_run(&in->lfe_filter, out_audio, in_audio,
                            A52_SAMPLES_PER_FRAME);
                 SWAP_BUFFERS
             }
         }
 
-        memcpy(frame->blocks[0].input_samples[ch], ctx->last_samples[ch],
+        memcpy(frame->blocks[0].input_samples[ch], in->last_samples[ch],
                256 * sizeof(FLOAT));
         memcpy(&frame->blocks[0].input_samples[ch][256], in_audio,
                256 * sizeof(FLOAT));
@@ -1068,21 +1152,9 @@ copy_samples(A52ThreadContext *tctx)
             memcpy(frame->blocks[blk].input_samples[ch], &in_audio[256*(blk-1)],
                    512 * sizeof(FLOAT));
         }
-        memcpy(ctx->last_samples[ch],
+        memcpy(in->last_samples[ch],
                &in_audio[256*5], 256 * sizeof(FLOAT));
     }
-#ifndef NO_THREADS
-    if (ctx->n_threads > 1) {
-        ++ctx->ts.samples_thread_num;
-        ctx->ts.samples_thread_num %= ctx->n_threads;
-
-        posix_cond_signal(tctx->ts.next_samples_cond);
-        posix_mutex_unlock(&ctx->ts.samples_mutex);
-
-        windows_event_set(tctx->ts.next_samples_event);
-        windows_cs_leave(&ctx->ts.samples_cs);
-    }
-#endif
 #undef SWAP_BUFFERS
 }
 
@@ -1132,35 +1204,86 @@ detect_transient(FLOAT *in)
     return 0;
 }
 
+/**
+ * Transforms all blocks of channels start to end-1.  Long blocks are
+ * collected and handed to the MDCT in batches, so that a SIMD batch
+ * transform can work on several of them at once.  Only coefficients below
+ * ncoefs are computed; channels with very few of them, like LFE, use the
+ * direct transform instead.
+ */
 static void
-generate_coefs(A52ThreadContext *tctx)
+generate_coefs_range(A52ThreadContext *tctx, int start, int end,
+                     MDCTThreadContext *tmdct_512, MDCTThreadContext *tmdct_256)
 {
     A52Context *ctx = tctx->ctx;
     A52Block *block;
-    void (*mdct_256)(struct A52ThreadContext *tctx, FLOAT *out, FLOAT *in) =
+    void (*mdct_256)(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in) =
         ctx->mdct_ctx_256.mdct;
-    void (*mdct_512)(struct A52ThreadContext *tctx, FLOAT *out, FLOAT *in) =
-        ctx->mdct_ctx_512.mdct;
-    int blk, ch, i;
-
-    for (ch = 0; ch < ctx->n_all_channels; ch++) {
+    FLOAT *batch_in[MDCT_MAX_BATCH];
+    FLOAT *batch_out[MDCT_MAX_BATCH];
+    int n_batch = 0;
+    int batch_ncoefs = 0;
+    int ch, blk, i;
+
+    for (ch = start; ch < end; ch++) {
+        int ncoefs = tctx->frame.ncoefs[ch];
         for (blk = 0; blk < A52_NUM_BLOCKS; blk++) {
             block = &tctx->frame.blocks[blk];
-            if (ctx->params.use_block_switching)
+            // LFE is always coded with long blocks
+            if (ctx->params.use_block_switching && ch != ctx->lfe_channel)
                 block->blksw[ch] = detect_transient(block->transient_samples[ch]);
             else
                 block->blksw[ch] = 0;
-            ctx->winf.apply_a52_window(block->input_samples[ch]);
-            if (block->blksw[ch])
-                mdct_256(tctx, block->mdct_coef[ch], block->input_samples[ch]);
-            else
-                mdct_512(tctx, block->mdct_coef[ch], block->input_samples[ch]);
+            if (block->blksw[ch]) {
+                mdct_256(tmdct_256, block->mdct_coef[ch], block->input_samples[ch]);
+                continue;
+            }
+            if (ncoefs <= MDCT_DIRECT_MAX_COEFS) {
+                ctx->mdct_ctx_512.mdct_direct(&ctx->mdct_ctx_512, block->mdct_coef[ch],
+                                              block->input_samples[ch], ncoefs);
+                continue;
+            }
+            batch_in[n_batch] = block->input_samples[ch];
+            batch_out[n_batch] = block->mdct_coef[ch];
+            batch_ncoefs = MAX(batch_ncoefs, ncoefs);
+            if (++n_batch == MDCT_MAX_BATCH) {
+                ctx->mdct_ctx_512.mdct_batch(tmdct_512, batch_out, batch_in,
+                                             n_batch, batch_ncoefs);
+                n_batch = 0;
+                batch_ncoefs = 0;
+            }
+        }
+    }
+    if (n_batch) {
+        ctx->mdct_ctx_512.mdct_batch(tmdct_512, batch_out, batch_in,
+                                     n_batch, batch_ncoefs);
+    }
+
+    for (ch = start; ch < end; ch++) {
+        for (blk = 0; blk < A52_NUM_BLOCKS; blk++) {
+            block = &tctx->frame.blocks[blk];
             for (i = tctx->frame.ncoefs[ch]; i < 256; i++)
                 block->mdct_coef[ch][i] = 0.0;
         }
     }
 }
 
+#ifndef NO_THREADS
+static void
+generate_coefs_ch(A52ThreadContext *tctx, int ch, MDCTThreadContext *tmdct_512,
+                  MDCTThreadContext *tmdct_256)
+{
+    generate_coefs_range(tctx, ch, ch+1, tmdct_512, tmdct_256);
+}
+#endif
+
+static void
+generate_coefs(A52ThreadContext *tctx)
+{
+    generate_coefs_range(tctx, 0, tctx->ctx->n_all_channels,
+                         &tctx->mdct_tctx_512, &tctx->mdct_tctx_256);
+}
+
 static void
 calc_rematrixing(A52ThreadContext *tctx)
 {
@@ -1215,21 +1338,27 @@ calc_rematrixing(A52ThreadContext *tctx)
     }
 }
 
-/** Adjust for fractional frame sizes in CBR mode */
+/**
+ * Adjust for fractional frame sizes in CBR mode.
+ * A frame ideally holds frame_size_min + q / srate words, where
+ * q = (bit_rate * 96000) % srate.  Frame n is padded by one word when the
+ * frames before it are smaller than n ideal frames, so ceil(n * q / srate)
+ * of the frames 0 to n are padded.  This only depends on the frame number,
+ * so frames can be sized in any order.  The pattern repeats every srate
+ * frames, which keeps the products in range.
+ */
 static void
 adjust_frame_size(A52ThreadContext *tctx)
 {
     A52Context *ctx = tctx->ctx;
     A52Frame *f = &tctx->frame;
-    uint32_t kbps = f->bit_rate * 1000;
     uint32_t srate = ctx->sample_rate;
-    int add;
+    uint32_t q = (f->bit_rate * 96000) % srate;
+    uint32_t n = f->frame_num % srate;
+    int add = 0;
 
-    while (tctx->bit_cnt >= kbps && tctx->sample_cnt >= srate) {
-        tctx->bit_cnt -= kbps;
-        tctx->sample_cnt -= srate;
-    }
-    add = !!(tctx->bit_cnt * srate < tctx->sample_cnt * kbps);
+    if (n > 0)
+        add = ((n * q + srate - 1) / srate) - (((n-1) * q + srate - 1) / srate);
     f->frame_size = f->frame_size_min + add;
 }
 
@@ -1282,8 +1411,6 @@ begin_transcode_frame(A52ThreadContext *tctx)
 static int
 begin_encode_frame(A52ThreadContext *tctx)
 {
-    copy_samples(tctx);
-
     calculate_dynrng(tctx);
 
     generate_coefs(tctx);
@@ -1291,17 +1418,34 @@ begin_encode_frame(A52ThreadContext *tctx)
     return 0;
 }
 
+/** frame setup and the stages which depend on the previous frame */
 static int
-process_frame(A52ThreadContext *tctx, uint8_t *output_frame_buffer)
+process_frame_serial(A52ThreadContext *tctx)
 {
     A52Context *ctx = tctx->ctx;
-    A52Frame *frame = &tctx->frame;
 
     if (frame_init(tctx)) {
         fprintf(stderr, "Encoding has not properly initialized\n");
         return -1;
     }
 
+    if (ctx->serial_process_frame)
+        ctx->serial_process_frame(tctx);
+
+    return 0;
+}
+
+/** transform and exponent processing */
+static int
+process_frame_analysis(A52ThreadContext *tctx)
+{
+    A52Context *ctx = tctx->ctx;
+
+#ifndef NO_THREADS
+    if (tctx->channel_tasks)
+        return process_frame_channels(tctx);
+#endif
+
     if (ctx->begin_process_frame(tctx))
         return -1;
 
@@ -1310,20 +1454,39 @@ process_frame(A52ThreadContext *tctx, uint8_t *output_frame_buffer)
     if (ctx->acmod == A52_ACMOD_STEREO)
         calc_rematrixing(tctx);
 
+    a52_process_exponents(tctx);
+
     // variable bandwidth
     if (ctx->params.bwcode == -2) {
-        // process exponents at full bandwidth
-        a52_process_exponents(tctx);
-        // run bit allocation at q=240 to calculate bandwidth
+        // run bit allocation at q=240 to calculate bandwidth.  the exponents
+        // and strategies found at full bandwidth are kept for the lower one,
+        // only the number of exponent groups changes.  with lookahead, this
+        // is only the estimate the bandwidth is chosen from later.
         vbw_bit_allocation(tctx);
+        if (!ctx->lookahead)
+            a52_group_exponents(tctx);
     }
 
-    a52_process_exponents(tctx);
+    return 0;
+}
+
+/** bit allocation and quantization */
+static int
+process_frame_allocation(A52ThreadContext *tctx)
+{
+    A52Context *ctx = tctx->ctx;
+    A52Frame *frame = &tctx->frame;
+    int ch, sets;
+
+    // the bandwidth chosen looking ahead sets the exponent groups
+    if (ctx->lookahead)
+        a52_group_exponents(tctx);
 
     if (ctx->params.encoding_mode == AFTEN_ENC_MODE_CBR)
         adjust_frame_size(tctx);
 
-    if (compute_bit_allocation(tctx)) {
+    // channel-parallel mode has prepared the masking curves already
+    if (compute_bit_allocation(tctx, !tctx->channel_tasks)) {
         fprintf(stderr, "Error in bit allocation\n");
         tctx->framesize = 0;
         return -1;
@@ -1331,15 +1494,24 @@ process_frame(A52ThreadContext *tctx, uint8_t *output_frame_buffer)
 
     quantize_mantissas(tctx);
 
-    // increment counters
-    tctx->bit_cnt += frame->frame_size * 16;
-    tctx->sample_cnt += A52_SAMPLES_PER_FRAME;
-
     // update encoding status
     tctx->status.quality = frame->quality;
     tctx->status.bit_rate = frame->bit_rate;
     tctx->status.bwcode = frame->bwcode;
+    sets = 0;
+    for (ch = 0; ch < ctx->n_channels; ch++)
+        sets += frame->expstr_search[ch];
+    tctx->status.expstr_search_avg = (float)sets / ctx->n_channels;
+    tctx->status.snr_iterations = frame->snr_iterations;
+    tctx->status.snr_cache_hits = frame->snr_cache_hits;
 
+    return 0;
+}
+
+/** bitstream output */
+static int
+process_frame_packing(A52ThreadContext *tctx, uint8_t *output_frame_buffer)
+{
     output_frame_header(tctx, output_frame_buffer);
     output_audio_blocks(tctx);
     tctx->framesize = output_frame_end(tctx);
@@ -1347,6 +1519,25 @@ process_frame(A52ThreadContext *tctx, uint8_t *output_frame_buffer)
     return 0;
 }
 
+/** bit allocation, quantization and bitstream output */
+static int
+process_frame_output(A52ThreadContext *tctx, uint8_t *output_frame_buffer)
+{
+    if (process_frame_allocation(tctx))
+        return -1;
+
+    return process_frame_packing(tctx, output_frame_buffer);
+}
+
+static int
+process_frame(A52ThreadContext *tctx, uint8_t *output_frame_buffer)
+{
+    if (process_frame_serial(tctx) || process_frame_analysis(tctx))
+        return -1;
+
+    return process_frame_output(tctx, output_frame_buffer);
+}
+
 static int
 convert_samples_from_src(A52ThreadContext *tctx, const void *vsrc, int count)
 {
@@ -1361,124 +1552,454 @@ convert_samples_from_src(A52ThreadContext *tctx, const void *vsrc, int count)
 }
 
 #ifndef NO_THREADS
-static int
-threaded_worker(void* vtctx)
+/*
+ * Threaded encoding
+ *
+ * Every frame in flight owns one A52ThreadContext and passes through the
+ * stages in ctx->ts.stages, each of which runs as a task on the
+ * work-stealing scheduler.  An ordered stage sees the frames one at a time
+ * and in order: frames queue up in its ring, and finishing the stage for
+ * one frame starts it for the next one.  Other stages only touch their own
+ * thread context and can run for several frames at once on any worker.
+ *
+ * In frame mode, only the serial stage (frame setup and the stateful input
+ * filters) is ordered, and analysis and output of many frames run side by
+ * side.  In pipeline mode, all stages are ordered, so each of them works on
+ * a different frame, like an assembly line.  The caller collects finished
+ * frames in submission order.
+ *
+ * With lookahead, frames are held after the analysis until the frames after
+ * them have been analyzed too, and then go on to the bit allocation in
+ * order.  The bandwidth only depends on the estimates of those frames, so
+ * it does not change with the number of threads or the thread mode.
+ */
+
+static void stage_task(A52Task *task, int worker_num);
+static void hold_frame(A52ThreadContext *tctx, int err, int worker_num);
+
+static void
+finish_frame(A52ThreadContext *tctx, int err)
 {
-    A52ThreadContext *tctx;
+    if (err)
+        tctx->state = ABORT;
+    a52_sched_signal(&tctx->ctx->ts.waiter, &tctx->done, 1);
+}
 
-#ifdef MINGW_ALIGN_STACK_HACK
-    asm volatile (
-        "movl %%esp, %%ecx\n"
-        "andl $15, %%ecx\n"
-        "subl %%ecx, %%esp\n"
-        "pushl %%ecx\n"
-        "pushl %%ecx\n"
-        "pushl %%ecx\n"
-        "pushl %%ecx\n"
-        : : : "%esp","%ecx");
-#endif
+/**
+ * Takes over an ordered stage if it is idle and a frame is waiting for it.
+ * Only the owner of the stage pops from its ring, which keeps the ring
+ * single-consumer.
+ */
+static A52ThreadContext *
+claim_stage(A52Stage *stage)
+{
+    A52ThreadContext *next;
+
+    while (!a52_ring_empty(&stage->ring) && atomic_cas(&stage->active, 0, 1)) {
+        next = a52_ring_pop(&stage->ring);
+        if (next)
+            return next;
+        // somebody else took the frame before we got the stage
+        stage->active = 0;
+        memory_barrier();
+    }
 
-    tctx = vtctx;
-    ++tctx->ctx->ts.threads_running;//no need to lock, as thread creater waits
-    posix_mutex_lock(&tctx->ts.enter_mutex);
-    posix_cond_signal(&tctx->ts.enter_cond);
-    while (1) {
-        posix_cond_wait(&tctx->ts.enter_cond, &tctx->ts.enter_mutex);
-        posix_mutex_lock(&tctx->ts.confirm_mutex);
-        posix_cond_signal(&tctx->ts.confirm_cond);
-        posix_mutex_unlock(&tctx->ts.confirm_mutex);
-
-        windows_event_set(&tctx->ts.ready_event);
-        windows_event_wait(&tctx->ts.enter_event);
-        /* end thread if nothing to encode */
-        if (tctx->state == END) {
-            tctx->framesize = 0;
-            break;
+    return NULL;
+}
+
+/** hands an ordered stage over to the next frame waiting for it */
+static void
+leave_stage(A52Context *ctx, A52Stage *stage, int worker_num)
+{
+    A52ThreadContext *next;
+
+    next = a52_ring_pop(&stage->ring);
+    if (!next) {
+        stage->active = 0;
+        memory_barrier();
+        // a frame might have been queued without seeing us release the stage
+        next = claim_stage(stage);
+    }
+    if (next)
+        a52_sched_submit(ctx->ts.sched, &next->task, worker_num);
+}
+
+/** queues a frame for its current stage */
+static void
+enter_stage(A52ThreadContext *tctx, int worker_num)
+{
+    A52Context *ctx = tctx->ctx;
+    A52Stage *stage = &ctx->ts.stages[tctx->stage];
+    A52ThreadContext *next;
+
+    tctx->task.run = stage_task;
+    if (!stage->ordered) {
+        a52_sched_submit(ctx->ts.sched, &tctx->task, worker_num);
+        return;
+    }
+    a52_ring_push(&stage->ring, tctx);
+    // start the stage unless a worker is already running it
+    next = claim_stage(stage);
+    if (next)
+        a52_sched_submit(ctx->ts.sched, &next->task, worker_num);
+}
+
+static void
+stage_task(A52Task *task, int worker_num)
+{
+    A52ThreadContext *tctx = task->arg;
+    A52Context *ctx = tctx->ctx;
+    A52Stage *stage = &ctx->ts.stages[tctx->stage];
+    int err;
+
+    err = stage->run(tctx);
+
+    // the next frame is queued before this frame's next stage, so idle
+    // workers steal it first
+    if (stage->ordered)
+        leave_stage(ctx, stage, worker_num);
+
+    // a frame which fails before the lookahead is held as well, since the
+    // frames before it wait for it
+    if (ctx->ts.la.depth && tctx->stage < ctx->ts.la.stage &&
+            (err || tctx->stage + 1 == ctx->ts.la.stage)) {
+        hold_frame(tctx, err, worker_num);
+        return;
+    }
+
+    if (err || ++tctx->stage == ctx->ts.n_stages) {
+        finish_frame(tctx, err);
+        return;
+    }
+    enter_stage(tctx, worker_num);
+}
+
+static void
+submit_frame(A52ThreadContext *tctx)
+{
+    tctx->done = 0;
+    tctx->stage = 0;
+    enter_stage(tctx, -1);
+}
+
+/**
+ * Sets the bandwidth of the next frame to release, from its own estimate
+ * and those of the n frames after it.  It is never above the frame's own
+ * estimate, at most one code above the bandwidth of the frame before it,
+ * and low enough to come down one code per frame to the estimate of every
+ * frame ahead.
+ */
+static void
+lookahead_bandwidth(A52Context *ctx, int n)
+{
+    A52Lookahead *la = &ctx->ts.la;
+    A52Frame *frame = &ctx->tctx[la->next].frame;
+    int ch, k, bw;
+
+    bw = frame->bwcode;
+    if (la->released)
+        bw = MIN(bw, la->last_bwcode + 1);
+    for (k = 1; k <= n; k++)
+        bw = MIN(bw, ctx->tctx[(la->next + k) % ctx->n_tctx].frame.bwcode + k);
+
+    frame->bwcode = bw;
+    for (ch = 0; ch < ctx->n_channels; ch++)
+        frame->ncoefs[ch] = bw * 3 + 73;
+    la->last_bwcode = bw;
+}
+
+/**
+ * Releases the held frames, oldest first, as long as the frames they look
+ * ahead to are held too.  Called with the lookahead locked.
+ */
+static void
+release_frames(A52Context *ctx, int worker_num)
+{
+    A52Lookahead *la = &ctx->ts.la;
+    A52ThreadContext *tctx;
+    int k, n;
+
+    while ((tctx = &ctx->tctx[la->next])->held) {
+        // the stream may end before the lookahead does
+        n = la->depth;
+        if (la->stopped)
+            n = 0;
+        else if (la->ended)
+            n = MIN(n, la->total - la->released - 1);
+        for (k = 1; k <= n; k++) {
+            if (!ctx->tctx[(la->next + k) % ctx->n_tctx].held)
+                return;
         }
-        if (tctx->state == ABORT) {
-            tctx->framesize = -1;
-            break;
+
+        if (!tctx->held_err)
+            lookahead_bandwidth(ctx, n);
+        tctx->held = 0;
+        la->released++;
+        la->next = (la->next + 1) % ctx->n_tctx;
+        // entering the next stage under the lock keeps the frames in order
+        if (tctx->held_err) {
+            finish_frame(tctx, tctx->held_err);
+        } else {
+            tctx->stage = la->stage;
+            enter_stage(tctx, worker_num);
         }
-        if (process_frame(tctx, tctx->frame_buffer))
-            tctx->state = ABORT;
     }
-    posix_mutex_unlock(&tctx->ts.enter_mutex);
+}
 
-    windows_event_set(&tctx->ts.ready_event);
+/** holds a frame which has been analyzed, or failed before */
+static void
+hold_frame(A52ThreadContext *tctx, int err, int worker_num)
+{
+    A52Lookahead *la = &tctx->ctx->ts.la;
+
+    thread_mutex_lock(&la->mutex);
+    tctx->held = 1;
+    tctx->held_err = err;
+    // nothing after a failed frame gets encoded, so nothing is looked ahead
+    if (err)
+        la->stopped = 1;
+    release_frames(tctx->ctx, worker_num);
+    thread_mutex_unlock(&la->mutex);
+}
 
-#ifdef MINGW_ALIGN_STACK_HACK
-    asm volatile (
-        "popl %%ecx\n"
-        "popl %%ecx\n"
-        "popl %%ecx\n"
-        "popl %%ecx\n"
-        "addl %%ecx, %%esp\n"
-        : : : "%esp", "%ecx");
-#endif
+/**
+ * Releases the frames which wait for the end of the stream, or with stop
+ * set, all frames without looking ahead any further.
+ */
+static void
+flush_lookahead(A52Context *ctx, int stop)
+{
+    A52Lookahead *la = &ctx->ts.la;
 
-    return 0;
+    thread_mutex_lock(&la->mutex);
+    if (stop) {
+        la->stopped = 1;
+    } else {
+        la->ended = 1;
+        la->total = la->submitted;
+    }
+    release_frames(ctx, -1);
+    thread_mutex_unlock(&la->mutex);
+}
+
+static int
+output_stage(A52ThreadContext *tctx)
+{
+    return process_frame_output(tctx, tctx->frame_buffer);
+}
+
+static int
+pipeline_analysis_stage(A52ThreadContext *tctx)
+{
+    if (process_frame_serial(tctx))
+        return -1;
+
+    return process_frame_analysis(tctx);
+}
+
+static int
+pipeline_packing_stage(A52ThreadContext *tctx)
+{
+    return process_frame_packing(tctx, tctx->frame_buffer);
+}
+
+static void
+set_stage(A52Context *ctx, int (*run)(A52ThreadContext *tctx), int ordered)
+{
+    A52Stage *stage = &ctx->ts.stages[ctx->ts.n_stages++];
+
+    stage->run = run;
+    stage->ordered = ordered;
+}
+
+/** sets up the stages of the thread mode */
+static void
+init_stages(A52Context *ctx)
+{
+    ctx->ts.n_stages = 0;
+    if (ctx->thread_mode == AFTEN_THREAD_MODE_PIPELINE) {
+        set_stage(ctx, pipeline_analysis_stage, 1);
+        ctx->ts.la.stage = ctx->ts.n_stages;
+        set_stage(ctx, process_frame_allocation, 1);
+        set_stage(ctx, pipeline_packing_stage, 1);
+    } else {
+        set_stage(ctx, process_frame_serial, 1);
+        set_stage(ctx, process_frame_analysis, 0);
+        ctx->ts.la.stage = ctx->ts.n_stages;
+        set_stage(ctx, output_stage, 0);
+    }
+}
+
+/** waits for all frames in flight and discards them */
+static int
+drain_frames(A52Context *ctx)
+{
+    int i;
+    int in_flight = 0;
+
+    if (ctx->ts.la.depth)
+        flush_lookahead(ctx, 1);
+    for (i = 0; i < ctx->n_tctx; i++) {
+        A52ThreadContext *tctx = &ctx->tctx[i];
+        if (tctx->state == WORK || tctx->state == ABORT) {
+            a52_sched_wait(ctx->ts.sched, &ctx->ts.waiter, &tctx->done);
+            tctx->state = END;
+            in_flight = 1;
+        }
+    }
+
+    return in_flight;
 }
 
 static int
 process_frame_parallel(AftenContext *s, uint8_t *frame_buffer, const void *samples, int count, int *info)
 {
     A52Context *ctx = s->private_context;
+    A52ThreadContext *tctx = &ctx->tctx[ctx->ts.current_tctx_num];
     int framesize = 0;
 
-    if (!ctx->ts.threads_running)
+    if (ctx->ts.aborted)
         return 0;
 
-    do {
-        A52ThreadContext *tctx = &ctx->tctx[ctx->ts.current_thread_num];
+    if (tctx->state == WORK || tctx->state == ABORT) {
+        a52_sched_wait(ctx->ts.sched, &ctx->ts.waiter, &tctx->done);
+        if (tctx->state == ABORT) {
+            ctx->ts.aborted = 1;
+            drain_frames(ctx);
+            return -1;
+        }
+        framesize = tctx->framesize;
+    }
 
-        posix_mutex_lock(&tctx->ts.enter_mutex);
+    if (ctx->prepare_work(tctx, samples, count, info)) {
+        // need more data
+        return -1;
+    }
 
-        windows_event_wait(&tctx->ts.ready_event);
+    if (framesize > 0) {
+        memcpy(frame_buffer, tctx->frame_buffer, framesize);
+        // update encoding status
+        s->status.quality   = tctx->status.quality;
+        s->status.bit_rate  = tctx->status.bit_rate;
+        s->status.bwcode    = tctx->status.bwcode;
+        s->status.expstr_search_avg = tctx->status.expstr_search_avg;
+        s->status.snr_iterations = tctx->status.snr_iterations;
+        s->status.snr_cache_hits = tctx->status.snr_cache_hits;
+        s->status.thread_parks = ctx->ts.sched->n_parks;
+    }
 
-        if (tctx->state == ABORT || ctx->ts.threads_to_abort) {
-            tctx->state = ABORT;
-            framesize = -1;
-            if (!ctx->ts.threads_to_abort)
-                ctx->ts.threads_to_abort = ctx->ts.threads_running;
-            --ctx->ts.threads_to_abort;
-            --ctx->ts.threads_running;
-        } else {
-            if (ctx->prepare_work(tctx, samples, count, info)) {
-                // need more data
-                posix_mutex_unlock(&tctx->ts.enter_mutex);
+    if (tctx->state == WORK) {
+        submit_frame(tctx);
+        ctx->ts.la.submitted++;
+    } else if (tctx->state == END && ctx->ts.la.depth && !ctx->ts.la.ended) {
+        flush_lookahead(ctx, 0);
+    }
 
-                return -1;
-            }
-            if (tctx->state == START) {
-                tctx->state = WORK;
-            } else {
-                if (tctx->framesize > 0) {
-                    framesize = tctx->framesize;
-                    memcpy(frame_buffer, tctx->frame_buffer, framesize);
-                   // update encoding status
-                    s->status.quality   = tctx->status.quality;
-                    s->status.bit_rate  = tctx->status.bit_rate;
-                    s->status.bwcode    = tctx->status.bwcode;
-                } else {
-                    posix_mutex_unlock(&tctx->ts.enter_mutex);
-                    goto end;
-                }
-            }
-        }
-        posix_mutex_lock(&tctx->ts.confirm_mutex);
-        posix_cond_signal(&tctx->ts.enter_cond);
-        posix_mutex_unlock(&tctx->ts.enter_mutex);
-        posix_cond_wait(&tctx->ts.confirm_cond, &tctx->ts.confirm_mutex);
-        posix_mutex_unlock(&tctx->ts.confirm_mutex);
-
-        windows_event_set(&tctx->ts.enter_event);
-end:
-        ++ctx->ts.current_thread_num;
-        ctx->ts.current_thread_num %= ctx->n_threads;
-    } while (ctx->ts.threads_to_abort);
+    ++ctx->ts.current_tctx_num;
+    ctx->ts.current_tctx_num %= ctx->n_tctx;
 
     return framesize;
 }
+
+/*
+ * Channel-parallel encoding
+ *
+ * Only one frame is encoded at a time.  The transform, exponent and masking
+ * stages of each channel are spread over the workers and the calling thread,
+ * which waits at a barrier before the stages that combine the channels.  The
+ * bit allocation search and the bitstream output run on the calling thread.
+ */
+
+static void
+finish_channel(A52Context *ctx)
+{
+    if (!atomic_add(&ctx->ts.ch_pending, -1))
+        a52_sched_signal(&ctx->ts.waiter, &ctx->ts.ch_done, 1);
+}
+
+static void
+coefs_channel_task(A52Task *task, UNUSED(int worker_num))
+{
+    A52ChannelTask *cht = task->arg;
+
+    generate_coefs_ch(cht->tctx, cht->ch, &cht->mdct_tctx_512,
+                      &cht->mdct_tctx_256);
+    finish_channel(cht->tctx->ctx);
+}
+
+static void
+exponents_channel_task(A52Task *task, UNUSED(int worker_num))
+{
+    A52ChannelTask *cht = task->arg;
+
+    a52_process_exponents_ch(cht->tctx, cht->ch);
+    finish_channel(cht->tctx->ctx);
+}
+
+static void
+masks_channel_task(A52Task *task, UNUSED(int worker_num))
+{
+    A52ChannelTask *cht = task->arg;
+
+    a52_process_exponents_ch(cht->tctx, cht->ch);
+    prepare_bit_allocation_ch(cht->tctx, cht->ch);
+    finish_channel(cht->tctx->ctx);
+}
+
+static void
+prepare_channel_task(A52Task *task, UNUSED(int worker_num))
+{
+    A52ChannelTask *cht = task->arg;
+
+    prepare_bit_allocation_ch(cht->tctx, cht->ch);
+    finish_channel(cht->tctx->ctx);
+}
+
+/** runs one stage for all channels and waits until every channel is done */
+static void
+run_channel_tasks(A52Context *ctx, A52TaskFunc run)
+{
+    int ch;
+
+    ctx->ts.ch_done = 0;
+    ctx->ts.ch_pending = ctx->n_all_channels;
+    for (ch = 0; ch < ctx->n_all_channels; ch++)
+        ctx->ts.ch_tasks[ch].task.run = run;
+    for (ch = 1; ch < ctx->n_all_channels; ch++)
+        a52_sched_submit(ctx->ts.sched, &ctx->ts.ch_tasks[ch].task, -1);
+    run(&ctx->ts.ch_tasks[0].task, -1);
+
+    a52_sched_wait(ctx->ts.sched, &ctx->ts.waiter, &ctx->ts.ch_done);
+}
+
+static int
+process_frame_channels(A52ThreadContext *tctx)
+{
+    A52Context *ctx = tctx->ctx;
+
+    calculate_dynrng(tctx);
+
+    run_channel_tasks(ctx, coefs_channel_task);
+
+    compute_dither_strategy(tctx);
+
+    if (ctx->acmod == A52_ACMOD_STEREO)
+        calc_rematrixing(tctx);
+
+    // variable bandwidth
+    if (ctx->params.bwcode == -2) {
+        // the exponents are kept, see process_frame_analysis
+        run_channel_tasks(ctx, exponents_channel_task);
+        a52_group_exponents(tctx);
+        vbw_bit_allocation(tctx);
+        run_channel_tasks(ctx, prepare_channel_task);
+    } else {
+        run_channel_tasks(ctx, masks_channel_task);
+    }
+    a52_group_exponents(tctx);
+
+    return 0;
+}
 #endif
 
 #if 0
@@ -1505,6 +2026,9 @@ aften_transcode_frame(AftenContext *s, uint8_t *input_frame_buffer, int input_fr
     s->status.quality   = tctx->status.quality;
     s->status.bit_rate  = tctx->status.bit_rate;
     s->status.bwcode    = tctx->status.bwcode;
+    s->status.expstr_search_avg = tctx->status.expstr_search_avg;
+    s->status.snr_iterations = tctx->status.snr_iterations;
+    s->status.snr_cache_hits = tctx->status.snr_cache_hits;
 
     return tctx->framesize;
 }
@@ -1530,7 +2054,7 @@ aften_encode_frame(AftenContext *s, uint8_t *frame_buffer, const void *samples,
         return -1;
     }
 #ifndef NO_THREADS
-    if (ctx->n_threads > 1) {
+    if (ctx->n_tctx > 1) {
         int info;
 
         return process_frame_parallel(s, frame_buffer, samples, count, &info);
@@ -1549,10 +2073,394 @@ aften_encode_frame(AftenContext *s, uint8_t *frame_buffer, const void *samples,
     s->status.quality   = tctx->status.quality;
     s->status.bit_rate  = tctx->status.bit_rate;
     s->status.bwcode    = tctx->status.bwcode;
+    s->status.expstr_search_avg = tctx->status.expstr_search_avg;
+    s->status.snr_iterations = tctx->status.snr_iterations;
+    s->status.snr_cache_hits = tctx->status.snr_cache_hits;
+#ifndef NO_THREADS
+    if (ctx->ts.sched)
+        s->status.thread_parks = ctx->ts.sched->n_parks;
+#endif
 
     return tctx->framesize;
 }
 
+/*
+ * Whole-buffer and segment encoding
+ *
+ * When all input is available up front, the frames to encode are cut into
+ * chunks of consecutive frames, which the runners claim one after the
+ * other.  Every runner encodes a chunk from start to end with its own
+ * thread context and its own copy of the input state, so nothing is handed
+ * over per frame.  A chunk which does not start the stream first runs the
+ * frames before it through the input filters without encoding them, so the
+ * filter state and the transform overlap have settled when its first frame
+ * is encoded.  The input buffer need not start at the beginning of the
+ * stream, so a stream can also be split into segments which are encoded
+ * separately, e.g. on different machines.
+ *
+ * Chunks are written at their worst-case position in the output buffer and
+ * moved together once all of them are done.
+ */
+
+typedef struct A52BufferJob {
+    A52Context *ctx;
+    const uint8_t *samples;
+    int n_samples;
+    int buffer_frame;           // frame whose input samples start the buffer
+    int first_frame;            // first frame to encode
+    uint8_t *output;
+    int max_frame_bytes;
+    int n_frames;
+    int chunk_frames;
+    int n_chunks;
+    int *chunk_bytes;           // bytes written for every chunk
+    AftenStatus status;         // status after the last frame of the stream
+#ifndef NO_THREADS
+    volatile int next_chunk;
+    volatile int pending;       // runners which have not finished yet
+    volatile int done;
+#endif
+    volatile int error;
+} A52BufferJob;
+
+typedef struct A52BufferRunner {
+    A52ThreadContext tctx;
+    A52InputState input;
+    A52BufferJob *job;
+} A52BufferRunner;
+
+static int
+max_frame_bytes(A52Context *ctx)
+{
+    // the odd frame size codes are padded by one word at 44.1 kHz.  in VBR
+    // mode, frmsizecod is the largest one allowed.
+    return a52_frame_size_tab[ctx->frmsizecod+1][ctx->fscod] / 8;
+}
+
+/** loads the input samples of frame frame_num into the runner */
+static void
+buffer_load_frame(A52BufferRunner *r, int frame_num)
+{
+    A52BufferJob *job = r->job;
+    A52Context *ctx = job->ctx;
+    int start = (frame_num - job->buffer_frame) * A52_SAMPLES_PER_FRAME;
+    int count = CLIP(job->n_samples - start, 0, A52_SAMPLES_PER_FRAME);
+    const uint8_t *src = job->samples;
+
+    if (count)
+        src += (size_t)start * ctx->n_all_channels * ctx->sample_size;
+    convert_samples_from_src(&r->tctx, src, count);
+}
+
+static int
+input_state_copy(A52InputState *dst, const A52InputState *src)
+{
+    int ch;
+
+    for (ch = 0; ch < A52_MAX_CHANNELS; ch++) {
+        if (filter_copy(&dst->bs_filter[ch], &src->bs_filter[ch]) ||
+                filter_copy(&dst->dc_filter[ch], &src->dc_filter[ch]) ||
+                filter_copy(&dst->bw_filter[ch], &src->bw_filter[ch]))
+            return -1;
+    }
+    if (filter_copy(&dst->lfe_filter, &src->lfe_filter))
+        return -1;
+    dst->frame_cnt = src->frame_cnt;
+    memcpy(dst->last_samples, src->last_samples, sizeof(dst->last_samples));
+    memcpy(dst->last_transient_samples, src->last_transient_samples,
+           sizeof(dst->last_transient_samples));
+
+    return 0;
+}
+
+static void
+input_state_close(A52InputState *in)
+{
+    int ch;
+
+    for (ch = 0; ch < A52_MAX_CHANNELS; ch++) {
+        filter_close(&in->bs_filter[ch]);
+        filter_close(&in->dc_filter[ch]);
+        filter_close(&in->bw_filter[ch]);
+    }
+    filter_close(&in->lfe_filter);
+}
+
+static int
+encode_chunk(A52BufferRunner *r, int chunk)
+{
+    A52BufferJob *job = r->job;
+    A52Context *ctx = job->ctx;
+    A52ThreadContext *tctx = &r->tctx;
+    int first = job->first_frame + chunk * job->chunk_frames;
+    int last = MIN(first + job->chunk_frames, job->first_frame + job->n_frames);
+    uint8_t *out = job->output +
+                   (size_t)chunk * job->chunk_frames * job->max_frame_bytes;
+    int preroll_start = job->buffer_frame;
+    int size = 0;
+    int i;
+
+    // start over from the state the stream begins with
+    if (input_state_copy(&r->input, &ctx->input)) {
+        fprintf(stderr, "error allocating memory for input filters\n");
+        return -1;
+    }
+    // the first chunk gets all of the pre-roll the caller provided
+    if (chunk)
+        preroll_start = MAX(first - A52_PREROLL_FRAMES, preroll_start);
+    for (i = preroll_start; i < first; i++) {
+        buffer_load_frame(r, i);
+        ctx->serial_process_frame(tctx);
+    }
+    r->input.frame_cnt = first;
+
+    for (i = first; i < last; i++) {
+        buffer_load_frame(r, i);
+        if (process_frame(tctx, out + size))
+            return -1;
+        size += tctx->framesize;
+    }
+    job->chunk_bytes[chunk] = size;
+    if (chunk == job->n_chunks - 1)
+        job->status = tctx->status;
+
+    return 0;
+}
+
+/** encodes chunks until none are left */
+static void
+run_chunks(A52BufferRunner *r)
+{
+    A52BufferJob *job = r->job;
+    int chunk;
+
+#ifndef NO_THREADS
+    while (!job->error &&
+            (chunk = atomic_add(&job->next_chunk, 1) - 1) < job->n_chunks) {
+#else
+    for (chunk = 0; !job->error && chunk < job->n_chunks; chunk++) {
+#endif
+        if (encode_chunk(r, chunk))
+            job->error = 1;
+    }
+}
+
+#ifndef NO_THREADS
+static void
+buffer_runner_task(A52Task *task, UNUSED(int worker_num))
+{
+    A52BufferRunner *r = task->arg;
+    A52BufferJob *job = r->job;
+
+    run_chunks(r);
+    if (!atomic_add(&job->pending, -1))
+        a52_sched_signal(&job->ctx->ts.waiter, &job->done, 1);
+}
+#endif
+
+/** number of frames of a stream with n_samples samples */
+static int
+stream_frames(int n_samples)
+{
+    // the transform delays the output by 256 samples
+    return (n_samples + 256 + A52_SAMPLES_PER_FRAME - 1) / A52_SAMPLES_PER_FRAME;
+}
+
+/**
+ * Encodes n_frames frames from first_frame on.  The input samples start
+ * with those of frame buffer_frame, and everything before first_frame is
+ * pre-roll.
+ */
+static int
+encode_frames(AftenContext *s, uint8_t *output, int output_size,
+              const void *samples, int n_samples, int buffer_frame,
+              int first_frame, int n_frames)
+{
+    A52Context *ctx = s->private_context;
+    A52BufferJob job;
+    A52BufferRunner *runners;
+    int n_runners = 1;
+    int size, i;
+
+    if (s->mode != AFTEN_ENCODE) {
+        fprintf(stderr, "only encoding is supported with whole buffers\n");
+        return -1;
+    }
+    // every chunk is encoded one frame after the other
+    if (ctx->lookahead) {
+        fprintf(stderr, "lookahead cannot be used with whole buffers\n");
+        return -1;
+    }
+    if (ctx->last_samples_count != -1 || ctx->input.frame_cnt) {
+        fprintf(stderr, "cannot encode whole buffers with a context which has encoded frames\n");
+        return -1;
+    }
+    if (n_frames > INT_MAX / max_frame_bytes(ctx)) {
+        fprintf(stderr, "too many frames to encode at once\n");
+        return -1;
+    }
+    if (output_size < n_frames * max_frame_bytes(ctx)) {
+        fprintf(stderr, "output buffer is too small\n");
+        return -1;
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.ctx = ctx;
+    job.samples = samples;
+    job.n_samples = n_samples;
+    job.buffer_frame = buffer_frame;
+    job.first_frame = first_frame;
+    job.output = output;
+    job.max_frame_bytes = max_frame_bytes(ctx);
+    job.n_frames = n_frames;
+#ifndef NO_THREADS
+    // the calling thread works on the chunks as well
+    if (ctx->ts.sched)
+        n_runners += ctx->ts.sched->n_workers;
+#endif
+    // several chunks per runner balance the load, but every chunk adds
+    // the pre-roll to the work
+    job.n_chunks = MIN(n_runners * A52_CHUNKS_PER_RUNNER,
+                       job.n_frames / A52_MIN_CHUNK_FRAMES);
+    job.n_chunks = MAX(job.n_chunks, 1);
+    job.chunk_frames = (job.n_frames + job.n_chunks - 1) / job.n_chunks;
+    job.n_chunks = (job.n_frames + job.chunk_frames - 1) / job.chunk_frames;
+    n_runners = MIN(n_runners, job.n_chunks);
+
+    job.chunk_bytes = calloc(job.n_chunks, sizeof(int));
+    runners = calloc(n_runners, sizeof(A52BufferRunner));
+    if (!job.chunk_bytes || !runners) {
+        fprintf(stderr, "error allocating memory for whole buffer encoding\n");
+        free(job.chunk_bytes);
+        free(runners);
+        return -1;
+    }
+
+    for (i = 0; i < n_runners; i++) {
+        A52BufferRunner *r = &runners[i];
+        r->job = &job;
+        r->tctx.ctx = ctx;
+        r->tctx.thread_num = i;
+        r->tctx.state = START;
+        r->tctx.input = &r->input;
+        mdct_thread_init(&r->tctx);
+#ifndef NO_THREADS
+        r->tctx.task.arg = r;
+        r->tctx.task.run = buffer_runner_task;
+#endif
+    }
+
+#ifndef NO_THREADS
+    job.pending = n_runners;
+    for (i = 1; i < n_runners; i++)
+        a52_sched_submit(ctx->ts.sched, &runners[i].tctx.task, -1);
+    if (n_runners > 1) {
+        buffer_runner_task(&runners[0].tctx.task, -1);
+        a52_sched_wait(ctx->ts.sched, &ctx->ts.waiter, &job.done);
+    } else
+#endif
+    run_chunks(&runners[0]);
+
+    for (i = 0; i < n_runners; i++) {
+        mdct_thread_close(&runners[i].tctx);
+        input_state_close(&runners[i].input);
+    }
+    free(runners);
+
+    size = -1;
+    if (!job.error) {
+        // close the gaps left between the chunks
+        size = 0;
+        for (i = 0; i < job.n_chunks; i++) {
+            memmove(output + size,
+                    output + (size_t)i * job.chunk_frames * job.max_frame_bytes,
+                    job.chunk_bytes[i]);
+            size += job.chunk_bytes[i];
+        }
+        s->status.quality  = job.status.quality;
+        s->status.bit_rate = job.status.bit_rate;
+        s->status.bwcode   = job.status.bwcode;
+        s->status.expstr_search_avg = job.status.expstr_search_avg;
+        s->status.snr_iterations = job.status.snr_iterations;
+        s->status.snr_cache_hits = job.status.snr_cache_hits;
+#ifndef NO_THREADS
+        if (ctx->ts.sched)
+            s->status.thread_parks = ctx->ts.sched->n_parks;
+#endif
+    }
+    free(job.chunk_bytes);
+
+    return size;
+}
+
+int
+aften_encode_buffer_bound(AftenContext *s, int n_samples)
+{
+    int n_frames;
+
+    if (s == NULL || s->private_context == NULL || n_samples < 0) {
+        fprintf(stderr, "Invalid parameters passed to aften_encode_buffer_bound\n");
+        return -1;
+    }
+    n_frames = stream_frames(n_samples);
+    if (n_frames > INT_MAX / max_frame_bytes(s->private_context)) {
+        fprintf(stderr, "input too long for aften_encode_buffer\n");
+        return -1;
+    }
+
+    return n_frames * max_frame_bytes(s->private_context);
+}
+
+int
+aften_encode_buffer(AftenContext *s, uint8_t *output, int output_size,
+                    const void *samples, int n_samples)
+{
+    A52Context *ctx;
+    int size;
+
+    if (s == NULL || s->private_context == NULL || output == NULL ||
+            (samples == NULL && n_samples) || n_samples < 0) {
+        fprintf(stderr, "Invalid parameters passed to aften_encode_buffer\n");
+        return -1;
+    }
+    ctx = s->private_context;
+    size = encode_frames(s, output, output_size, samples, n_samples, 0, 0,
+                         stream_frames(n_samples));
+
+    // the stream is complete, further calls to aften_encode_frame only flush
+    ctx->last_samples_count = 0;
+    ctx->input.frame_cnt = stream_frames(n_samples);
+
+    return size;
+}
+
+int
+aften_encode_segment(AftenContext *s, uint8_t *output, int output_size,
+                     const void *samples, int n_samples, int n_preroll,
+                     int first_frame, int n_frames)
+{
+    int buffer_frame;
+
+    if (s == NULL || s->private_context == NULL || output == NULL ||
+            (samples == NULL && n_samples) || n_samples < 0 ||
+            first_frame < 0 || n_preroll < 0 || n_preroll > first_frame ||
+            n_frames < 0) {
+        fprintf(stderr, "Invalid parameters passed to aften_encode_segment\n");
+        return -1;
+    }
+    buffer_frame = first_frame - n_preroll;
+    // up to the end of the stream
+    if (!n_frames)
+        n_frames = buffer_frame + stream_frames(n_samples) - first_frame;
+    if (n_frames <= 0) {
+        fprintf(stderr, "segment passed to aften_encode_segment is empty\n");
+        return -1;
+    }
+
+    return encode_frames(s, output, output_size, samples, n_samples,
+                         buffer_frame, first_frame, n_frames);
+}
+
 int
 aften_encode_close(AftenContext *s)
 {
@@ -1563,40 +2471,30 @@ aften_encode_close(AftenContext *s)
         A52Context *ctx = s->private_context;
 
 #ifndef NO_THREADS
-        while (ctx->ts.threads_running) {
-            uint8_t frame_buffer[A52_MAX_CODED_FRAME_SIZE];
-            int info;
-
-            process_frame_parallel(s, frame_buffer, NULL, 0, &info);
-            ret_val = -1;
+        if (ctx->ts.sched) {
+            if (drain_frames(ctx))
+                ret_val = -1;
+            if (ctx->ts.pool)
+                atomic_add(&ctx->ts.pool->n_attached, -1);
+            else
+                a52_sched_close(&ctx->ts.private_sched);
+            a52_waiter_close(&ctx->ts.waiter);
+            thread_mutex_destroy(&ctx->ts.la.mutex);
+        }
+        if (ctx->thread_mode == AFTEN_THREAD_MODE_CHANNEL) {
+            int i;
+            for (i = 0; i < ctx->n_all_channels; i++) {
+                mdct_tctx_close(&ctx->ts.ch_tasks[i].mdct_tctx_512);
+                mdct_tctx_close(&ctx->ts.ch_tasks[i].mdct_tctx_256);
+            }
         }
 #endif
         if (ctx->tctx) {
-            if (ctx->n_threads == 1)
-                mdct_thread_close(&ctx->tctx[0]);
-            else {
-                int i;
-                for (i = 0; i < ctx->n_threads; i++) {
-                    A52ThreadContext *cur_tctx = ctx->tctx + i;
-                    thread_join(cur_tctx->ts.thread);
-                    mdct_thread_close(cur_tctx);
-                    posix_cond_destroy(&cur_tctx->ts.enter_cond);
-                    posix_cond_destroy(&cur_tctx->ts.confirm_cond);
-                    posix_cond_destroy(&cur_tctx->ts.samples_cond);
-
-                    posix_mutex_destroy(&cur_tctx->ts.enter_mutex);
-                    posix_mutex_destroy(&cur_tctx->ts.confirm_mutex);
-
-                    windows_event_destroy(&cur_tctx->ts.ready_event);
-                    windows_event_destroy(&cur_tctx->ts.enter_event);
-                    windows_event_destroy(&cur_tctx->ts.samples_event);
-                }
-                posix_mutex_destroy(&ctx->ts.samples_mutex);
-                windows_cs_destroy(&ctx->ts.samples_cs);
-            }
+            int i;
+            for (i = 0; i < ctx->n_tctx; i++)
+                mdct_thread_close(&ctx->tctx[i]);
             if (s->mode == AFTEN_TRANSCODE) {
-                int i;
-                for (i = 0; i < ctx->n_threads; i++) {
+                for (i = 0; i < ctx->n_tctx; i++) {
                     A52ThreadContext *cur_tctx = ctx->tctx + i;
                     a52_decode_deinit_thread(cur_tctx);
                     free(cur_tctx->dctx);
@@ -1608,11 +2506,11 @@ aften_encode_close(AftenContext *s)
         mdct_close(ctx);
 
         // close input filters
-        filter_close(&ctx->lfe_filter);
+        filter_close(&ctx->input.lfe_filter);
         for (ch = 0; ch < A52_MAX_CHANNELS; ch++) {
-            filter_close(&ctx->bs_filter[ch]);
-            filter_close(&ctx->dc_filter[ch]);
-            filter_close(&ctx->bw_filter[ch]);
+            filter_close(&ctx->input.bs_filter[ch]);
+            filter_close(&ctx->input.dc_filter[ch]);
+            filter_close(&ctx->input.bw_filter[ch]);
         }
 
         free(ctx);
@@ -1621,3 +2519,68 @@ aften_encode_close(AftenContext *s)
 
     return ret_val;
 }
+
+AftenPool *
+aften_pool_create(int n_threads, int spin_count)
+{
+#ifndef NO_THREADS
+    AftenPool *pool;
+
+    if (n_threads <= 0)
+        n_threads = get_ncpus();
+    n_threads = MIN(n_threads, MAX_NUM_THREADS);
+    // spinning only makes sense with more than one cpu
+    if (get_ncpus() == 1)
+        spin_count = 0;
+
+    pool = calloc(sizeof(AftenPool), 1);
+    if (!pool) {
+        fprintf(stderr, "error allocating memory for AftenPool\n");
+        return NULL;
+    }
+    if (a52_sched_init(&pool->sched, n_threads, spin_count)) {
+        fprintf(stderr, "error starting pool threads\n");
+        free(pool);
+        return NULL;
+    }
+
+    return pool;
+#else
+    fprintf(stderr, "libaften was built without thread support\n");
+    return NULL;
+#endif
+}
+
+int
+aften_pool_attach(AftenContext *s, AftenPool *pool)
+{
+    if (s == NULL || pool == NULL) {
+        fprintf(stderr, "NULL parameter passed to aften_pool_attach\n");
+        return -1;
+    }
+    if (s->private_context != NULL) {
+        fprintf(stderr, "aften_pool_attach must be called before aften_encode_init\n");
+        return -1;
+    }
+    s->system.pool = pool;
+
+    return 0;
+}
+
+int
+aften_pool_close(AftenPool *pool)
+{
+    if (pool == NULL)
+        return 0;
+#ifndef NO_THREADS
+    if (pool->n_attached) {
+        fprintf(stderr, "thread pool is still used by %d encoding contexts\n",
+                pool->n_attached);
+        return -1;
+    }
+    a52_sched_close(&pool->sched);
+    free(pool);
+#endif
+
+    return 0;
+}
@@ -33,34 +33,156 @@
 #include "a52.h"
 #include "bitio.h"
 #include "aften.h"
+#include "bitalloc.h"
 #include "exponent.h"
 #include "filter.h"
 #include "mdct.h"
+#include "scheduler.h"
 #include "threading.h"
 #include "window.h"
 #include "a52dec.h"
 
+/**
+ * Number of frames kept in flight per worker thread.  Having more frames
+ * than workers lets idle workers pick up later frames while a slow one is
+ * still being encoded.
+ */
+#define A52_FRAMES_PER_THREAD 2
+
+/** number of stages, and of frames in flight, in pipeline mode */
+#define A52_PIPELINE_STAGES 3
+
+/** largest number of frames variable bandwidth mode can look ahead */
+#define A52_MAX_LOOKAHEAD 32
+
+#ifndef NO_THREADS
+/*
+ * Every frame in flight can be queued for an ordered stage at the same
+ * time, so its ring must hold all of them, or enter_stage would lose one.
+ */
+#if A52_RING_SIZE < MAX_NUM_THREADS * A52_FRAMES_PER_THREAD + A52_MAX_LOOKAHEAD || \
+    A52_RING_SIZE < A52_PIPELINE_STAGES + A52_MAX_LOOKAHEAD
+#error "A52_RING_SIZE is smaller than the number of frames in flight"
+#endif
+#endif
+
+/**
+ * aften_encode_buffer cuts the stream into this many chunks per thread, so
+ * threads which finish early can take over work, but never into chunks
+ * shorter than A52_MIN_CHUNK_FRAMES, which keeps the pre-roll cheap.
+ * Before its first frame, every chunk runs A52_PREROLL_FRAMES frames
+ * through the input filters.  This is about 1 second, which lets even the
+ * 3 Hz DC filter settle to well below the precision of the samples.
+ */
+#define A52_CHUNKS_PER_RUNNER 4
+#define A52_MIN_CHUNK_FRAMES (8 * A52_PREROLL_FRAMES)
+
+/**
+ * State which the serial stage carries from one frame to the next: the
+ * input filters, the overlap of the transforms and the frame counter.
+ */
+typedef struct A52InputState {
+    uint32_t frame_cnt;         // frames started so far, only used in frame_init
+
+    FilterContext bs_filter[A52_MAX_CHANNELS];
+    FilterContext dc_filter[A52_MAX_CHANNELS];
+    FilterContext bw_filter[A52_MAX_CHANNELS];
+    FilterContext lfe_filter;
+
+    FLOAT last_samples[A52_MAX_CHANNELS][A52_SAMPLES_PER_FRAME]; // 256 would be enough, but want to use converting functions
+    FLOAT last_transient_samples[A52_MAX_CHANNELS][256];
+} A52InputState;
+
+#ifndef NO_THREADS
+/**
+ * One channel of the frame in channel-parallel mode.  Every channel has its
+ * own MDCT buffers, so the transforms of all channels can run concurrently.
+ */
+typedef struct A52ChannelTask {
+    A52Task task;
+    struct A52ThreadContext *tctx;
+    int ch;
+    MDCTThreadContext mdct_tctx_512;
+    MDCTThreadContext mdct_tctx_256;
+} A52ChannelTask;
+
+/** worker threads which several encoding contexts can share */
+struct AftenPool {
+    A52Scheduler sched;
+    volatile int n_attached;    // initialized contexts using the pool
+};
+
+/**
+ * Step of encoding a frame, which runs as one task.  An ordered stage works
+ * on one frame at a time, in the order the frames were submitted.  Frames
+ * wait for it in the ring.  Only the first stage, or one which follows an
+ * ordered stage, can be ordered, so each ring has a single producer.
+ */
+typedef struct A52Stage {
+    int (*run)(struct A52ThreadContext *tctx);
+    int ordered;
+    A52Ring ring;
+    volatile int active;        // the owner of the stage pops the ring
+} A52Stage;
+
+/**
+ * Frames held back after their analysis so that the bandwidth of variable
+ * bandwidth mode can be chosen from the estimates of the depth frames after
+ * them.  Frames are released in submission order, by whichever thread
+ * finds the frames a release waits for analyzed, and then go on to stage.
+ * Frames in flight take the thread contexts in turn, so the frame at next
+ * is followed by the frames at next+1 and so on.
+ */
+typedef struct A52Lookahead {
+    MUTEX mutex;
+    int depth;                  // frames looked ahead, 0 if off
+    int stage;                  // stage the frames go on to when released
+    int next;                   // thread context of the next frame to release
+    int released;               // frames released so far
+    int submitted;              // frames submitted so far, only used by the caller
+    int total;                  // frames in the stream, once it has ended
+    int ended;
+    int stopped;                // release everything without looking ahead
+    int last_bwcode;            // bandwidth of the last frame released
+} A52Lookahead;
+
+typedef struct A52GlobalThreadSync {
+    A52Scheduler *sched;        // private_sched or the scheduler of a pool
+    A52Scheduler private_sched;
+    AftenPool *pool;
+    A52Waiter waiter;
+    A52Stage stages[A52_PIPELINE_STAGES];
+    int n_stages;
+    A52Lookahead la;
+    int current_tctx_num;       // oldest frame in flight
+    int aborted;
+    A52ChannelTask ch_tasks[A52_MAX_CHANNELS];
+    volatile int ch_pending;    // channel tasks which have not finished yet
+    volatile int ch_done;
+} A52GlobalThreadSync;
+#endif
 
 typedef struct A52ThreadContext {
     struct A52Context *ctx;
     A52DecodeContext *dctx;
 #ifndef NO_THREADS
-    A52ThreadSync ts;
+    A52Task task;
+    int stage;                  // index into ctx->ts.stages
+    volatile int done;
+    int held;                   // analyzed and waiting for the lookahead
+    int held_err;               // failed before it was held
 #endif
     ThreadState state;
     int thread_num;
     int framesize;
+    int channel_tasks;          // analysis is split into per-channel tasks
+    A52InputState *input;
 
     AftenStatus status;
     A52Frame frame;
     BitWriter bw;
     uint8_t frame_buffer[A52_MAX_CODED_FRAME_SIZE];
 
-    uint32_t bit_cnt;
-    uint32_t sample_cnt;
-
-    int last_quality;
-
     MDCTThreadContext mdct_tctx_512;
     MDCTThreadContext mdct_tctx_256;
 } A52ThreadContext;
@@ -71,16 +193,22 @@ typedef struct A52Context {
     A52GlobalThreadSync ts;
     int (*prepare_work)(A52ThreadContext *tctx, const void *input_buffer, int count, int *info);
 #endif
+    void (*serial_process_frame)(A52ThreadContext *tctx);
     int (*begin_process_frame)(A52ThreadContext *tctx);
     AftenEncParams params;
     AftenMetadata meta;
     void (*fmt_convert_from_src)(FLOAT dest[A52_MAX_CHANNELS][A52_SAMPLES_PER_FRAME],
           const void *vsrc, int nch, int n);
-    A52WindowFunctions winf;
+    int sample_size;            // bytes per input sample
     A52ExponentFunctions expf;
+    A52BitAllocFunctions baf;
 
     int n_threads;
+    int n_tctx;
+    AftenThreadMode thread_mode;
     int last_samples_count;
+    int start_quality;          // starting point of the CBR snroffst search
+    int lookahead;              // frames variable bandwidth mode looks ahead
     int n_channels;
     int n_all_channels;
     int acmod;
@@ -95,13 +223,7 @@ typedef struct A52Context {
     int frmsizecod;
     int fixed_bwcode;
 
-    FilterContext bs_filter[A52_MAX_CHANNELS];
-    FilterContext dc_filter[A52_MAX_CHANNELS];
-    FilterContext bw_filter[A52_MAX_CHANNELS];
-    FilterContext lfe_filter;
-
-    FLOAT last_samples[A52_MAX_CHANNELS][A52_SAMPLES_PER_FRAME]; // 256 would be enough, but want to use converting functions
-    FLOAT last_transient_samples[A52_MAX_CHANNELS][256];
+    A52InputState input;
 
     MDCTContext mdct_ctx_512;
     MDCTContext mdct_ctx_256;
@@ -38,7 +38,8 @@ extern "C" {
  */
 enum {
     A52_MAX_CODED_FRAME_SIZE = 3840,
-    A52_SAMPLES_PER_FRAME = 1536
+    A52_SAMPLES_PER_FRAME = 1536,
+    A52_PREROLL_FRAMES = 32     ///< pre-roll for aften_encode_segment, about 1s
 };
 
 /**
@@ -57,6 +58,15 @@ typedef enum {
     AFTEN_ENC_MODE_VBR
 } AftenEncMode;
 
+/**
+ * Threading Mode
+ */
+typedef enum {
+    AFTEN_THREAD_MODE_FRAME = 0,
+    AFTEN_THREAD_MODE_CHANNEL,
+    AFTEN_THREAD_MODE_PIPELINE
+} AftenThreadMode;
+
 /**
  * Floating-Point Data Types
  */
@@ -118,8 +128,18 @@ typedef struct {
     int amd_3dnowext;
     int amd_sse_mmx;
     int altivec;
+    int avx;
+    int avx2;
+    int fma;
+    int avx512bw;
 } AftenSimdInstructions;
 
+/**
+ * Encoding thread pool, which can be shared by several encoding contexts.
+ * See aften_pool_create().
+ */
+typedef struct AftenPool AftenPool;
+
 /**
  * Performance related parameters
  */
@@ -132,6 +152,40 @@ typedef struct {
      */
     int n_threads;
 
+    /**
+     * Spin count
+     * How many times an idle encoding thread polls for new work, and the
+     * calling thread polls for finished frames, before going to sleep.
+     * Spinning avoids the cost of waking up sleeping threads at the expense
+     * of CPU time.  This is ignored on single-CPU systems.
+     * Default value is 1000.
+     */
+    int spin_count;
+
+    /**
+     * Threading mode
+     * AFTEN_THREAD_MODE_FRAME encodes several frames at once, which adds
+     * 2 * n_threads frames of latency.
+     * AFTEN_THREAD_MODE_CHANNEL encodes one frame at a time and spreads the
+     * transform, exponent and masking work of its channels over the threads.
+     * It adds no latency, but scales only up to the number of channels.
+     * AFTEN_THREAD_MODE_PIPELINE splits encoding into analysis, bit
+     * allocation and packing, which work on consecutive frames at the same
+     * time.  It adds 3 frames of latency and uses up to 3 threads.
+     * Default value is AFTEN_THREAD_MODE_FRAME.
+     */
+    AftenThreadMode thread_mode;
+
+    /**
+     * Thread pool
+     * Set by aften_pool_attach().  When set, the context encodes on the
+     * threads of the pool instead of starting its own.  n_threads then
+     * only sets how many frames the context keeps in flight (two per
+     * thread); 0 means the number of pool threads.
+     * Default value is NULL.
+     */
+    AftenPool *pool;
+
     /**
      * Available SIMD instruction sets; shouldn't be modified
      */
@@ -244,6 +298,18 @@ typedef struct {
      */
     int expstr_search;
 
+    /**
+     * Adaptive exponent strategy search
+     * If set, each channel searches a number of sets that follows the
+     * spectral flux between its blocks: this many sets for a channel with
+     * typical flux, fewer down to 1 for more stationary or silent channels,
+     * and more up to expstr_search for transient ones.
+     * 0 is off (every channel searches expstr_search sets)
+     * maximum is 32
+     * default is 0
+     */
+    int expstr_search_avg;
+
     /**
      * Dynamic Range Compression profile
      * This determines which DRC profile to use.
@@ -273,6 +339,22 @@ typedef struct {
      */
     int max_bwcode;
 
+    /**
+     * Variable bandwidth lookahead.
+     * Only for variable bandwidth mode (bwcode -2), any other bwcode with a
+     * non-zero lookahead is an error.  This is the number of frames
+     * after each frame whose bandwidth estimates are known before the
+     * bandwidth of the frame is chosen.  The bandwidth then changes by at
+     * most one bandwidth code per frame, and starts going down ahead of
+     * frames which need a lower one.  The frames are held back until those
+     * after them have been analyzed, which needs threads, and does not work
+     * with the channel thread mode or aften_encode_buffer.
+     * 0 is off (each frame uses its own estimate)
+     * maximum is 32
+     * default is 0
+     */
+    int lookahead;
+
 } AftenEncParams;
 
 /**
@@ -332,6 +414,30 @@ typedef struct {
     int quality;
     int bit_rate;
     int bwcode;
+
+    /**
+     * Number of times encoding threads had to go to sleep waiting for work
+     * since the encoder was initialized.  Only used in threaded mode.
+     */
+    int thread_parks;
+
+    /**
+     * Average number of exponent strategy sets searched per channel, not
+     * counting the LFE channel.
+     */
+    float expstr_search_avg;
+
+    /**
+     * Number of bit allocation passes the snroffst search needed for the
+     * frame.
+     */
+    int snr_iterations;
+
+    /**
+     * Number of snroffst values the search tried again for the frame, whose
+     * bit counts were remembered from an earlier pass.
+     */
+    int snr_cache_hits;
 } AftenStatus;
 
 /**
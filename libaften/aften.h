@@ -87,6 +87,78 @@ AFTEN_API int aften_encode_init(AftenContext *s);
 AFTEN_API int aften_encode_frame(AftenContext *s, unsigned char *frame_buffer,
                                  const void *samples, int count);
 
+/**
+ * Gets the output buffer size @c aften_encode_buffer needs.
+ * @param s         The encoding context
+ * @param n_samples Number of input audio samples (per channel)
+ * @return Returns the largest number of bytes the stream can take up, or
+ * returns a negative value on error.
+ */
+AFTEN_API int aften_encode_buffer_bound(AftenContext *s, int n_samples);
+
+/**
+ * Encodes a complete stream whose input samples are all in memory.
+ * The stream is split into chunks, which all threads of the context encode
+ * independently, so it scales better than @c aften_encode_frame.  Before
+ * each chunk, the preceding second of audio is run through the input filters,
+ * so the chunk boundaries are inaudible, but the output can differ slightly
+ * from the one of @c aften_encode_frame.
+ * This must be called on a freshly initialized context instead of
+ * @c aften_encode_frame.  Afterwards, the context can only be closed.
+ * @param s    The encoding context
+ * @param[out] output      Pointer to the output stream
+ * @param[in]  output_size Size of @p output in bytes, at least what
+ * @c aften_encode_buffer_bound returns
+ * @param[in]  samples     Pointer to the interleaved input audio samples
+ * @param[in]  n_samples   Number of input audio samples (per channel)
+ * @return Returns the number of bytes written to @p output, or returns
+ * a negative value on error.
+ */
+AFTEN_API int aften_encode_buffer(AftenContext *s, unsigned char *output,
+                                  int output_size, const void *samples,
+                                  int n_samples);
+
+/**
+ * Encodes a segment of a stream whose input samples are in memory.
+ * This lets a long stream be split into segments which are encoded
+ * separately, even on different machines, and simply concatenated.
+ * Frame n of a stream encodes the input samples from
+ * (n * A52_SAMPLES_PER_FRAME - 256) on.  The input has to start
+ * @p n_preroll frames before the segment.  These frames only prime the
+ * input filters and the transform and are not output.
+ * The segment is bit-exact with the same frames of the complete stream if
+ * @p n_preroll equals @p first_frame, so all of the stream before the
+ * segment is passed, or if @p n_preroll is at least 1 and the DC, bandwidth
+ * and LFE filters (use_dc_filter, use_bw_filter, use_lfe_filter) are off.
+ * The only other filter, the 8 kHz high-pass filter of the block switching
+ * detector, forgets its starting state within the first frame.
+ * The DC, bandwidth and LFE filters are IIR filters whose state goes back
+ * to the start of the stream.  When any of them is on, A52_PREROLL_FRAMES
+ * frames of pre-roll let them settle, and the segment is usually but not
+ * always byte-identical.
+ * Several segments can be encoded with the same context, but it must not be
+ * used with @c aften_encode_frame.
+ * @param s    The encoding context
+ * @param[out] output      Pointer to the output frames
+ * @param[in]  output_size Size of @p output in bytes, at least what
+ * @c aften_encode_buffer_bound returns for the samples from the start of the
+ * segment on
+ * @param[in]  samples     Pointer to the interleaved input audio samples,
+ * starting with those of frame (@p first_frame - @p n_preroll)
+ * @param[in]  n_samples   Number of input audio samples (per channel).  The
+ * stream ends after them.
+ * @param[in]  n_preroll   Number of frames of pre-roll, at most @p first_frame
+ * @param[in]  first_frame Number of the first frame to output
+ * @param[in]  n_frames    Number of frames to output, or 0 to encode up to
+ * the end of the stream
+ * @return Returns the number of bytes written to @p output, or returns
+ * a negative value on error.
+ */
+AFTEN_API int aften_encode_segment(AftenContext *s, unsigned char *output,
+                                   int output_size, const void *samples,
+                                   int n_samples, int n_preroll,
+                                   int first_frame, int n_frames);
+
 /**
  * Sets the parameters in the context @p s to their default values.
  * @param s The encoding context
@@ -96,6 +168,44 @@ AFTEN_API int aften_encode_close(AftenContext *s);
 
 /** @} end encoding functions */
 
+/**
+ * @defgroup pool Shared thread pool functions
+ * Running many encoders at once, each with its own threads, leaves far more
+ * threads than CPUs.  Instead, the encoders can share one pool of threads,
+ * which runs the frames of all of them in the order they were submitted.
+ * @{
+ */
+
+/**
+ * Starts a pool of encoding threads.
+ * @param n_threads  Number of threads, or 0 to use one per CPU
+ * @param spin_count How often idle threads poll for work before sleeping,
+ * as in AftenSystemParams
+ * @return Returns the new pool, or NULL on error.
+ */
+AFTEN_API AftenPool *aften_pool_create(int n_threads, int spin_count);
+
+/**
+ * Makes an encoding context use the threads of @p pool.
+ * Any number of contexts can be attached to the same pool.  This must be
+ * called before @c aften_encode_init.
+ * @param s    The encoding context
+ * @param pool The thread pool
+ * @return Returns 0 on success, non-zero on failure.
+ */
+AFTEN_API int aften_pool_attach(AftenContext *s, AftenPool *pool);
+
+/**
+ * Stops the threads of a pool and frees it.
+ * All contexts attached to the pool must have been closed with
+ * @c aften_encode_close before.
+ * @param pool The thread pool
+ * @return Returns a negative value on error.
+ */
+AFTEN_API int aften_pool_close(AftenPool *pool);
+
+/** @} end pool functions */
+
 /**
  * @defgroup utility Utility functions
  * @{
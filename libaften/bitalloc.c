@@ -28,6 +28,7 @@
 
 #include "a52enc.h"
 #include "bitalloc.h"
+#include "cpu_caps.h"
 
 /**
  * A52 bit allocation preparation to speed up matching left bits.
@@ -35,7 +36,7 @@
  * the mdct coefficient exponents and bit allocation parameters.
  */
 static void
-a52_bit_allocation_prepare(A52BitAllocParams *s,
+a52_bit_allocation_prepare(A52BitAllocFunctions *baf, A52BitAllocParams *s,
                    uint8_t *exp, int16_t *psd, int16_t *mask,
                    int fgain, int start, int end)
 //                 int deltbae,int deltnseg, uint8_t *deltoffst,
@@ -43,7 +44,7 @@ a52_bit_allocation_prepare(A52BitAllocParams *s,
 {
     int16_t bndpsd[50]; // power spectral density for critical bands
 
-    a52_bit_alloc_calc_psd(exp, start, end, psd, bndpsd);
+    baf->calc_psd(exp, start, end, psd, bndpsd);
 
     a52_bit_alloc_calc_mask(s, bndpsd, start, end, fgain,
                             -1, -1, NULL, NULL, NULL,/* delta bit allocation not used */
@@ -51,28 +52,31 @@ a52_bit_allocation_prepare(A52BitAllocParams *s,
 }
 
 /**
- * Calculate the size in bits taken by the mantissas.
- * This is determined solely by the bit allocation pointers.
+ * Count the mantissas of one channel for the given snr_offset from its
+ * exponent histogram.  The size in bits is determined solely by the number
+ * of mantissas with each bit allocation pointer.  The ones with bap=1 to
+ * bap=4 are grouped, so only their number is set in mant_cnt[1] to
+ * mant_cnt[4], and the bits of the others are returned.
  */
 static int
-compute_mantissa_size(int mant_cnt[5], uint8_t *bap, int ncoefs)
+count_mant(int16_t *mask, A52ExpHist *hist, int start, int end,
+           int snr_offset, int floor, int mant_cnt[5])
 {
-    int bits, b, i;
+    int bap_count[16];
+    int bits, b;
 
+    a52_bit_alloc_count_bap(mask, hist, start, end, snr_offset, floor,
+                            bap_count);
+
+    // bap=1 to bap=4 will be counted in compute_mantissa_size_final
+    for (b = 1; b <= 4; b++)
+        mant_cnt[b] = bap_count[b];
+    // bap=5 to bap=13 use (bap-1) bits
     bits = 0;
-    for (i = 0; i < ncoefs; i++) {
-        b = bap[i];
-        if (b <= 4) {
-            // bap=1 to bap=4 will be counted in compute_mantissa_size_final
-            ++mant_cnt[b];
-        } else if (b <= 13) {
-            // bap=5 to bap=13 use (bap-1) bits
-            bits += b-1;
-        } else {
-            // bap=14 uses 14 bits and bap=15 uses 16 bits
-            bits += 14 + ((b-14)<<1);
-        }
-    }
+    for (b = 5; b <= 13; b++)
+        bits += bap_count[b] * (b-1);
+    // bap=14 uses 14 bits and bap=15 uses 16 bits
+    bits += bap_count[14] * 14 + bap_count[15] * 16;
     return bits;
 }
 
@@ -90,46 +94,101 @@ compute_mantissa_size_final(int mant_cnt[5])
     return bits;
 }
 
-/* call to prepare bit allocation */
+/** sets the fast gain codes of one channel based on its exponent strategies */
 static void
-bit_alloc_prepare(A52ThreadContext *tctx)
+set_fast_gain_ch(A52Frame *frame, int ch)
+{
+    A52Block *block;
+    int blk;
+
+    for (blk = 0; blk < A52_NUM_BLOCKS; blk++) {
+        block = &frame->blocks[blk];
+        // the first block never reuses exponents
+        if (!blk || block->exp_strategy[ch] != EXP_REUSE)
+            block->fgaincod[ch] = 4 - block->exp_strategy[ch];
+        else
+            block->fgaincod[ch] = frame->blocks[blk-1].fgaincod[ch];
+        frame->bit_alloc.fgain[blk][ch] = a52_fast_gain_tab[block->fgaincod[ch]];
+    }
+}
+
+static void
+bit_alloc_prepare_ch(A52ThreadContext *tctx, int ch)
 {
-    A52Context *ctx = tctx->ctx;
     A52Frame *frame = &tctx->frame;
     A52Block *block;
-    int blk, ch;
+    int blk;
 
     for (blk = 0; blk < A52_NUM_BLOCKS; blk++) {
         block = &frame->blocks[blk];
-        for (ch = 0; ch < ctx->n_all_channels; ch++) {
-            // We don't have to run the bit allocation when reusing exponents
-            if (block->exp_strategy[ch] != EXP_REUSE) {
-                a52_bit_allocation_prepare(&frame->bit_alloc,
-                               block->exp[ch], block->psd[ch], block->mask[ch],
-                               frame->bit_alloc.fgain[blk][ch],
-                               0, frame->ncoefs[ch]);
-//                             2, 0, NULL, NULL, NULL);
-            }
+        // We don't have to run the bit allocation when reusing exponents
+        if (block->exp_strategy[ch] != EXP_REUSE) {
+            a52_bit_allocation_prepare(&tctx->ctx->baf, &frame->bit_alloc,
+                           block->exp[ch], block->psd[ch], block->mask[ch],
+                           frame->bit_alloc.fgain[blk][ch],
+                           0, frame->ncoefs[ch]);
+//                         2, 0, NULL, NULL, NULL);
+            a52_bit_alloc_calc_hist(block->exp[ch], 0, frame->ncoefs[ch],
+                                    &block->exp_hist[ch]);
         }
     }
 }
 
+/* call to prepare bit allocation */
+static void
+bit_alloc_prepare(A52ThreadContext *tctx)
+{
+    int ch;
+
+    for (ch = 0; ch < tctx->ctx->n_all_channels; ch++)
+        bit_alloc_prepare_ch(tctx, ch);
+}
+
+void
+prepare_bit_allocation_ch(A52ThreadContext *tctx, int ch)
+{
+    set_fast_gain_ch(&tctx->frame, ch);
+    bit_alloc_prepare_ch(tctx, ch);
+}
+
 /**
- * Run the bit allocation routine using the given snroffset values.
+ * Count the mantissa bits the bit allocation gives with the given snroffset
+ * value, from the exponent histograms.  The bit allocation pointers are
+ * not written.
+ * If min_bits is not NULL, it is set to the bits the mantissas would take
+ * without padding the grouped ones to whole groups, rounded up.  Unlike the
+ * real count, which can drop by a few bits when some mantissas leave a
+ * group, this never decreases as snroffset increases.
+ * The counts of the offsets already tried for the frame are remembered.
  * Returns number of mantissa bits used.
  */
 static int
-bit_alloc(A52ThreadContext *tctx, int snroffst)
+bit_alloc(A52ThreadContext *tctx, int snroffst, int *min_bits)
 {
     A52Context *ctx = tctx->ctx;
     A52Frame *frame = &tctx->frame;
+    A52SnrCache *cache = &frame->snr_cache;
     A52Block *block;
     int mant_cnt[5];
-    int blk, ch;
-    int bits;
+    int ch_cnt[A52_MAX_CHANNELS][5];
+    int ch_bits[A52_MAX_CHANNELS];
+    int blk, ch, i, b;
+    int snr_offset, bits, grouped_bits, grouped_bits6, unpadded_bits;
+
+    for (i = 0; i < cache->count; i++) {
+        if (cache->snroffst[i] == snroffst) {
+            frame->snr_cache_hits++;
+            if (min_bits)
+                *min_bits = cache->min_bits[i];
+            return cache->bits[i];
+        }
+    }
+    frame->snr_iterations++;
 
     bits = 0;
-    snroffst = (snroffst << 2) - 960;
+    grouped_bits = 0;
+    grouped_bits6 = 0;
+    snr_offset = (snroffst << 2) - 960;
 
     for (blk = 0; blk < A52_NUM_BLOCKS; blk++) {
         block = &frame->blocks[blk];
@@ -139,6 +198,162 @@ bit_alloc(A52ThreadContext *tctx, int snroffst)
         mant_cnt[0] = mant_cnt[3] = 0;
         mant_cnt[1] = mant_cnt[2] = 2;
         mant_cnt[4] = 1;
+        for (ch = 0; ch < ctx->n_all_channels; ch++) {
+            // the counts of the previous block stay valid when reusing
+            // exponents, see bit_alloc_bap
+            if (block->exp_strategy[ch] != EXP_REUSE) {
+                ch_bits[ch] = ctx->baf.count_mant(block->mask[ch], &block->exp_hist[ch],
+                                                  0, frame->ncoefs[ch], snr_offset,
+                                                  frame->bit_alloc.floor, ch_cnt[ch]);
+            }
+            bits += ch_bits[ch];
+            for (b = 1; b <= 4; b++)
+                mant_cnt[b] += ch_cnt[ch][b];
+        }
+        grouped_bits += compute_mantissa_size_final(mant_cnt);
+        // 5/3, 7/3, 3 and 7/2 bits per mantissa, in sixths of a bit
+        grouped_bits6 += 10 * (mant_cnt[1] - 2) + 14 * (mant_cnt[2] - 2) +
+                         18 * mant_cnt[3] + 21 * (mant_cnt[4] - 1);
+    }
+
+    unpadded_bits = bits + (grouped_bits6 + 5) / 6;
+    bits += grouped_bits;
+    if (cache->count < A52_SNR_CACHE_SIZE) {
+        cache->snroffst[cache->count] = snroffst;
+        cache->bits[cache->count] = bits;
+        cache->min_bits[cache->count] = unpadded_bits;
+        cache->count++;
+    }
+    if (min_bits)
+        *min_bits = unpadded_bits;
+    return bits;
+}
+
+/**
+ * Finds the highest snroffst for which the mantissas fit in avail_bits,
+ * starting from snroffst.
+ * The bits without group padding never decrease with snroffst, so the
+ * lowest offset for which they do not fit bounds every offset that fits.
+ * That offset is bracketed between one where they fit (lo) and one where
+ * they do not (hi), then the bracket is narrowed by secant steps, falling
+ * back to bisection whenever a step does not halve it.  Offsets -1 and 1024
+ * stand for the ends of the range without being evaluated.  The offset
+ * that fits is then found going down from lo, and is never below the
+ * highest one seen fitting on the way.
+ * Returns the offset and sets *leftover to its leftover bits, which is
+ * negative if not even snroffst 0 fits.
+ */
+static int
+search_snroffst(A52ThreadContext *tctx, int avail_bits, int snroffst,
+                int *leftover)
+{
+    A52Context *ctx = tctx->ctx;
+    int lo, hi, left_lo, left_hi, step, width, closed, side, last_side;
+    int fit, left_fit, left, min_bits, prev, left_prev;
+
+    lo = -1;
+    hi = 1024;
+    left_lo = left_hi = 0;
+    fit = -1;
+    left_fit = 0;
+    step = 0;
+    prev = left_prev = 0;
+    side = 0;
+    while (1) {
+        left = avail_bits - bit_alloc(tctx, snroffst, &min_bits);
+
+        closed = (lo >= 0 && hi <= 1023);
+        width = hi - lo;
+        last_side = side;
+        if (min_bits <= avail_bits) {
+            lo = snroffst;
+            left_lo = avail_bits - min_bits;
+            *leftover = left;
+            if (left >= 0) {
+                fit = lo;
+                left_fit = left;
+            }
+            side = 1;
+        } else {
+            hi = snroffst;
+            left_hi = avail_bits - min_bits;
+            side = -1;
+        }
+        if (hi - lo <= 1)
+            break;
+        // when the same end moves twice, the other one is given half the
+        // weight, so the secant steps do not stall against it
+        if (closed && side == last_side) {
+            if (side > 0)
+                left_hi = (left_hi - 1) / 2;
+            else
+                left_lo /= 2;
+        }
+
+        if (lo < 0 || hi > 1023) {
+            // bracket: move by the distance extrapolated from the last two
+            // offsets with a quarter more to get past, or estimated from the
+            // bitrate for the first step.  without a slope to extrapolate
+            // from, the last step is doubled
+            int target = avail_bits - min_bits;
+            if (!step) {
+                step = target / (16 * ctx->n_channels);
+            } else {
+                int est = 0;
+                if (left_prev != target)
+                    est = (int)(((int64_t)(snroffst - prev) * target) /
+                                (left_prev - target));
+                est += est / 4;
+                if ((step > 0 && est > 0) || (step < 0 && est < 0))
+                    step = est;
+                else
+                    step *= 2;
+            }
+            if (!step)
+                step = (min_bits <= avail_bits) ? 1 : -1;
+            prev = snroffst;
+            left_prev = target;
+            snroffst = CLIP(snroffst + step, MAX(lo + 1, 0), MIN(hi - 1, 1023));
+        } else if (closed && 2 * (hi - lo) > width) {
+            snroffst = (lo + hi) >> 1;
+        } else {
+            snroffst = lo + (int)(((int64_t)(hi - lo) * left_lo) /
+                                  (left_lo - left_hi));
+            snroffst = CLIP(snroffst, lo + 1, hi - 1);
+        }
+    }
+
+    // nothing fits if even the bits without padding do not at offset 0
+    if (lo < 0) {
+        *leftover = left_hi;
+        return 0;
+    }
+    snroffst = lo;
+    while (*leftover < 0 && snroffst > 0) {
+        if (--snroffst == fit)
+            *leftover = left_fit;
+        else
+            *leftover = avail_bits - bit_alloc(tctx, snroffst, NULL);
+    }
+    return snroffst;
+}
+
+/**
+ * Run the bit allocation routine using the given snroffset value, setting
+ * the bit allocation pointers.
+ */
+static void
+bit_alloc_bap(A52ThreadContext *tctx, int snroffst)
+{
+    A52Context *ctx = tctx->ctx;
+    A52Frame *frame = &tctx->frame;
+    A52Block *block;
+    int blk, ch;
+
+    snroffst = (snroffst << 2) - 960;
+
+    for (blk = 0; blk < A52_NUM_BLOCKS; blk++) {
+        block = &frame->blocks[blk];
         for (ch = 0; ch < ctx->n_all_channels; ch++) {
             // Currently the encoder is setup so that the only bit allocation
             // parameter which varies across blocks within a frame is the
@@ -147,16 +362,11 @@ bit_alloc(A52ThreadContext *tctx, int snroffst)
             if (block->exp_strategy[ch] == EXP_REUSE) {
                 memcpy(block->bap[ch], frame->blocks[blk-1].bap[ch], 256);
             } else {
-                a52_bit_alloc_calc_bap(block->mask[ch], block->psd[ch], 0, frame->ncoefs[ch],
-                                       snroffst, frame->bit_alloc.floor, block->bap[ch]);
+                ctx->baf.calc_bap(block->mask[ch], block->psd[ch], 0, frame->ncoefs[ch],
+                                  snroffst, frame->bit_alloc.floor, block->bap[ch]);
             }
-            bits += compute_mantissa_size(mant_cnt, block->bap[ch], frame->ncoefs[ch]);
-
         }
-        bits += compute_mantissa_size_final(mant_cnt);
     }
-
-    return bits;
 }
 
 /** Counts all frame bits except for mantissas and exponents */
@@ -251,16 +461,23 @@ cbr_bit_allocation(A52ThreadContext *tctx, int prepare)
     if (prepare)
         bit_alloc_prepare(tctx);
 
-    // starting point
+    // starting point.  the fast search starts from the same estimate for
+    // every frame, so the result does not depend on which frames a thread
+    // encoded before.  the full search finds the same offset from anywhere,
+    // so it starts from the offset of the last frame this thread encoded.
     if (ctx->params.encoding_mode == AFTEN_ENC_MODE_VBR)
         snroffst = ctx->params.quality;
     else if (ctx->params.encoding_mode == AFTEN_ENC_MODE_CBR)
-        snroffst = tctx->last_quality;
-    leftover = avail_bits - bit_alloc(tctx, snroffst);
+        snroffst = ctx->start_quality;
 
-    if (ctx->params.bitalloc_fast) {
+    if (!ctx->params.bitalloc_fast) {
+        if (frame->quality)
+            snroffst = frame->quality;
+        snroffst = search_snroffst(tctx, avail_bits, snroffst, &leftover);
+    } else {
         // fast bit allocation
         int leftover0, leftover1, snr0, snr1;
+        leftover = avail_bits - bit_alloc(tctx, snroffst, NULL);
         snr0 = snr1 = snroffst;
         leftover0 = leftover1 = leftover;
         if (leftover != 0) {
@@ -269,49 +486,20 @@ cbr_bit_allocation(A52ThreadContext *tctx, int prepare)
                     snr0 = snr1;
                     leftover0 = leftover1;
                     snr1 += 16;
-                    leftover1 = avail_bits - bit_alloc(tctx, snr1);
+                    leftover1 = avail_bits - bit_alloc(tctx, snr1, NULL);
                 }
             } else {
                 while (leftover0 < 0 && snr0-16 >= 0) {
                     snr1 = snr0;
                     leftover1 = leftover0;
                     snr0 -= 16;
-                    leftover0 = avail_bits - bit_alloc(tctx, snr0);
+                    leftover0 = avail_bits - bit_alloc(tctx, snr0, NULL);
                 }
             }
         }
         if (snr0 != snr1) {
             snroffst = snr0;
-            leftover = avail_bits - bit_alloc(tctx, snroffst);
-        }
-    } else {
-        // take up to 3 jumps based on estimated distance from optimal
-        if (leftover < -400) {
-            snroffst += (leftover / (16 * ctx->n_channels));
-            leftover = avail_bits - bit_alloc(tctx, snroffst);
-        }
-        if (leftover > 400) {
-            snroffst += (leftover / (24 * ctx->n_channels));
-            leftover = avail_bits - bit_alloc(tctx, snroffst);
-        }
-        if (leftover < -200) {
-            snroffst += (leftover / (40 * ctx->n_channels));
-            leftover = avail_bits - bit_alloc(tctx, snroffst);
-        }
-        // adjust snroffst until leftover <= -100
-        while (leftover > -100) {
-            snroffst += (10 / ctx->n_channels);
-            if (snroffst > 1023) {
-                snroffst = 1023;
-                leftover = avail_bits - bit_alloc(tctx, snroffst);
-                break;
-            }
-            leftover = avail_bits - bit_alloc(tctx, snroffst);
-        }
-        // adjust snroffst until leftover is positive
-        while (leftover < 0 && snroffst > 0) {
-            snroffst--;
-            leftover = avail_bits - bit_alloc(tctx, snroffst);
+            leftover = avail_bits - bit_alloc(tctx, snroffst, NULL);
         }
     }
 
@@ -320,12 +508,12 @@ cbr_bit_allocation(A52ThreadContext *tctx, int prepare)
         fprintf(stderr, "bitrate: %d kbps too small\n", frame->bit_rate);
         return -1;
     }
+    bit_alloc_bap(tctx, snroffst);
 
     // set encoding parameters
     frame->csnroffst = snroffst >> 4;
     frame->fsnroffst = snroffst & 0xF;
     frame->quality = snroffst;
-    tctx->last_quality = snroffst;
 
     return 0;
 }
@@ -335,7 +523,7 @@ cbr_bit_allocation(A52ThreadContext *tctx, int prepare)
  * snroffset value as determined by the user-selected quality setting.
  */
 static int
-vbr_bit_allocation(A52ThreadContext *tctx)
+vbr_bit_allocation(A52ThreadContext *tctx, int prepare)
 {
     A52Context *ctx = tctx->ctx;
     A52Frame *frame = &tctx->frame;
@@ -347,10 +535,11 @@ vbr_bit_allocation(A52ThreadContext *tctx)
     current_bits = frame->frame_bits + frame->exp_bits;
     quality = ctx->params.quality;
 
-    bit_alloc_prepare(tctx);
+    if (prepare)
+        bit_alloc_prepare(tctx);
     // find an A52 frame size that can hold the data.
     frame_size = 0;
-    frame_bits = current_bits + bit_alloc(tctx, quality);
+    frame_bits = current_bits + bit_alloc(tctx, quality, NULL);
     for (i = 0; i <= ctx->frmsizecod; i++) {
         frame_size = a52_frame_size_tab[i][ctx->fscod];
         if (frame_size >= frame_bits)
@@ -370,7 +559,7 @@ vbr_bit_allocation(A52ThreadContext *tctx)
 }
 
 /**
- * Loads the bit allocation parameters and counts fixed frame bits.
+ * Sets the fast gain codes and counts fixed frame bits.
  */
 static void
 start_bit_allocation(A52ThreadContext *tctx)
@@ -380,28 +569,14 @@ start_bit_allocation(A52ThreadContext *tctx)
     A52Block *block;
     int blk, ch;
 
-    // read bit allocation table values
-    frame->bit_alloc.fscod = ctx->fscod;
-    frame->bit_alloc.halfratecod = ctx->halfratecod;
-    frame->bit_alloc.sdecay = a52_slow_decay_tab[frame->sdecaycod] >> ctx->halfratecod;
-    frame->bit_alloc.fdecay = a52_fast_decay_tab[frame->fdecaycod] >> ctx->halfratecod;
-    frame->bit_alloc.sgain = a52_slow_gain_tab[frame->sgaincod];
-    frame->bit_alloc.dbknee = a52_db_per_bit_tab[frame->dbkneecod];
-    frame->bit_alloc.floor = a52_floor_tab[frame->floorcod];
-
     // set fast gain based on exponent strategy
+    for (ch = 0; ch < ctx->n_all_channels; ch++)
+        set_fast_gain_ch(frame, ch);
     for (blk = 0; blk < A52_NUM_BLOCKS; blk++) {
         block = &frame->blocks[blk];
-        block->write_snr = 0;
-        for (ch = 0; ch < ctx->n_all_channels; ch++) {
-            if (block->exp_strategy[ch] != EXP_REUSE) {
-                block->fgaincod[ch] = 4 - block->exp_strategy[ch];
-                block->write_snr |= !blk || (block->fgaincod[ch] != frame->blocks[blk-1].fgaincod[ch]);
-            } else {
-                block->fgaincod[ch] = frame->blocks[blk-1].fgaincod[ch];
-            }
-            frame->bit_alloc.fgain[blk][ch] = a52_fast_gain_tab[block->fgaincod[ch]];
-        }
+        block->write_snr = !blk;
+        for (ch = 0; ch < ctx->n_all_channels; ch++)
+            block->write_snr |= blk && (block->fgaincod[ch] != frame->blocks[blk-1].fgaincod[ch]);
     }
 
     count_frame_bits(tctx);
@@ -437,7 +612,7 @@ vbw_bit_allocation(A52ThreadContext *tctx)
     avail_bits = (16 * frame->frame_size) - frame->frame_bits;
 
     bit_alloc_prepare(tctx);
-    bit_alloc(tctx, 240);
+    bit_alloc_bap(tctx, 240);
 
     // deduct any LFE exponent and mantissa bits
     if (ctx->lfe) {
@@ -492,22 +667,48 @@ vbw_bit_allocation(A52ThreadContext *tctx)
 /**
  * Run the bit allocation encoding routine.
  * Runs the bit allocation in either CBR or VBR mode, depending on the mode
- * selected by the user.
+ * selected by the user.  prepare is 0 if prepare_bit_allocation_ch has
+ * already been run for all channels.
  */
 int
-compute_bit_allocation(A52ThreadContext *tctx)
+compute_bit_allocation(A52ThreadContext *tctx, int prepare)
 {
     A52Context *ctx = tctx->ctx;
 
+    tctx->frame.snr_iterations = 0;
+    tctx->frame.snr_cache_hits = 0;
+    tctx->frame.snr_cache.count = 0;
     start_bit_allocation(tctx);
     if (ctx->params.encoding_mode == AFTEN_ENC_MODE_VBR) {
-        if (vbr_bit_allocation(tctx))
+        if (vbr_bit_allocation(tctx, prepare))
             return -1;
     } else if(ctx->params.encoding_mode == AFTEN_ENC_MODE_CBR) {
-        if (cbr_bit_allocation(tctx, 1))
+        if (cbr_bit_allocation(tctx, prepare))
             return -1;
     } else {
         return -1;
     }
     return 0;
 }
+
+void
+bit_alloc_init(A52BitAllocFunctions *baf)
+{
+    baf->calc_psd = a52_bit_alloc_calc_psd;
+    baf->calc_bap = a52_bit_alloc_calc_bap;
+    baf->count_mant = count_mant;
+#ifdef HAVE_SSE2
+    if (cpu_caps_have_sse2()) {
+        baf->calc_psd = bit_alloc_calc_psd_sse2;
+        baf->calc_bap = bit_alloc_calc_bap_sse2;
+        baf->count_mant = bit_alloc_count_mant_sse2;
+    }
+#endif /* HAVE_SSE2 */
+#ifdef HAVE_AVX2
+    if (cpu_caps_have_avx2()) {
+        baf->calc_psd = bit_alloc_calc_psd_avx2;
+        baf->calc_bap = bit_alloc_calc_bap_avx2;
+        baf->count_mant = bit_alloc_count_mant_avx2;
+    }
+#endif /* HAVE_AVX2 */
+}
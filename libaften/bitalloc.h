@@ -28,10 +28,46 @@
 #ifndef BITALLOC_H
 #define BITALLOC_H
 
+#include "common.h"
+#include "a52.h"
+
+#if defined(HAVE_MMX) || defined(HAVE_SSE)
+#include "x86/bitalloc.h"
+#endif
+
 struct A52ThreadContext;
 
+typedef struct A52BitAllocFunctions {
+
+    /** Same as a52_bit_alloc_calc_psd */
+    void (*calc_psd)(uint8_t *exp, int start, int end, int16_t *psd,
+                     int16_t *band_psd);
+
+    /** Same as a52_bit_alloc_calc_bap */
+    void (*calc_bap)(int16_t *mask, int16_t *psd, int start, int end,
+                     int snr_offset, int floor, uint8_t *bap);
+
+    /**
+     * Count the mantissas of a channel from its exponent histogram, setting
+     * the number with bap=1 to bap=4 in mant_cnt[1] to mant_cnt[4] and
+     * returning the bits of the others.  Gives the same counts as the bit
+     * allocation pointers of a52_bit_alloc_calc_bap, without computing them.
+     */
+    int (*count_mant)(int16_t *mask, A52ExpHist *hist, int start, int end,
+                      int snr_offset, int floor, int mant_cnt[5]);
+
+} A52BitAllocFunctions;
+
+extern void bit_alloc_init(A52BitAllocFunctions *baf);
+
 extern void vbw_bit_allocation(struct A52ThreadContext *tctx);
 
-extern int compute_bit_allocation(struct A52ThreadContext *tctx);
+/**
+ * Computes the power spectral densities and masking curves of one channel.
+ * Channels are independent, so this can run for all channels concurrently.
+ */
+extern void prepare_bit_allocation_ch(struct A52ThreadContext *tctx, int ch);
+
+extern int compute_bit_allocation(struct A52ThreadContext *tctx, int prepare);
 
 #endif /* BITALLOC_H */
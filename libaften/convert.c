@@ -162,20 +162,28 @@ set_converter(A52Context *ctx, A52SampleFormat sample_format)
 {
     switch (sample_format) {
     case A52_SAMPLE_FMT_U8:  ctx->fmt_convert_from_src = fmt_convert_from_u8;
+        ctx->sample_size = 1;
         break;
     case A52_SAMPLE_FMT_S8:  ctx->fmt_convert_from_src = fmt_convert_from_s8;
+        ctx->sample_size = 1;
         break;
     case A52_SAMPLE_FMT_S16: ctx->fmt_convert_from_src = fmt_convert_from_s16;
+        ctx->sample_size = 2;
         break;
     case A52_SAMPLE_FMT_S20: ctx->fmt_convert_from_src = fmt_convert_from_s20;
+        ctx->sample_size = 4;
         break;
     case A52_SAMPLE_FMT_S24: ctx->fmt_convert_from_src = fmt_convert_from_s24;
+        ctx->sample_size = 4;
         break;
     case A52_SAMPLE_FMT_S32: ctx->fmt_convert_from_src = fmt_convert_from_s32;
+        ctx->sample_size = 4;
         break;
     case A52_SAMPLE_FMT_FLT: ctx->fmt_convert_from_src = fmt_convert_from_float;
+        ctx->sample_size = sizeof(float);
         break;
     case A52_SAMPLE_FMT_DBL: ctx->fmt_convert_from_src = fmt_convert_from_double;
+        ctx->sample_size = sizeof(double);
         break;
     default: break;
     }
@@ -46,53 +46,34 @@ static const uint8_t expstr_set_search_order_tab[A52_EXPSTR_SETS] = {
  * Determine a good exponent strategy for all blocks of a single channel.
  * A pre-defined set of strategies is chosen based on the SSE between each set
  * and the most accurate strategy set (all blocks EXP_D15).
+ * The sets are built from a few runs of blocks sharing one exponent set, so
+ * the error of each run is only computed the first time a set uses it.
  */
 static int
 compute_expstr_ch(A52ExponentFunctions *expf, uint8_t *exp[A52_NUM_BLOCKS],
                   int ncoefs, int search_size)
 {
-    uint8_t exponents[A52_NUM_BLOCKS][256];
-	uint8_t* expSource[A52_NUM_BLOCKS];
-    int blk, s, i, j, k;
+    int i, j, s;
     int min_error, exp_error[A52_EXPSTR_SETS];
+    // error of blocks i to j-1 with exponent strategy es, -1 if not known yet
+    int run_error[A52_NUM_BLOCKS][A52_NUM_BLOCKS+1][3];
+
+    memset(run_error, -1, sizeof(run_error));
 
     min_error = expstr_set_search_order_tab[0];
     for (s = 0; s < search_size; s++) {
         int str = expstr_set_search_order_tab[s];
-		const uint8_t* expstr_set_tab = a52_expstr_set_tab[str];
-
-        // collect exponents
-        for (blk = 0; blk < A52_NUM_BLOCKS; blk++)
-			expSource[blk] = exp[blk];
-
-        // encode exponents
-        i = 0;
-        while (i < A52_NUM_BLOCKS) {
-			uint8_t* currentExp = exponents[i];
-            j = i + 1;
-
-			// Special handling for first time, as exponents[i] != expSource[i]
-			if (j < A52_NUM_BLOCKS && expstr_set_tab[j]==EXP_REUSE) {
-				expf->exponent_min(currentExp, expSource[i], expSource[j], ncoefs);
-				j++;
-			}
-            while (j < A52_NUM_BLOCKS && expstr_set_tab[j]==EXP_REUSE) {
-				expf->exponent_min(currentExp, currentExp, expSource[j], ncoefs);
-                j++;
-            }
-            expf->encode_exp_blk_ch(currentExp, ncoefs, expstr_set_tab[i]);
-            for (k = i; k < j; k++)
-				expSource[k] = currentExp;
+        const uint8_t *expstr_set_tab = a52_expstr_set_tab[str];
 
-			i = j;
-        }
-
-        // select strategy based on minimum error from unencoded exponents
         exp_error[str] = 0;
-        for (blk = 0; blk < A52_NUM_BLOCKS; blk++) {
-            exp_error[str] += expf->exponent_sum_square_error(exp[blk],
-                                                        expSource[blk],
-                                                        ncoefs);
+        for (i = 0; i < A52_NUM_BLOCKS; i = j) {
+            int es = expstr_set_tab[i];
+            for (j = i + 1; j < A52_NUM_BLOCKS && expstr_set_tab[j] == EXP_REUSE; j++);
+            if (run_error[i][j][es-1] < 0) {
+                run_error[i][j][es-1] = expf->exponent_run_error(&exp[i], j - i,
+                                                                 ncoefs, es);
+            }
+            exp_error[str] += run_error[i][j][es-1];
         }
         if (exp_error[str] < exp_error[min_error])
             min_error = str;
@@ -101,43 +82,81 @@ compute_expstr_ch(A52ExponentFunctions *expf, uint8_t *exp[A52_NUM_BLOCKS],
 }
 
 /**
- * Runs the per-channel exponent strategy decision function for all channels
+ * Number of strategy sets to search for a single channel in adaptive mode.
+ * The spectral flux is how much the exponent sum of each band of 16
+ * coefficients changes from one block to the next.  Single coefficients
+ * are too noisy for this.  A channel with a flux of half an exponent per
+ * coefficient, about what stationary signals give, searches avg sets.
+ */
+static int
+adaptive_search_size(uint8_t *exp[A52_NUM_BLOCKS], int ncoefs, int avg,
+                     int max_size)
+{
+    int blk, i, k, end, sum, last_sum, flux, size;
+
+    flux = 0;
+    for (i = 0; i < ncoefs; i += 16) {
+        end = MIN(i + 16, ncoefs);
+        last_sum = 0;
+        for (k = i; k < end; k++)
+            last_sum += exp[0][k];
+        for (blk = 1; blk < A52_NUM_BLOCKS; blk++) {
+            sum = 0;
+            for (k = i; k < end; k++)
+                sum += exp[blk][k];
+            flux += abs(sum - last_sum);
+            last_sum = sum;
+        }
+    }
+    // avg * flux per coefficient and block / (1/2), rounded
+    size = (2 * avg * flux + (5 * ncoefs) / 2) / (5 * ncoefs);
+    return CLIP(size, 1, max_size);
+}
+
+/**
+ * Runs the exponent strategy decision function for a single channel
  */
 static void
-compute_exponent_strategy(A52ThreadContext *tctx)
+compute_exponent_strategy(A52ThreadContext *tctx, int ch)
 {
     A52Context *ctx = tctx->ctx;
     A52Frame *frame = &tctx->frame;
     A52Block *blocks = frame->blocks;
-    int *ncoefs = frame->ncoefs;
-    uint8_t *exp[A52_MAX_CHANNELS][A52_NUM_BLOCKS];
-    int ch, blk, str;
-
-    for (ch = 0; ch < ctx->n_channels; ch++) {
-        str = expstr_set_search_order_tab[0];
-        if (ctx->params.expstr_search > 1) {
-            for (blk = 0; blk < A52_NUM_BLOCKS; blk++)
-                exp[ch][blk] = blocks[blk].exp[ch];
-            str = compute_expstr_ch(&ctx->expf, exp[ch], ncoefs[ch], ctx->params.expstr_search);
-        }
-        for (blk = 0; blk < A52_NUM_BLOCKS; blk++)
-            blocks[blk].exp_strategy[ch] = a52_expstr_set_tab[str][blk];
-        frame->expstr_set[ch] = str;
-    }
+    uint8_t *exp[A52_NUM_BLOCKS];
+    int blk, str, search_size;
 
     // lfe channel
-    if (ctx->lfe) {
+    if (ch == ctx->lfe_channel) {
         for (blk = 0; blk < A52_NUM_BLOCKS; blk++)
-            blocks[blk].exp_strategy[ctx->lfe_channel] = !blk ? EXP_D15 : EXP_REUSE;
+            blocks[blk].exp_strategy[ch] = !blk ? EXP_D15 : EXP_REUSE;
+        frame->expstr_search[ch] = 1;
+        return;
+    }
+
+    for (blk = 0; blk < A52_NUM_BLOCKS; blk++)
+        exp[blk] = blocks[blk].exp[ch];
+    search_size = ctx->params.expstr_search;
+    if (ctx->params.expstr_search_avg > 0) {
+        search_size = adaptive_search_size(exp, frame->ncoefs[ch],
+                                           ctx->params.expstr_search_avg,
+                                           search_size);
     }
+
+    str = expstr_set_search_order_tab[0];
+    if (search_size > 1)
+        str = compute_expstr_ch(&ctx->expf, exp, frame->ncoefs[ch], search_size);
+    for (blk = 0; blk < A52_NUM_BLOCKS; blk++)
+        blocks[blk].exp_strategy[ch] = a52_expstr_set_tab[str][blk];
+    frame->expstr_set[ch] = str;
+    frame->expstr_search[ch] = search_size;
 }
 
 /**
  * Encode exponent groups.  3 exponents are in per 7-bit group.  The number of
  * groups varies depending on exponent strategy and bandwidth
  */
-static void
-group_exponents(A52ThreadContext *tctx)
+void
+a52_group_exponents(A52ThreadContext *tctx)
 {
     A52Context *ctx = tctx->ctx;
     A52Frame *frame = &tctx->frame;
@@ -189,37 +208,34 @@ group_exponents(A52ThreadContext *tctx)
 }
 
 /**
- * Creates final exponents for the entire frame based on exponent strategies.
- * If the strategy for a block & channel is EXP_REUSE, exponents are copied,
+ * Creates final exponents for one channel based on exponent strategies.
+ * If the strategy for a block is EXP_REUSE, exponents are copied,
  * otherwise they are encoded according to the specific exponent strategy.
  */
 static void
-encode_exponents(A52ThreadContext *tctx)
+encode_exponents(A52ThreadContext *tctx, int ch)
 {
     A52Context *ctx = tctx->ctx;
-    A52Frame *frame = &tctx->frame;
-    A52Block *blocks = frame->blocks;
-    int *ncoefs = frame->ncoefs;
-    int ch, i, j, k;
-
-    for (ch = 0; ch < ctx->n_all_channels; ch++) {
-        // compute the exponents as the decoder will see them. The
-        // EXP_REUSE case must be handled carefully : we select the
-        // min of the exponents
-        i = 0;
-        while (i < A52_NUM_BLOCKS) {
-            j = i + 1;
-            while (j < A52_NUM_BLOCKS && blocks[j].exp_strategy[ch]==EXP_REUSE) {
-                ctx->expf.exponent_min(blocks[i].exp[ch], blocks[i].exp[ch], blocks[j].exp[ch], ncoefs[ch]);
-                j++;
-            }
-            ctx->expf.encode_exp_blk_ch(blocks[i].exp[ch], ncoefs[ch],
-                              blocks[i].exp_strategy[ch]);
-            // copy encoded exponents for reuse case
-            for (k = i+1; k < j; k++)
-                memcpy(blocks[k].exp[ch], blocks[i].exp[ch], ncoefs[ch]);
-            i = j;
+    A52Block *blocks = tctx->frame.blocks;
+    int ncoefs = tctx->frame.ncoefs[ch];
+    int i, j, k;
+
+    // compute the exponents as the decoder will see them. The
+    // EXP_REUSE case must be handled carefully : we select the
+    // min of the exponents
+    i = 0;
+    while (i < A52_NUM_BLOCKS) {
+        j = i + 1;
+        while (j < A52_NUM_BLOCKS && blocks[j].exp_strategy[ch]==EXP_REUSE) {
+            ctx->expf.exponent_min(blocks[i].exp[ch], blocks[i].exp[ch], blocks[j].exp[ch], ncoefs);
+            j++;
         }
+        ctx->expf.encode_exp_blk_ch(blocks[i].exp[ch], ncoefs,
+                          blocks[i].exp_strategy[ch]);
+        // copy encoded exponents for reuse case
+        for (k = i+1; k < j; k++)
+            memcpy(blocks[k].exp[ch], blocks[i].exp[ch], ncoefs);
+        i = j;
     }
 }
 
@@ -227,24 +243,27 @@ encode_exponents(A52ThreadContext *tctx)
  * Extracts the optimal exponent portion of each MDCT coefficient.
  */
 static void
-extract_exponents(A52ThreadContext *tctx)
+extract_exponents(uint8_t *exp, FLOAT *coef, int n)
+{
+    int j;
+
+    for (j = 0; j < n; j += 2) {
+        uint32_t v1 = (uint32_t)AFT_FABS(coef[j  ] * FCONST(16777216.0));
+        uint32_t v2 = (uint32_t)AFT_FABS(coef[j+1] * FCONST(16777216.0));
+        exp[j  ] = (v1 == 0)? 24 : 23 - log2i(v1);
+        exp[j+1] = (v2 == 0)? 24 : 23 - log2i(v2);
+    }
+}
+
+static void
+extract_exponents_ch(A52ThreadContext *tctx, int ch)
 {
     A52Frame *frame = &tctx->frame;
-    int all_channels = tctx->ctx->n_all_channels;
-    int blk, ch, j;
-
-    for (ch = 0; ch < all_channels; ch++) {
-        for (blk = 0; blk < A52_NUM_BLOCKS; blk++) {
-            A52Block* block = &frame->blocks[blk];
-			uint8_t* currentExp = block->exp[ch];
-			FLOAT* currentCoef = block->mdct_coef[ch];
-            for (j = 0; j < 256; j += 2) {
-                uint32_t v1 = (uint32_t)AFT_FABS(currentCoef[j  ] * FCONST(16777216.0));
-                uint32_t v2 = (uint32_t)AFT_FABS(currentCoef[j+1] * FCONST(16777216.0));
-                currentExp[j  ] = (v1 == 0)? 24 : 23 - log2i(v1);
-                currentExp[j+1] = (v2 == 0)? 24 : 23 - log2i(v2);
-            }
-        }
+    int blk;
+
+    for (blk = 0; blk < A52_NUM_BLOCKS; blk++) {
+        A52Block *block = &frame->blocks[blk];
+        tctx->ctx->expf.extract_exponents(block->exp[ch], block->mdct_coef[ch], 256);
     }
 }
 
@@ -313,35 +332,57 @@ encode_exp_blk_ch(uint8_t *exp, int ncoefs, int exp_strategy)
 
 
 static int
-exponent_sum_square_error(uint8_t *exp0, uint8_t *exp1, int ncoefs)
+exponent_run_error(uint8_t **exp, int nblks, int ncoefs, int exp_strategy)
 {
-    int i, err;
+    uint8_t dec[256];
+    int b, k, n, err;
     int exp_error = 0;
 
-	if (exp0 == exp1)
-		return 0;
-
-    for (i = 0; i < ncoefs; i++) {
-        err = exp0[i] - exp1[i];
-        exp_error += (err * err);
+    // minimum over the blocks, coded as the first block of the run would be.
+    // the last group can reach past ncoefs.
+    n = (nexpgrptab[exp_strategy-1][ncoefs] * 3 << (exp_strategy-1)) + 1;
+    n = MAX(n, ncoefs);
+    memcpy(dec, exp[0], n);
+    for (b = 1; b < nblks; b++)
+        for (k = 0; k < n; k++)
+            dec[k] = MIN(dec[k], exp[b][k]);
+    encode_exp_blk_ch(dec, ncoefs, exp_strategy);
+
+    for (b = 0; b < nblks; b++) {
+        for (k = 0; k < ncoefs; k++) {
+            err = exp[b][k] - dec[k];
+            exp_error += err * err;
+        }
     }
     return exp_error;
 }
 
 
+/**
+ * Extracts, analyzes, and encodes the exponents of a single channel
+ */
+void
+a52_process_exponents_ch(A52ThreadContext *tctx, int ch)
+{
+    extract_exponents_ch(tctx, ch);
+
+    compute_exponent_strategy(tctx, ch);
+
+    encode_exponents(tctx, ch);
+}
+
 /**
  * Runs all the processes in extracting, analyzing, and encoding exponents
  */
 void
 a52_process_exponents(A52ThreadContext *tctx)
 {
-    extract_exponents(tctx);
+    int ch;
 
-    compute_exponent_strategy(tctx);
+    for (ch = 0; ch < tctx->ctx->n_all_channels; ch++)
+        a52_process_exponents_ch(tctx, ch);
 
-    encode_exponents(tctx);
-
-    group_exponents(tctx);
+    a52_group_exponents(tctx);
 }
 
 
@@ -380,19 +421,41 @@ exponent_init(A52ExponentFunctions *expf)
 
     expf->exponent_min = exponent_min;
     expf->encode_exp_blk_ch = encode_exp_blk_ch;
-    expf->exponent_sum_square_error = exponent_sum_square_error;
+    expf->exponent_run_error = exponent_run_error;
+    expf->extract_exponents = extract_exponents;
 #ifdef HAVE_MMX
     if (cpu_caps_have_mmx()) {
         expf->exponent_min = exponent_min_mmx;
         expf->encode_exp_blk_ch = encode_exp_blk_ch_mmx;
-        expf->exponent_sum_square_error = exponent_sum_square_error_mmx;
     }
 #endif /* HAVE_MMX */
 #ifdef HAVE_SSE2
     if (cpu_caps_have_sse2()) {
         expf->exponent_min = exponent_min_sse2;
         expf->encode_exp_blk_ch = encode_exp_blk_ch_sse2;
-        expf->exponent_sum_square_error = exponent_sum_square_error_sse2;
+        expf->exponent_run_error = exponent_run_error_sse2;
+#ifdef CONFIG_DOUBLE
+        expf->extract_exponents = extract_exponents_sse2_pd;
+#else
+        expf->extract_exponents = extract_exponents_sse2;
+#endif
     }
 #endif /* HAVE_SSE2 */
+#ifdef HAVE_AVX2
+    if (cpu_caps_have_avx2()) {
+        expf->exponent_min = exponent_min_avx2;
+        expf->encode_exp_blk_ch = encode_exp_blk_ch_avx2;
+        expf->exponent_run_error = exponent_run_error_avx2;
+#ifndef CONFIG_DOUBLE
+        expf->extract_exponents = extract_exponents_avx2;
+#endif
+    }
+#endif /* HAVE_AVX2 */
+#ifdef HAVE_AVX512BW
+    if (cpu_caps_have_avx512bw()) {
+        expf->exponent_min = exponent_min_avx512bw;
+        expf->encode_exp_blk_ch = encode_exp_blk_ch_avx512bw;
+        expf->exponent_run_error = exponent_run_error_avx512bw;
+    }
+#endif /* HAVE_AVX512BW */
 }
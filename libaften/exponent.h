@@ -54,9 +54,18 @@ typedef struct A52ExponentFunctions {
     void (*encode_exp_blk_ch)(uint8_t *exp, int ncoefs, int exp_strategy);
 
     /**
-     * Calculate sum of squared error between 2 sets of exponents.
+     * Calculate sum of squared error between the exponents of nblks blocks
+     * and the exponents the decoder will see if the blocks share one set,
+     * encoded with exp_strategy.  Gives the same result as exponent_min over
+     * the blocks and encode_exp_blk_ch, without writing the encoded set.
      */
-    int (*exponent_sum_square_error)(uint8_t *exp0, uint8_t *exp1, int ncoefs);
+    int (*exponent_run_error)(uint8_t **exp, int nblks, int ncoefs, int exp_strategy);
+
+    /**
+     * Extract the exponent of each of the n MDCT coefficients in coef.
+     * n must be a multiple of 8.
+     */
+    void (*extract_exponents)(uint8_t *exp, FLOAT *coef, int n);
 
 } A52ExponentFunctions;
 
@@ -64,4 +73,12 @@ extern void exponent_init(A52ExponentFunctions *expf);
 
 extern void a52_process_exponents(struct A52ThreadContext *tctx);
 
+/**
+ * The two halves of a52_process_exponents.  a52_process_exponents_ch only
+ * touches the given channel, so it can run for all channels concurrently.
+ */
+extern void a52_process_exponents_ch(struct A52ThreadContext *tctx, int ch);
+
+extern void a52_group_exponents(struct A52ThreadContext *tctx);
+
 #endif /* EXPONENT_H */
@@ -366,6 +366,27 @@ filter_run(FilterContext *f, FLOAT *out, FLOAT *in, int n)
     f->filter->filter(f, out, in, n);
 }
 
+int
+filter_copy(FilterContext *dst, const FilterContext *src)
+{
+    void *private_context = dst->private_context;
+
+    if (!src->filter) {
+        filter_close(dst);
+        return 0;
+    }
+    if (!private_context) {
+        private_context = calloc(src->filter->private_size, 1);
+        if (!private_context)
+            return -1;
+    }
+    *dst = *src;
+    dst->private_context = private_context;
+    memcpy(dst->private_context, src->private_context, src->filter->private_size);
+
+    return 0;
+}
+
 void
 filter_close(FilterContext *f)
 {
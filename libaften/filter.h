@@ -60,6 +60,12 @@ extern int filter_init(FilterContext *f, enum FilterID id);
 
 extern void filter_run(FilterContext *f, FLOAT *out, FLOAT *in, int n);
 
+/**
+ * Copies filter src together with its state.  dst must either be unused
+ * (zeroed) or an earlier copy of the same filter.
+ */
+extern int filter_copy(FilterContext *dst, const FilterContext *src);
+
 extern void filter_close(FilterContext *f);
 
 #endif /* FILTER_H */
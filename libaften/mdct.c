@@ -41,6 +41,37 @@
 #include "mdct.h"
 #include "cpu_caps.h"
 #include "mem.h"
+#include "window.h"
+
+/** transforms the windows one after another */
+static void
+mdct_batch_serial(MDCTThreadContext *tmdct, FLOAT **out, FLOAT **in, int count,
+                  UNUSED(int ncoefs))
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+        tmdct->mdct->mdct(tmdct, out[i], in[i]);
+}
+
+static void
+mdct_direct(MDCTContext *mdct, FLOAT *out, FLOAT *in, int ncoefs)
+{
+    int n = mdct->n;
+    int i, k;
+
+    for (k = 0; k < ncoefs; k++) {
+        FLOAT *t = mdct->direct_trig + k*n;
+        FLOAT s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        for (i = 0; i < n; i += 4) {
+            s0 += in[i  ] * t[i  ];
+            s1 += in[i+1] * t[i+1];
+            s2 += in[i+2] * t[i+2];
+            s3 += in[i+3] * t[i+3];
+        }
+        out[k] = (s0 + s1) + (s2 + s3);
+    }
+}
 
 /**
  * Allocates and initializes lookup tables in the MDCT context.
@@ -58,6 +89,9 @@ mdct_ctx_init(MDCTContext *mdct, int n)
     mdct->n = n;
     mdct->trig = trig;
     mdct->bitrev = bitrev;
+    mdct->mdct_batch = mdct_batch_serial;
+    mdct->mdct_direct = mdct_direct;
+    mdct->batch_buffer_size = 0;
 
     // trig lookups
     for (i = 0; i < n/4; i++) {
@@ -89,6 +123,41 @@ mdct_ctx_init(MDCTContext *mdct, int n)
 
     // MDCT scale used in AC3
     mdct->scale = FCONST(-2.0) / n;
+
+    // rectangular until mdct_ctx_set_window is called
+    mdct->window = aligned_malloc(n * sizeof(FLOAT));
+    for (i = 0; i < n; i++)
+        mdct->window[i] = FCONST(1.0);
+
+    // basis functions of the lowest coefficients, scale included:
+    // cos(2*pi/n * (j + 1/2 + n/4) * (i + 1/2)), with the phase reduced
+    // modulo 2*pi before it is turned into a float
+    mdct->direct_trig = aligned_malloc(MDCT_DIRECT_MAX_COEFS * n * sizeof(FLOAT));
+    for (i = 0; i < MDCT_DIRECT_MAX_COEFS; i++) {
+        int j;
+        for (j = 0; j < n; j++) {
+            int phase = ((2*j + 1 + n2) * (2*i + 1)) % (4*n);
+            mdct->direct_trig[i*n+j] = mdct->scale *
+                AFT_COS((AFT_PI/(2*n)) * phase);
+        }
+    }
+}
+
+/**
+ * Sets the window the transforms apply to their input.  It is multiplied
+ * in while the samples are read, so the input buffer is never modified.
+ */
+static void
+mdct_ctx_set_window(MDCTContext *mdct, const FLOAT *window)
+{
+    int n = mdct->n;
+    int i, k;
+
+    for (i = 0; i < n; i++)
+        mdct->window[i] = window[i];
+    for (k = 0; k < MDCT_DIRECT_MAX_COEFS; k++)
+        for (i = 0; i < n; i++)
+            mdct->direct_trig[k*n+i] *= window[i];
 }
 
 /** Deallocates memory use by the lookup tables in the MDCT context. */
@@ -100,6 +169,10 @@ mdct_ctx_close(MDCTContext *mdct)
             aligned_free(mdct->trig);
         if (mdct->bitrev)
             aligned_free(mdct->bitrev);
+        if (mdct->direct_trig)
+            aligned_free(mdct->direct_trig);
+        if (mdct->window)
+            aligned_free(mdct->window);
 #ifndef CONFIG_DOUBLE
 #ifdef HAVE_SSE
         if (mdct->trig_bitreverse)
@@ -117,28 +190,48 @@ mdct_ctx_close(MDCTContext *mdct)
         if (mdct->trig_butterfly_generic64)
             aligned_free(mdct->trig_butterfly_generic64);
 #endif
+#ifdef HAVE_AVX2
+        if (mdct->trig_bitreverse_avx2)
+            aligned_free(mdct->trig_bitreverse_avx2);
+        if (mdct->trig_forward_avx2)
+            aligned_free(mdct->trig_forward_avx2);
+        if (mdct->trig_butterfly_first_avx2)
+            aligned_free(mdct->trig_butterfly_first_avx2);
+        if (mdct->trig_butterfly_generic8_avx2)
+            aligned_free(mdct->trig_butterfly_generic8_avx2);
+        if (mdct->trig_butterfly_generic16_avx2)
+            aligned_free(mdct->trig_butterfly_generic16_avx2);
+#endif
 #endif
         memset(mdct, 0, sizeof(MDCTContext));
     }
 }
 
 /** Allocates internal buffers for MDCT calculation. */
-static void
-mdct_tctx_init(MDCTThreadContext *tmdct, int n)
+void
+mdct_tctx_init(MDCTThreadContext *tmdct, MDCTContext *mdct)
 {
+    int n = mdct->n;
+
+    tmdct->mdct = mdct;
     tmdct->buffer  = aligned_malloc((n+2) * sizeof(FLOAT)); /* +2 to prevent illegal read in bitreverse */
-    tmdct->buffer1 = aligned_malloc( n    * sizeof(FLOAT));
+    tmdct->buffer1 = aligned_malloc(2 * n * sizeof(FLOAT)); /* second short block transform, or split short block input on AltiVec */
+    tmdct->batch_buffer = NULL;
+    if (mdct->batch_buffer_size)
+        tmdct->batch_buffer = aligned_malloc(mdct->batch_buffer_size * sizeof(FLOAT));
 }
 
 /** Deallocates internal buffers for MDCT calculation. */
-static void
-tctx_close(MDCTThreadContext *tmdct)
+void
+mdct_tctx_close(MDCTThreadContext *tmdct)
 {
     if (tmdct) {
         if(tmdct->buffer)
             aligned_free(tmdct->buffer);
         if(tmdct->buffer1)
             aligned_free(tmdct->buffer1);
+        if(tmdct->batch_buffer)
+            aligned_free(tmdct->batch_buffer);
     }
 }
 
@@ -428,73 +521,104 @@ mdct_bitreverse(MDCTContext *mdct, FLOAT *x)
     } while (w0 < w1);
 }
 
-static void
-mdct(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
+/**
+ * Pre-twiddle of n/8 sample pairs.  x0 walks down, x1 up the input, both
+ * stay within one quarter.  The window is applied as the samples are read,
+ * s0 and s1 are the signs the two quarters enter with.
+ */
+static inline void
+mdct_pretwiddle_pairs(FLOAT *w2, const FLOAT *trig, int count,
+                      const FLOAT *x0, const FLOAT *w0, FLOAT s0,
+                      const FLOAT *x1, const FLOAT *w1, FLOAT s1)
 {
-    MDCTContext *mdct = tmdct->mdct;
-    int n = mdct->n;
-    int n2 = n>>1;
-    int n4 = n>>2;
-    int n8 = n>>3;
-    FLOAT *w = tmdct->buffer;
-    FLOAT *w2 = w+n2;
-    FLOAT *x0 = in+n2+n4;
-    FLOAT *x1 = x0+1;
-    FLOAT *trig = mdct->trig + n2;
-    FLOAT r0;
-    FLOAT r1;
+    FLOAT r0, r1;
     int i;
 
-    for (i = 0; i < n8; i += 2) {
+    for (i = 0; i < count; i += 2) {
         x0 -= 4;
+        w0 -= 4;
         trig -= 2;
-        r0 = x0[2] + x1[0];
-        r1 = x0[0] + x1[2];
-        w2[i]   = (r1*trig[1] + r0*trig[0]);
-        w2[i+1] = (r1*trig[0] - r0*trig[1]);
-        x1 += 4;
-    }
-
-    x1 = in+1;
-    for (; i < n2-n8; i += 2) {
-        trig -= 2;
-        x0 -= 4;
-        r0 = x0[2] - x1[0];
-        r1 = x0[0] - x1[2];
+        r0 = s0*x0[2]*w0[2] + s1*x1[0]*w1[0];
+        r1 = s0*x0[0]*w0[0] + s1*x1[2]*w1[2];
         w2[i]   = (r1*trig[1] + r0*trig[0]);
         w2[i+1] = (r1*trig[0] - r0*trig[1]);
         x1 += 4;
+        w1 += 4;
     }
+}
 
-    x0 = in+n;
-    for (; i < n2; i += 2) {
-        trig -= 2;
-        x0 -= 4;
-        r0 = -x0[2] - x1[0];
-        r1 = -x0[0] - x1[2];
-        w2[i]   = (r1*trig[1] + r0*trig[0]);
-        w2[i+1] = (r1*trig[0] - r0*trig[1]);
-        x1 += 4;
-    }
+/**
+ * Pre-twiddles the input into the upper half of w.  Quarter q of the
+ * transform input starts at x[q], its window at xw[q], and it is negated if
+ * bit q of neg is set.  This lets the short block transforms read their
+ * rearranged input directly.
+ */
+static void
+mdct_pretwiddle(MDCTContext *mdct, FLOAT *w2, const FLOAT *const *x,
+                const FLOAT *const *xw, int neg)
+{
+    int n = mdct->n;
+    int n2 = n>>1;
+    int n4 = n>>2;
+    int n8 = n>>3;
+    FLOAT *trig = mdct->trig + n2;
+    FLOAT sg[4];
+    int q;
+
+    for (q = 0; q < 4; q++)
+        sg[q] = (neg >> q) & 1 ? -ONE : ONE;
+
+    mdct_pretwiddle_pairs(w2, trig, n8, x[2]+n4, xw[2]+n4, sg[2],
+                          x[3]+1, xw[3]+1, sg[3]);
+    mdct_pretwiddle_pairs(w2+n8, trig-n8, n8, x[1]+n4, xw[1]+n4, sg[1],
+                          x[0]+1, xw[0]+1, -sg[0]);
+    mdct_pretwiddle_pairs(w2+n4, trig-n4, n8, x[0]+n4, xw[0]+n4, sg[0],
+                          x[1]+1, xw[1]+1, -sg[1]);
+    mdct_pretwiddle_pairs(w2+n4+n8, trig-n4-n8, n8, x[3]+n4, xw[3]+n4, -sg[3],
+                          x[2]+1, xw[2]+1, -sg[2]);
+}
 
-    mdct_butterflies(mdct, w2, n2);
-    mdct_bitreverse(mdct, w);
+/** post-rotation, the coefficients are written stride FLOATs apart */
+static void
+mdct_rotate(MDCTContext *mdct, FLOAT *out, FLOAT *w, int stride)
+{
+    int n2 = mdct->n>>1;
+    int n4 = mdct->n>>2;
+    FLOAT *trig = mdct->trig+n2;
+    int x0 = n2;
+    int i;
 
-    trig = mdct->trig+n2;
-    x0 = out+n2;
     for (i = 0; i < n4; i++) {
         x0--;
-        out[i] = ((w[0]*trig[0]+w[1]*trig[1])*mdct->scale);
-        x0[0]  = ((w[0]*trig[1]-w[1]*trig[0])*mdct->scale);
+        out[i*stride]  = ((w[0]*trig[0]+w[1]*trig[1])*mdct->scale);
+        out[x0*stride] = ((w[0]*trig[1]-w[1]*trig[0])*mdct->scale);
         w += 2;
         trig += 2;
     }
 }
 
 static void
-mdct_512(A52ThreadContext *tctx, FLOAT *out, FLOAT *in)
+mdct(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
+{
+    MDCTContext *mdct = tmdct->mdct;
+    int n = mdct->n;
+    int n2 = n>>1;
+    int n4 = n>>2;
+    FLOAT *w = tmdct->buffer;
+    FLOAT *win = mdct->window;
+    const FLOAT *x[4] = { in, in+n4, in+n2, in+n2+n4 };
+    const FLOAT *xw[4] = { win, win+n4, win+n2, win+n2+n4 };
+
+    mdct_pretwiddle(mdct, w+n2, x, xw, 0);
+    mdct_butterflies(mdct, w+n2, n2);
+    mdct_bitreverse(mdct, w);
+    mdct_rotate(mdct, out, w, 1);
+}
+
+static void
+mdct_512(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
 {
-    mdct(&tctx->mdct_tctx_512, out, in);
+    mdct(tmdct, out, in);
 }
 
 #if 0
@@ -525,33 +649,32 @@ mdct_256(A52Context *ctx, FLOAT *out, FLOAT *in)
     }
 }
 #else
+/**
+ * Both short block transforms in one go.  Each one is a 256-point MDCT of a
+ * rotated half of the input, with some of its quarters negated.  The
+ * quarters are read in place with the A/52 window, and the two results are
+ * rotated straight into their interleaved positions.
+ */
 static void
-mdct_256(A52ThreadContext *tctx, FLOAT *out, FLOAT *in)
+mdct_256(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
 {
-    FLOAT *coef_a = in;
-    FLOAT *coef_b = in+128;
-    FLOAT *xx = tctx->mdct_tctx_256.buffer1;
-    int i;
-
-    memcpy(xx, in+64, 192 * sizeof(FLOAT));
-    for (i = 0; i < 64; i++)
-        xx[i+192] = -in[i];
-
-    mdct(&tctx->mdct_tctx_256, coef_a, xx);
-
-    for (i = 0; i < 64; i++)
-        xx[i] = -in[i+256+192];
-
-    memcpy(xx+64, in+256, 128 * sizeof(FLOAT));
-    for (i = 0; i < 64; i++)
-        xx[i+192] = -in[i+256+128];
-
-    mdct(&tctx->mdct_tctx_256, coef_b, xx);
-
-    for (i = 0; i < 128; i++) {
-        out[2*i  ] = coef_a[i];
-        out[2*i+1] = coef_b[i];
-    }
+    MDCTContext *mdct = tmdct->mdct;
+    FLOAT *wa = tmdct->buffer;
+    FLOAT *wb = tmdct->buffer1;
+    const FLOAT *win = a52_window;
+    const FLOAT *xa[4]  = { in+64,  in+128,  in+192,  in      };
+    const FLOAT *xwa[4] = { win+64, win+128, win+192, win     };
+    const FLOAT *xb[4]  = { in+448, in+256,  in+320,  in+384  };
+    const FLOAT *xwb[4] = { win+448, win+256, win+320, win+384 };
+
+    mdct_pretwiddle(mdct, wa+128, xa, xwa, 0x8);
+    mdct_pretwiddle(mdct, wb+128, xb, xwb, 0x9);
+    mdct_butterflies(mdct, wa+128, 128);
+    mdct_butterflies(mdct, wb+128, 128);
+    mdct_bitreverse(mdct, wa);
+    mdct_bitreverse(mdct, wb);
+    mdct_rotate(mdct, out,   wa, 2);
+    mdct_rotate(mdct, out+1, wb, 2);
 }
 #endif
 
@@ -590,16 +713,22 @@ mdct_close(A52Context *ctx)
 void
 mdct_thread_close(A52ThreadContext *tctx)
 {
-    tctx_close(&tctx->mdct_tctx_512);
-    tctx_close(&tctx->mdct_tctx_256);
+    mdct_tctx_close(&tctx->mdct_tctx_512);
+    mdct_tctx_close(&tctx->mdct_tctx_256);
 
     aligned_free(tctx->frame.blocks[0].input_samples[0]);
 }
 
-void
-mdct_init(A52Context *ctx)
+static void
+mdct_init_funcs(A52Context *ctx)
 {
 #ifndef CONFIG_DOUBLE
+#ifdef HAVE_AVX2
+    if (cpu_caps_have_avx() && cpu_caps_have_avx2() && cpu_caps_have_fma()) {
+        mdct_init_avx2(ctx);
+        return;
+    }
+#endif
 #ifdef HAVE_SSE3
     if (cpu_caps_have_sse3()) {
         mdct_init_sse3(ctx);
@@ -625,16 +754,37 @@ mdct_init(A52Context *ctx)
 
     ctx->mdct_ctx_512.mdct = mdct_512;
     ctx->mdct_ctx_256.mdct = mdct_256;
+
+#ifdef CONFIG_DOUBLE
+    // the double precision versions replace the batched and the short block
+    // transforms, and give the same results
+#ifdef HAVE_SSE2
+    if (cpu_caps_have_sse2())
+        mdct_init_sse2_pd(ctx);
+#endif
+#ifdef HAVE_AVX
+    if (cpu_caps_have_avx())
+        mdct_init_avx_pd(ctx);
+#endif
+#endif /* CONFIG_DOUBLE */
 }
 
 void
-mdct_thread_init(A52ThreadContext *tctx)
+mdct_init(A52Context *ctx)
 {
-    mdct_tctx_init(&tctx->mdct_tctx_512, 512);
-    mdct_tctx_init(&tctx->mdct_tctx_256, 256);
+    a52_window_init();
+    mdct_init_funcs(ctx);
+
+    // the 256-point kernel stays rectangular, the short block transforms
+    // apply the A/52 window while they split the input
+    mdct_ctx_set_window(&ctx->mdct_ctx_512, a52_window);
+}
 
-    tctx->mdct_tctx_512.mdct = &tctx->ctx->mdct_ctx_512;
-    tctx->mdct_tctx_256.mdct = &tctx->ctx->mdct_ctx_256;
+void
+mdct_thread_init(A52ThreadContext *tctx)
+{
+    mdct_tctx_init(&tctx->mdct_tctx_512, &tctx->ctx->mdct_ctx_512);
+    mdct_tctx_init(&tctx->mdct_tctx_256, &tctx->ctx->mdct_ctx_256);
 
     tctx->frame.blocks[0].input_samples[0] =
         aligned_malloc(A52_NUM_BLOCKS * A52_MAX_CHANNELS * (256 + 512) * sizeof(FLOAT));
@@ -55,16 +55,40 @@
 #define AFT_PI2_8 FCONST(0.70710678118654752441)
 #define AFT_PI1_8 FCONST(0.92387953251128675613)
 
+/** maximum number of windows mdct_batch transforms at once */
+#define MDCT_MAX_BATCH 8
+
+/**
+ * Largest number of coefficients computed by mdct_direct.  Enough for the
+ * LFE channel, which only codes 7.  The SIMD versions assume 8.
+ */
+#define MDCT_DIRECT_MAX_COEFS 8
+
 struct A52Context;
 struct A52ThreadContext;
+struct MDCTThreadContext;
 
 typedef struct MDCTContext {
-    void (*mdct)(struct A52ThreadContext *ctx, FLOAT *out, FLOAT *in);
+    void (*mdct)(struct MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in);
+    /**
+     * Transforms count <= MDCT_MAX_BATCH windows, in[i] into out[i].  The
+     * result of a window does not depend on the others in the batch.
+     * Coefficients from ncoefs up may be left uncomputed.
+     */
+    void (*mdct_batch)(struct MDCTThreadContext *tmdct, FLOAT **out, FLOAT **in,
+                       int count, int ncoefs);
+    /**
+     * Computes only the first ncoefs <= MDCT_DIRECT_MAX_COEFS coefficients,
+     * straight from the MDCT definition.  Needs no scratch buffers.
+     */
+    void (*mdct_direct)(struct MDCTContext *mdct, FLOAT *out, FLOAT *in, int ncoefs);
     void (*mdct_bitreverse)(struct MDCTContext *mdct, FLOAT *x);
     void (*mdct_butterfly_generic)(struct MDCTContext *mdct, FLOAT *x, int points, int trigint);
     void (*mdct_butterfly_first)(FLOAT *trig, FLOAT *x, int points);
     void (*mdct_butterfly_32)(FLOAT *x);
     FLOAT *trig;
+    FLOAT *direct_trig;  // MDCT_DIRECT_MAX_COEFS rows of n basis functions
+    FLOAT *window;       // applied to the input while it is read
 #ifndef CONFIG_DOUBLE
 #ifdef HAVE_SSE
     FLOAT *trig_bitreverse;
@@ -75,17 +99,27 @@ typedef struct MDCTContext {
     FLOAT *trig_butterfly_generic32;
     FLOAT *trig_butterfly_generic64;
 #endif
+#ifdef HAVE_AVX2
+    FLOAT *trig_bitreverse_avx2;
+    FLOAT *trig_forward_avx2;
+    FLOAT *trig_butterfly_first_avx2;
+    FLOAT *trig_butterfly_generic8_avx2;
+    FLOAT *trig_butterfly_generic16_avx2;
+#endif
 #endif /* CONFIG_DOUBLE */
     int *bitrev;
     FLOAT scale;
     int n;
     int log2n;
+    int batch_buffer_size;  // scratch space needed by mdct_batch, in FLOATs
 } MDCTContext;
 
-typedef struct {
+/** scratch buffers, one set for each transform that can run concurrently */
+typedef struct MDCTThreadContext {
     MDCTContext *mdct;
     FLOAT *buffer;
     FLOAT *buffer1;
+    FLOAT *batch_buffer;
 } MDCTThreadContext;
 
 extern void mdct_ctx_init(MDCTContext *mdct, int n);
@@ -93,5 +127,7 @@ extern void mdct_init(struct A52Context *ctx);
 extern void mdct_close(struct A52Context *ctx);
 extern void mdct_thread_init(struct A52ThreadContext *tctx);
 extern void mdct_thread_close(struct A52ThreadContext *tctx);
+extern void mdct_tctx_init(MDCTThreadContext *tmdct, MDCTContext *mdct);
+extern void mdct_tctx_close(MDCTThreadContext *tmdct);
 
 #endif /* MDCT_H */
@@ -481,6 +481,15 @@ mdct_bitreverse_altivec(MDCTContext *mdct, FLOAT *x)
     } while (w2 > w0);
 }
 
+/** loads 4 input samples at p+off and applies the window */
+static inline vector float
+vec_ld_windowed(int off, FLOAT *p, FLOAT *in, FLOAT *win)
+{
+    vector float zero = (vector float) vec_splat_u32(0);
+
+    return vec_madd(vec_ld(off, p), vec_ld(off, win + (p - in)), zero);
+}
+
 static void
 mdct_altivec(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
 {
@@ -494,6 +503,7 @@ mdct_altivec(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
     FLOAT *x0 = in+n2+n4;
     FLOAT *x1 = x0;
     FLOAT *trig = mdct->trig + n2;
+    FLOAT *win = mdct->window;
     int i;
 
     vec_u8_t perm3210 = VPERMUTE4(3, 2, 1, 0);
@@ -521,10 +531,10 @@ mdct_altivec(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
         x0 -= 8;
         trig -= 4;
 
-        x0_0to3  = vec_ld(0x00, x0);
-        x0_4to7  = vec_ld(0x10, x0);
-        x1_0to3  = vec_ld(0x00, x1);
-        x1_4to7  = vec_ld(0x10, x1);
+        x0_0to3  = vec_ld_windowed(0x00, x0, in, win);
+        x0_4to7  = vec_ld_windowed(0x10, x0, in, win);
+        x1_0to3  = vec_ld_windowed(0x00, x1, in, win);
+        x1_4to7  = vec_ld_windowed(0x10, x1, in, win);
         trig0to3 = vec_ld(0, trig);
 
         v0 = vec_perm(x0_0to3, x0_4to7, perm4602);
@@ -551,10 +561,10 @@ mdct_altivec(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
         x0 -= 8;
         trig -= 4;
 
-        x0_0to3  = vec_ld(0x00, x0);
-        x0_4to7  = vec_ld(0x10, x0);
-        x1_0to3  = vec_ld(0x00, x1);
-        x1_4to7  = vec_ld(0x10, x1);
+        x0_0to3  = vec_ld_windowed(0x00, x0, in, win);
+        x0_4to7  = vec_ld_windowed(0x10, x0, in, win);
+        x1_0to3  = vec_ld_windowed(0x00, x1, in, win);
+        x1_4to7  = vec_ld_windowed(0x10, x1, in, win);
         trig0to3 = vec_ld(0, trig);
 
         v0 = vec_perm(x0_0to3, x0_4to7, perm4602);
@@ -581,10 +591,10 @@ mdct_altivec(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
         trig -= 4;
         x0 -= 8;
 
-        x0_0to3  = vec_ld(0x00, x0);
-        x0_4to7  = vec_ld(0x10, x0);
-        x1_0to3  = vec_ld(0x00, x1);
-        x1_4to7  = vec_ld(0x10, x1);
+        x0_0to3  = vec_ld_windowed(0x00, x0, in, win);
+        x0_4to7  = vec_ld_windowed(0x10, x0, in, win);
+        x1_0to3  = vec_ld_windowed(0x00, x1, in, win);
+        x1_4to7  = vec_ld_windowed(0x10, x1, in, win);
         trig0to3 = vec_ld(0, trig);
 
         v0 = vec_perm(x0_0to3, x0_4to7, perm4602);
@@ -647,43 +657,50 @@ mdct_altivec(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
 }
 
 static void
-mdct_512_altivec(A52ThreadContext *tctx, FLOAT *out, FLOAT *in)
+mdct_512_altivec(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
 {
-    mdct_altivec(&tctx->mdct_tctx_512, out, in);
+    mdct_altivec(tmdct, out, in);
 }
 
 static void
-mdct_256_altivec(A52ThreadContext *tctx, FLOAT *out, FLOAT *in)
+mdct_256_altivec(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
 {
-    FLOAT *coef_a = in;
-    FLOAT *coef_b = in+128;
-    FLOAT *xx = tctx->mdct_tctx_256.buffer1;
+    FLOAT *xx = tmdct->buffer1;
+    FLOAT *coef_a = xx+256;
+    FLOAT *coef_b = xx+384;
+    FLOAT *win = a52_window;
     int i;
     vector float v0, v1, v_coef_a, v_coef_b;
 
-    memcpy(xx, in+64, 192 * sizeof(FLOAT));
+    // the A/52 window is applied while the halves are put together
+    for (i = 0; i < 192; i += 4) {
+        v0 = vec_ld_windowed(0, in+i+64, in, win);
+        vec_st(v0, 0, xx+i);
+    }
     for (i = 0; i < 64; i += 4) {
-        v0 = vec_ld(0, in+i);
+        v0 = vec_ld_windowed(0, in+i, in, win);
         v0 = vec_xor(v0, (vector float) vNNNN);
         vec_st(v0, 0, xx+i+192);
     }
 
-    mdct_altivec(&tctx->mdct_tctx_256, coef_a, xx);
+    mdct_altivec(tmdct, coef_a, xx);
 
     for (i = 0; i < 64; i += 4) {
-        v0 = vec_ld(0, in+i+256+192);
+        v0 = vec_ld_windowed(0, in+i+256+192, in, win);
         v0 = vec_xor(v0, (vector float) vNNNN);
         vec_st(v0, 0, xx+i);
     }
-
-    memcpy(xx+64, in+256, 128 * sizeof(FLOAT));
+    for (i = 0; i < 128; i += 4) {
+        v0 = vec_ld_windowed(0, in+i+256, in, win);
+        vec_st(v0, 0, xx+i+64);
+    }
     for (i = 0; i < 64; i += 4) {
-        v0 = vec_ld(0, in+i+256+128);
+        v0 = vec_ld_windowed(0, in+i+256+128, in, win);
         v0 = vec_xor(v0, (vector float) vNNNN);
         vec_st(v0, 0, xx+i+192);
     }
 
-    mdct_altivec(&tctx->mdct_tctx_256, coef_b, xx);
+    mdct_altivec(tmdct, coef_b, xx);
 
     for (i = 0; i < 128; i += 4) {
         v_coef_a = vec_ld(0, coef_a+i);
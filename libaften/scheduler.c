@@ -0,0 +1,412 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * Work-stealing task scheduler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file scheduler.c
+ * Work-stealing task scheduler
+ */
+
+#include "scheduler.h"
+
+#ifndef NO_THREADS
+
+#define A52_DEQUE_INIT_SIZE 64
+
+static A52TaskArray *
+task_array_alloc(int size)
+{
+    A52TaskArray *a = calloc(1, sizeof(A52TaskArray));
+
+    if (!a)
+        return NULL;
+    a->tasks = calloc(size, sizeof(A52Task *));
+    if (!a->tasks) {
+        free(a);
+        return NULL;
+    }
+    a->mask = size - 1;
+    return a;
+}
+
+/** frees an array and the ones it replaced */
+static void
+task_array_free(A52TaskArray *a)
+{
+    while (a) {
+        A52TaskArray *retired = a->retired;
+        free((void *)a->tasks);
+        free(a);
+        a = retired;
+    }
+}
+
+/**
+ * Moves the tasks between top and bottom to an array twice as large.
+ * Returns the old array if there is no memory for a new one.
+ */
+static A52TaskArray *
+deque_grow(A52Worker *w, A52TaskArray *a, int top, int bottom)
+{
+    A52TaskArray *b = task_array_alloc(2 * (a->mask + 1));
+    int i;
+
+    if (!b)
+        return a;
+    for (i = top; i != bottom; i++)
+        b->tasks[i & b->mask] = a->tasks[i & a->mask];
+    b->retired = a;
+    memory_barrier();
+    w->array = b;
+    return b;
+}
+
+static void inject_push(A52Scheduler *sched, A52Task *task);
+
+static void
+deque_push_bottom(A52Worker *w, A52Task *task)
+{
+    int bottom = w->bottom;
+    A52TaskArray *a = w->array;
+
+    if (bottom - w->top > a->mask) {
+        a = deque_grow(w, a, w->top, bottom);
+        if (bottom - w->top > a->mask) {
+            inject_push(w->sched, task);
+            return;
+        }
+    }
+    a->tasks[bottom & a->mask] = task;
+    memory_barrier();
+    w->bottom = bottom + 1;
+}
+
+static A52Task *
+deque_pop_bottom(A52Worker *w)
+{
+    A52TaskArray *a;
+    A52Task *task;
+    int bottom, top;
+
+    bottom = w->bottom - 1;
+    if (bottom - w->top < 0)
+        return NULL;
+    a = w->array;
+    w->bottom = bottom;
+    // the new bottom must be visible before top is read, so a thief and
+    // the owner never both take the last task
+    memory_barrier();
+    top = w->top;
+    if (bottom - top < 0) {
+        w->bottom = bottom + 1;
+        return NULL;
+    }
+    task = a->tasks[bottom & a->mask];
+    if (bottom == top) {
+        if (!atomic_cas(&w->top, top, top + 1))
+            task = NULL;
+        w->bottom = bottom + 1;
+    }
+    return task;
+}
+
+/**
+ * Takes the oldest task of another worker.  Losing the race for it to the
+ * owner or another thief gives NULL, unless wait is set.
+ */
+static A52Task *
+deque_steal_top(A52Worker *w, int wait)
+{
+    A52TaskArray *a;
+    A52Task *task;
+    int top, bottom;
+
+    do {
+        top = w->top;
+        memory_barrier();
+        bottom = w->bottom;
+        if (bottom - top <= 0)
+            return NULL;
+        memory_barrier();
+        a = w->array;
+        task = a->tasks[top & a->mask];
+        if (atomic_cas(&w->top, top, top + 1))
+            return task;
+    } while (wait);
+
+    return NULL;
+}
+
+static void
+inject_push(A52Scheduler *sched, A52Task *task)
+{
+    A52Task *head;
+
+    do {
+        head = sched->inject_stack;
+        task->next = head;
+    } while (!atomic_cas_ptr((void *volatile *)&sched->inject_stack, head, task));
+}
+
+/**
+ * Pops the oldest task of the shared queue.  If another worker is popping,
+ * returns NULL at once, unless wait is set.
+ */
+static A52Task *
+inject_pop(A52Scheduler *sched, int wait)
+{
+    A52Task *task, *head, *list;
+
+    while (sched->inject_list || sched->inject_stack) {
+        if (!atomic_cas(&sched->inject_busy, 0, 1)) {
+            if (!wait)
+                return NULL;
+            cpu_relax();
+            continue;
+        }
+        task = sched->inject_list;
+        if (!task) {
+            // take the whole stack and reverse it into submission order
+            do {
+                head = sched->inject_stack;
+            } while (!atomic_cas_ptr((void *volatile *)&sched->inject_stack, head, NULL));
+            for (list = NULL; head; head = task) {
+                task = head->next;
+                head->next = list;
+                list = head;
+            }
+            task = list;
+        }
+        if (task)
+            sched->inject_list = task->next;
+        memory_barrier();
+        sched->inject_busy = 0;
+        if (task)
+            return task;
+    }
+
+    return NULL;
+}
+
+/**
+ * local deque first, then the shared queue, then steal from the others,
+ * starting at the neighbour.  A worker about to sleep sets wait, so that it
+ * does not miss a task because another thread was taking one at the time.
+ */
+static A52Task *
+find_task(A52Worker *w, int wait)
+{
+    A52Scheduler *sched = w->sched;
+    A52Task *task;
+    int i;
+
+    task = deque_pop_bottom(w);
+    if (!task)
+        task = inject_pop(sched, wait);
+    for (i = 1; !task && i < sched->n_workers; i++)
+        task = deque_steal_top(&sched->workers[(w->worker_num + i) % sched->n_workers], wait);
+
+    return task;
+}
+
+static int
+sched_worker(void *vw)
+{
+    A52Worker *w;
+    A52Scheduler *sched;
+    A52Task *task;
+
+#ifdef MINGW_ALIGN_STACK_HACK
+    asm volatile (
+        "movl %%esp, %%ecx\n"
+        "andl $15, %%ecx\n"
+        "subl %%ecx, %%esp\n"
+        "pushl %%ecx\n"
+        "pushl %%ecx\n"
+        "pushl %%ecx\n"
+        "pushl %%ecx\n"
+        : : : "%esp","%ecx");
+#endif
+
+    w = vw;
+    sched = w->sched;
+    while (1) {
+        int spin;
+
+        task = find_task(w, 0);
+        for (spin = 0; !task && spin < sched->spin_count; spin++) {
+            cpu_relax();
+            task = find_task(w, 0);
+        }
+        if (!task) {
+            // announce that we are about to sleep before the final check,
+            // so a concurrent submit either is seen here or sees us
+            thread_mutex_lock(&sched->mutex);
+            atomic_add(&sched->n_sleeping, 1);
+            while (!(task = find_task(w, 1)) && !sched->shutdown) {
+                ++sched->n_parks;
+                thread_cond_wait(&sched->work_cond, &sched->mutex);
+            }
+            atomic_add(&sched->n_sleeping, -1);
+            thread_mutex_unlock(&sched->mutex);
+            if (!task)
+                break;
+        }
+        task->run(task, w->worker_num);
+    }
+
+#ifdef MINGW_ALIGN_STACK_HACK
+    asm volatile (
+        "popl %%ecx\n"
+        "popl %%ecx\n"
+        "popl %%ecx\n"
+        "popl %%ecx\n"
+        "addl %%ecx, %%esp\n"
+        : : : "%esp", "%ecx");
+#endif
+
+    return 0;
+}
+
+int
+a52_sched_init(A52Scheduler *sched, int n_workers, int spin_count)
+{
+    int i;
+
+    sched->workers = calloc(n_workers, sizeof(A52Worker));
+    if (!sched->workers)
+        return -1;
+    sched->n_workers = n_workers;
+    sched->spin_count = spin_count;
+    sched->inject_stack = NULL;
+    sched->inject_list = NULL;
+    sched->inject_busy = 0;
+    sched->n_sleeping = 0;
+    sched->n_parks = 0;
+    sched->shutdown = 0;
+
+    for (i = 0; i < n_workers; i++) {
+        A52Worker *w = &sched->workers[i];
+        w->sched = sched;
+        w->worker_num = i;
+        w->array = task_array_alloc(A52_DEQUE_INIT_SIZE);
+        if (!w->array) {
+            while (i--)
+                task_array_free(sched->workers[i].array);
+            free(sched->workers);
+            sched->workers = NULL;
+            return -1;
+        }
+    }
+    thread_mutex_init(&sched->mutex);
+    thread_cond_init(&sched->work_cond);
+    for (i = 0; i < n_workers; i++)
+        thread_create(&sched->workers[i].thread, sched_worker, &sched->workers[i]);
+
+    return 0;
+}
+
+void
+a52_sched_close(A52Scheduler *sched)
+{
+    int i;
+
+    if (!sched->workers)
+        return;
+
+    thread_mutex_lock(&sched->mutex);
+    sched->shutdown = 1;
+    thread_cond_broadcast(&sched->work_cond);
+    thread_mutex_unlock(&sched->mutex);
+
+    for (i = 0; i < sched->n_workers; i++)
+        thread_join(sched->workers[i].thread);
+    for (i = 0; i < sched->n_workers; i++)
+        task_array_free(sched->workers[i].array);
+    thread_cond_destroy(&sched->work_cond);
+    thread_mutex_destroy(&sched->mutex);
+
+    free(sched->workers);
+    sched->workers = NULL;
+}
+
+void
+a52_sched_submit(A52Scheduler *sched, A52Task *task, int worker_num)
+{
+    if (worker_num < 0)
+        inject_push(sched, task);
+    else
+        deque_push_bottom(&sched->workers[worker_num], task);
+
+    memory_barrier();
+    if (sched->n_sleeping) {
+        thread_mutex_lock(&sched->mutex);
+        thread_cond_signal(&sched->work_cond);
+        thread_mutex_unlock(&sched->mutex);
+    }
+}
+
+void
+a52_waiter_init(A52Waiter *waiter)
+{
+    waiter->n_waiting = 0;
+    thread_mutex_init(&waiter->mutex);
+    thread_cond_init(&waiter->cond);
+}
+
+void
+a52_waiter_close(A52Waiter *waiter)
+{
+    thread_cond_destroy(&waiter->cond);
+    thread_mutex_destroy(&waiter->mutex);
+}
+
+void
+a52_sched_signal(A52Waiter *waiter, volatile int *flag, int value)
+{
+    memory_barrier();
+    *flag = value;
+    memory_barrier();
+    if (waiter->n_waiting) {
+        thread_mutex_lock(&waiter->mutex);
+        thread_cond_broadcast(&waiter->cond);
+        thread_mutex_unlock(&waiter->mutex);
+    }
+}
+
+void
+a52_sched_wait(A52Scheduler *sched, A52Waiter *waiter, volatile int *flag)
+{
+    int spin;
+
+    for (spin = 0; !*flag && spin < sched->spin_count; spin++)
+        cpu_relax();
+    if (!*flag) {
+        thread_mutex_lock(&waiter->mutex);
+        atomic_add(&waiter->n_waiting, 1);
+        while (!*flag)
+            thread_cond_wait(&waiter->cond, &waiter->mutex);
+        atomic_add(&waiter->n_waiting, -1);
+        thread_mutex_unlock(&waiter->mutex);
+    }
+    memory_barrier();
+}
+
+#endif /* NO_THREADS */
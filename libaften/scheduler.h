@@ -0,0 +1,205 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * Work-stealing task scheduler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file scheduler.h
+ * Work-stealing task scheduler
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "common.h"
+#include "threading.h"
+
+#ifndef NO_THREADS
+
+struct A52Task;
+
+typedef void (*A52TaskFunc)(struct A52Task *task, int worker_num);
+
+/**
+ * Unit of work.  Tasks are embedded in the structure they operate on, so
+ * queueing never allocates.  A task may be queued only once at a time.
+ */
+typedef struct A52Task {
+    A52TaskFunc run;
+    void *arg;
+    struct A52Task *next;
+} A52Task;
+
+/**
+ * Storage of a worker deque.  When it is full, the owner moves the tasks to
+ * one twice as large.  Thieves may still read the old one, so it is only
+ * freed when the scheduler is closed.
+ */
+typedef struct A52TaskArray {
+    struct A52TaskArray *retired;
+    int mask;
+    A52Task *volatile *tasks;
+} A52TaskArray;
+
+/**
+ * Per-worker lock-free double-ended queue (Chase-Lev).  The owning worker
+ * pushes and pops at the bottom (newest task first), idle workers steal
+ * from the top (oldest task).  Only a pop of the last task and the steals
+ * race for the top, which is settled with a compare-and-swap.
+ */
+typedef struct A52Worker {
+    struct A52Scheduler *sched;
+    THREAD thread;
+    int worker_num;
+    A52TaskArray *volatile array;
+    volatile int top;
+    volatile int bottom;
+} A52Worker;
+
+/**
+ * Idle workers and waiting callers poll for spin_count rounds before they
+ * park on a condition variable.  Parked threads are only woken up when
+ * somebody is known to be parked, so the common case stays free of
+ * system calls.
+ *
+ * Tasks submitted from outside the pool go through a shared FIFO queue.
+ * Workers look there before stealing, so when several encoders share one
+ * scheduler, their frames are started in the order they came in.
+ * Submitters push onto a lock-free stack.  The worker which holds
+ * inject_busy takes the whole stack at once and hands the tasks out in
+ * the order they were pushed; the others go on to steal meanwhile.
+ */
+typedef struct A52Scheduler {
+    A52Worker *workers;
+    int n_workers;
+    int spin_count;
+    A52Task *volatile inject_stack;
+    A52Task *volatile inject_list;
+    volatile int inject_busy;
+    volatile int n_sleeping;
+    volatile int n_parks;
+    volatile int shutdown;
+    MUTEX mutex;
+    COND work_cond;
+} A52Scheduler;
+
+/**
+ * Lets threads outside the pool wait for results.  Every encoding context
+ * has its own, so a finished frame only wakes up the thread which waits
+ * for it, even when many contexts share one scheduler.
+ */
+typedef struct A52Waiter {
+    volatile int n_waiting;
+    MUTEX mutex;
+    COND cond;
+} A52Waiter;
+
+/**
+ * at least the frames in flight, which lookahead adds to (checked in
+ * a52enc.h), and a power of 2
+ */
+#define A52_RING_SIZE 128
+
+#if A52_RING_SIZE & (A52_RING_SIZE - 1)
+#error "A52_RING_SIZE must be a power of 2"
+#endif
+
+/**
+ * Lock-free single-producer/single-consumer ring buffer.
+ * Holds up to A52_RING_SIZE pointers.
+ */
+typedef struct A52Ring {
+    void *items[A52_RING_SIZE];
+    volatile int head;  // only written by the consumer
+    volatile int tail;  // only written by the producer
+} A52Ring;
+
+static inline int
+a52_ring_push(A52Ring *ring, void *item)
+{
+    int tail = ring->tail;
+
+    if (tail - ring->head == A52_RING_SIZE)
+        return -1;
+    ring->items[tail & (A52_RING_SIZE-1)] = item;
+    memory_barrier();
+    ring->tail = tail + 1;
+
+    return 0;
+}
+
+static inline void *
+a52_ring_pop(A52Ring *ring)
+{
+    int head = ring->head;
+    void *item;
+
+    if (head == ring->tail)
+        return NULL;
+    memory_barrier();
+    item = ring->items[head & (A52_RING_SIZE-1)];
+    memory_barrier();
+    ring->head = head + 1;
+
+    return item;
+}
+
+static inline int
+a52_ring_empty(A52Ring *ring)
+{
+    return ring->head == ring->tail;
+}
+
+/**
+ * Starts n_workers worker threads, which poll spin_count times before they
+ * go to sleep.
+ * Returns 0 on success, -1 on error.
+ */
+extern int a52_sched_init(A52Scheduler *sched, int n_workers, int spin_count);
+
+/**
+ * Finishes all queued tasks and joins the worker threads.
+ */
+extern void a52_sched_close(A52Scheduler *sched);
+
+/**
+ * Queues a task.  When called from inside a task, pass the worker_num the
+ * task was given, so the new task lands on the local deque.  Callers outside
+ * the pool pass -1 and the task is appended to the shared queue.
+ */
+extern void a52_sched_submit(A52Scheduler *sched, A52Task *task, int worker_num);
+
+extern void a52_waiter_init(A52Waiter *waiter);
+
+extern void a52_waiter_close(A52Waiter *waiter);
+
+/**
+ * Stores value in *flag and wakes up anyone blocked on it in a52_sched_wait.
+ */
+extern void a52_sched_signal(A52Waiter *waiter, volatile int *flag, int value);
+
+/**
+ * Blocks until *flag is non-zero, polling spin_count times before sleeping.
+ */
+extern void a52_sched_wait(A52Scheduler *sched, A52Waiter *waiter,
+                           volatile int *flag);
+
+#endif /* NO_THREADS */
+
+#endif /* SCHEDULER_H */
@@ -36,41 +36,20 @@ typedef pthread_t       THREAD;
 typedef pthread_mutex_t MUTEX;
 typedef pthread_cond_t  COND;
 
-typedef struct A52GlobalThreadSync
-{
-    int current_thread_num;
-    int threads_to_abort;
-    int threads_running;
-    volatile int samples_thread_num;
-    MUTEX samples_mutex;
-} A52GlobalThreadSync;
-
-typedef struct A52ThreadSync
-{
-    THREAD thread;
-    MUTEX enter_mutex;
-    MUTEX confirm_mutex;
-    COND  enter_cond;
-    COND  confirm_cond;
-
-    COND samples_cond;
-    COND* next_samples_cond;
-} A52ThreadSync;
-
 #define thread_create(threadid, threadfunc, threadparam) \
     pthread_create(threadid, NULL, (void *(*) (void *))threadfunc, threadparam)
-#define thread_join(x)         pthread_join(x, NULL)
+#define thread_join(x)               pthread_join(x, NULL)
 
-#define posix_mutex_init(x)          pthread_mutex_init(x, NULL)
-#define posix_mutex_destroy(x)       pthread_mutex_destroy(x)
-#define posix_mutex_lock(x)          pthread_mutex_lock(x)
-#define posix_mutex_unlock(x)        pthread_mutex_unlock(x)
+#define thread_mutex_init(x)         pthread_mutex_init(x, NULL)
+#define thread_mutex_destroy(x)      pthread_mutex_destroy(x)
+#define thread_mutex_lock(x)         pthread_mutex_lock(x)
+#define thread_mutex_unlock(x)       pthread_mutex_unlock(x)
 
-#define posix_cond_init(x)           pthread_cond_init(x, NULL)
-#define posix_cond_destroy(x)        pthread_cond_destroy(x)
-#define posix_cond_wait(cond, mutex) pthread_cond_wait(cond, mutex)
-#define posix_cond_signal(x)         pthread_cond_signal(x)
-#define posix_cond_broadcast(x)      pthread_cond_broadcast(x)
+#define thread_cond_init(x)          pthread_cond_init(x, NULL)
+#define thread_cond_destroy(x)       pthread_cond_destroy(x)
+#define thread_cond_wait(cond, mutex) pthread_cond_wait(cond, mutex)
+#define thread_cond_signal(x)        pthread_cond_signal(x)
+#define thread_cond_broadcast(x)     pthread_cond_broadcast(x)
 
 
 #ifdef HAVE_GET_NPROCS
@@ -105,29 +84,16 @@ get_ncpus()
 
 #else /* HAVE_POSIX_THREADS */
 #ifdef HAVE_WINDOWS_THREADS
+/* condition variables need Vista or later */
+#if !defined(_WIN32_WINNT) || _WIN32_WINNT < 0x0600
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
 #include <windows.h>
 
 typedef HANDLE THREAD;
-typedef HANDLE EVENT;
-typedef CRITICAL_SECTION CS;
-
-typedef struct A52GlobalThreadSync
-{
-    int current_thread_num;
-    int threads_to_abort;
-    int threads_running;
-    volatile int samples_thread_num;
-    CS samples_cs;
-} A52GlobalThreadSync;
-
-typedef struct A52ThreadSync
-{
-    THREAD thread;
-    EVENT ready_event;
-    EVENT enter_event;
-    EVENT samples_event;
-    EVENT* next_samples_event;
-} A52ThreadSync;
+typedef CRITICAL_SECTION MUTEX;
+typedef CONDITION_VARIABLE COND;
 
 static inline void
 thread_create(HANDLE *thread, int (*threadfunc)(void*), LPVOID threadparam)
@@ -145,60 +111,58 @@ thread_join(HANDLE thread)
 }
 
 static inline void
-windows_event_init(EVENT *event)
+thread_mutex_init(MUTEX *mutex)
 {
-    *event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    InitializeCriticalSection(mutex);
 }
 
 static inline void
-windows_event_destroy(EVENT *event)
+thread_mutex_destroy(MUTEX *mutex)
 {
-    CloseHandle(*event);
+    DeleteCriticalSection(mutex);
 }
 
 static inline void
-windows_event_set(EVENT *event)
+thread_mutex_lock(MUTEX *mutex)
 {
-    SetEvent(*event);
+    EnterCriticalSection(mutex);
 }
 
 static inline void
-windows_event_reset(EVENT *event)
+thread_mutex_unlock(MUTEX *mutex)
 {
-    ResetEvent(*event);
+    LeaveCriticalSection(mutex);
 }
 
 static inline void
-windows_event_wait(EVENT *event)
+thread_cond_init(COND *cond)
 {
-    WaitForSingleObject(*event, INFINITE);
+    InitializeConditionVariable(cond);
 }
 
 static inline void
-windows_cs_init(CS *cs)
+thread_cond_destroy(UNUSED(COND *cond))
 {
-    InitializeCriticalSection(cs);
 }
 
 static inline void
-windows_cs_destroy(CS *cs)
+thread_cond_wait(COND *cond, MUTEX *mutex)
 {
-    DeleteCriticalSection(cs);
+    SleepConditionVariableCS(cond, mutex, INFINITE);
 }
 
 static inline void
-windows_cs_enter(CS *cs)
+thread_cond_signal(COND *cond)
 {
-    EnterCriticalSection(cs);
+    WakeConditionVariable(cond);
 }
 
 static inline void
-windows_cs_leave(CS *cs)
+thread_cond_broadcast(COND *cond)
 {
-    LeaveCriticalSection(cs);
+    WakeAllConditionVariable(cond);
 }
 
-
 static inline int
 get_ncpus()
 {
@@ -220,33 +184,60 @@ get_ncpus()
 #define thread_create(X, Y, Z)
 #define thread_join(X)
 
+#define thread_mutex_init(x)
+#define thread_mutex_destroy(x)
+#define thread_mutex_lock(x)
+#define thread_mutex_unlock(x)
+
+#define thread_cond_init(x)
+#define thread_cond_destroy(x)
+#define thread_cond_wait(cond, mutex)
+#define thread_cond_signal(x)
+#define thread_cond_broadcast(x)
+
 #endif /* HAVE_WINDOWS_THREADS */
 #endif /* HAVE_POSIX_THREADS */
 
-#ifndef HAVE_POSIX_THREADS
-#define posix_mutex_init(x)
-#define posix_mutex_destroy(x)
-#define posix_mutex_lock(x)
-#define posix_mutex_unlock(x)
-
-#define posix_cond_init(x)
-#define posix_cond_destroy(x)
-#define posix_cond_wait(cond, mutex)
-#define posix_cond_signal(x)
-#define posix_cond_broadcast(x)
-#endif /* HAVE_POSIX_THREADS */
+#ifndef NO_THREADS
+/* atomic operations, all of them imply a full memory barrier */
+#ifdef _MSC_VER
+#include <intrin.h>
 
-#ifndef HAVE_WINDOWS_THREADS
-#define windows_event_init(x)
-#define windows_event_destroy(x)
-#define windows_event_set(x)
-#define windows_event_reset(x)
-#define windows_event_wait(x)
-
-#define windows_cs_init(x)
-#define windows_cs_destroy(x)
-#define windows_cs_enter(x)
-#define windows_cs_leave(x)
-#endif /* HAVE_WINDOWS_THREADS */
+static inline int
+atomic_add(volatile int *ptr, int value)
+{
+    return _InterlockedExchangeAdd((volatile long *)ptr, value) + value;
+}
+
+static inline int
+atomic_cas(volatile int *ptr, int old_value, int new_value)
+{
+    return _InterlockedCompareExchange((volatile long *)ptr, new_value,
+                                       old_value) == old_value;
+}
+
+static inline int
+atomic_cas_ptr(void *volatile *ptr, void *old_value, void *new_value)
+{
+    return _InterlockedCompareExchangePointer(ptr, new_value,
+                                              old_value) == old_value;
+}
+
+#define memory_barrier()        MemoryBarrier()
+#define cpu_relax()             YieldProcessor()
+#else
+#define atomic_add(ptr, value)  __sync_add_and_fetch(ptr, value)
+#define atomic_cas(ptr, old_value, new_value) \
+    __sync_bool_compare_and_swap(ptr, old_value, new_value)
+#define atomic_cas_ptr(ptr, old_value, new_value) \
+    __sync_bool_compare_and_swap(ptr, old_value, new_value)
+#define memory_barrier()        __sync_synchronize()
+#if defined(__i386__) || defined(__x86_64__)
+#define cpu_relax()             __asm__ __volatile__("pause" ::: "memory")
+#else
+#define cpu_relax()             __asm__ __volatile__("" ::: "memory")
+#endif
+#endif /* _MSC_VER */
+#endif /* NO_THREADS */
 
 #endif /* THREADING_H */
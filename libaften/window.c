@@ -27,16 +27,6 @@
 
 ALIGN16(FLOAT) a52_window[512] = {0};
 
-static void
-apply_a52_window(FLOAT *samples)
-{
-    int i;
-    for (i = 0; i < 512; i += 2) {
-        samples[i  ] *= a52_window[i  ];
-        samples[i+1] *= a52_window[i+1];
-    }
-}
-
 /**
  * Generate a Kaiser-Bessel Derived Window.
  * @param alpha         Determines window shape
@@ -70,16 +60,7 @@ kbd_window_init(FLOAT alpha, FLOAT *window, int n, int iter)
 }
 
 void
-a52_window_init(A52WindowFunctions *winf)
+a52_window_init(void)
 {
     kbd_window_init(5.0, a52_window, 512, 50);
-
-    winf->apply_a52_window = apply_a52_window;
-#ifndef CONFIG_DOUBLE
-#ifdef HAVE_SSE
-    if (cpu_caps_have_sse()) {
-        winf->apply_a52_window = apply_a52_window_sse;
-    }
-#endif
-#endif
 }
@@ -26,21 +26,13 @@
 #define WINDOW_H
 
 #include "common.h"
-#include "cpu_caps.h"
-
-#if defined(HAVE_MMX) || defined(HAVE_SSE)
-#include "x86/window.h"
-#endif
 
+/**
+ * The A/52 window.  It is not applied to the input separately; the MDCT
+ * multiplies it in while reading the samples.
+ */
 extern FLOAT a52_window[512];
 
-typedef struct A52WindowFunctions {
-    /**
-     * Apply the A/52 window function to 512 input samples.
-     */
-    void (*apply_a52_window)(FLOAT *samples);
-} A52WindowFunctions;
-
-extern void a52_window_init(A52WindowFunctions *winf);
+extern void a52_window_init(void);
 
 #endif /* WINDOW_H */
@@ -0,0 +1,125 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * AVX2 bit allocation functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file x86/bitalloc_avx2.c
+ * A/52 avx2 optimized bit allocation functions
+ */
+
+#include "a52enc.h"
+#include "x86/simd_support.h"
+
+#define V               __m256i
+#define N               16
+#define V_LOAD(p)       _mm256_loadu_si256((const __m256i *)(p))
+#define V_STORE(p, v)   _mm256_storeu_si256((__m256i *)(p), v)
+#define V_LOAD_EXP(p)   _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define V_SET1_8(x)     _mm256_set1_epi8((char)(x))
+#define V_SET1_16       _mm256_set1_epi16
+#define V_ADD16         _mm256_add_epi16
+#define V_SUB16         _mm256_sub_epi16
+#define V_SLLI16        _mm256_slli_epi16
+#define V_SRAI16        _mm256_srai_epi16
+#define V_MAX16         _mm256_max_epi16
+#define V_MIN16         _mm256_min_epi16
+#define V_AND           _mm256_and_si256
+#define V_CMPEQ8        _mm256_cmpeq_epi8
+#define V_UNPACKLO8     _mm256_unpacklo_epi8
+#define V_UNPACKHI8     _mm256_unpackhi_epi8
+#define V_MADD16        _mm256_madd_epi16
+#define V_ADD32         _mm256_add_epi32
+#define V_SAD8          _mm256_sad_epu8
+#define V_ADD64         _mm256_add_epi64
+#define V_ZERO          _mm256_setzero_si256()
+
+/** one 16 entry quarter of a52_bap_tab in both 128-bit lanes */
+static inline __m256i
+bap_tab_part(int i)
+{
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)&a52_bap_tab[i*16]));
+}
+
+/**
+ * The byte shuffle looks up the low 4 bits of the address in each quarter
+ * of the table, and the high 2 bits pick the quarter.
+ */
+static inline __m256i
+bap_lookup(__m256i a, __m256i b)
+{
+    // packing works within the 128-bit lanes, so the middle quarters swap
+    __m256i addr = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+    __m256i v = _mm256_shuffle_epi8(bap_tab_part(0), addr);
+    int i;
+
+    for (i = 1; i < 4; i++) {
+        __m256i sel = _mm256_cmpgt_epi8(addr, _mm256_set1_epi8((char)(i*16-1)));
+        v = _mm256_blendv_epi8(v, _mm256_shuffle_epi8(bap_tab_part(i), addr), sel);
+    }
+    return v;
+}
+
+/** bap-1 bits, except 14 for bap=14 and 16 for bap=15 */
+static inline __m256i
+mant_bits_lookup(__m256i bap)
+{
+    const __m256i bits = _mm256_setr_epi8(0, 0, 0, 0, 0, 4, 5, 6, 7, 8, 9, 10, 11, 12, 14, 16,
+                                          0, 0, 0, 0, 0, 4, 5, 6, 7, 8, 9, 10, 11, 12, 14, 16);
+    return _mm256_shuffle_epi8(bits, bap);
+}
+
+static inline int
+v_hsum32(__m256i v)
+{
+    __m128i x = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    x = _mm_add_epi32(x, _mm_srli_si128(x, 8));
+    x = _mm_add_epi32(x, _mm_srli_si128(x, 4));
+    return _mm_cvtsi128_si32(x);
+}
+
+static inline int
+v_hsum64(__m256i v)
+{
+    __m128i x = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return _mm_cvtsi128_si32(_mm_add_epi64(x, _mm_srli_si128(x, 8)));
+}
+
+#include "x86/bitalloc_common.h"
+
+void
+bit_alloc_calc_psd_avx2(uint8_t *exp, int start, int end, int16_t *psd,
+                        int16_t *band_psd)
+{
+    calc_psd(exp, start, end, psd, band_psd);
+}
+
+void
+bit_alloc_calc_bap_avx2(int16_t *mask, int16_t *psd, int start, int end,
+                        int snr_offset, int floor, uint8_t *bap)
+{
+    calc_bap(mask, psd, start, end, snr_offset, floor, bap);
+}
+
+int
+bit_alloc_count_mant_avx2(int16_t *mask, A52ExpHist *hist, int start, int end,
+                          int snr_offset, int floor, int mant_cnt[5])
+{
+    return count_mant(mask, hist, start, end, snr_offset, floor, mant_cnt);
+}
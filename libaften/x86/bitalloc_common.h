@@ -0,0 +1,221 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * Bit allocation functions shared by the SSE2 and AVX2 versions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file x86/bitalloc_common.h
+ * Bin psd and bit allocation pointers, written once for all vector widths
+ *
+ * The including file defines the vector type V of N 16-bit lanes and the
+ * operations V_LOAD, V_STORE (both unaligned), V_LOAD_EXP (N exponent
+ * bytes widened to 16 bits), V_SET1_8, V_SET1_16, V_ADD16, V_SUB16,
+ * V_SLLI16, V_SRAI16, V_MAX16, V_MIN16, V_AND, V_CMPEQ8, V_UNPACKLO8,
+ * V_UNPACKHI8, V_MADD16, V_ADD32, V_SAD8 (sums of 8 unsigned bytes into
+ * 64-bit lanes), V_ADD64 and V_ZERO.  bap_lookup() returns the bytes of
+ * a52_bap_tab for the 2*N addresses in two vectors, mant_bits_lookup() the
+ * bits of each bap above 4 and 0 for the others, and v_hsum32() and
+ * v_hsum64() the sums of the 32-bit and 64-bit lanes.
+ *
+ * A vector which would run past the end is moved back to end there, so it
+ * redoes some bins with the same result instead of leaving a scalar tail.
+ */
+
+#ifndef X86_BITALLOC_COMMON_H
+#define X86_BITALLOC_COMMON_H
+
+/**
+ * Same as a52_bit_alloc_calc_psd.  The log-add of the wider bands is a
+ * serial chain, so only the first bands, which are one bin wide, are
+ * copied here and the rest is left to a52_bit_alloc_calc_band_psd.
+ */
+static inline void
+calc_psd(uint8_t *exp, int start, int end, int16_t *psd, int16_t *band_psd)
+{
+    V v3072 = V_SET1_16(3072);
+    int bin;
+
+    if (end - start >= N) {
+        for (bin = start; bin < end; bin += N) {
+            bin = MIN(bin, end - N);
+            V_STORE(&psd[bin], V_SUB16(v3072, V_SLLI16(V_LOAD_EXP(&exp[bin]), 7)));
+        }
+    } else {
+        for (bin = start; bin < end; bin++)
+            psd[bin] = 3072 - (exp[bin] << 7);
+    }
+
+    bin = MIN(end, 28);
+    if (bin > start)
+        memcpy(&band_psd[start], &psd[start], (bin - start) * sizeof(int16_t));
+    if (end > bin)
+        a52_bit_alloc_calc_band_psd(psd, MAX(start, bin), end, band_psd);
+}
+
+/** address into a52_bap_tab of each bin, (psd - m) >> 5 clipped to 0..63 */
+static inline V
+bap_address(const int16_t *psd, const int16_t *m)
+{
+    V v = V_SRAI16(V_SUB16(V_LOAD(psd), V_LOAD(m)), 5);
+    return V_MIN16(V_MAX16(v, V_ZERO), V_SET1_16(63));
+}
+
+/** masking value of the bands from band0 to band1, N bands at a time */
+static inline void
+band_masks(int16_t *mask, int band0, int band1, int snr_offset, int floor,
+           int16_t *m)
+{
+    int band;
+
+    if (band1 - band0 >= N) {
+        V vsf = V_SET1_16(snr_offset + floor);
+        V vfloor = V_SET1_16(floor);
+        V vmask = V_SET1_16(0x1FE0);
+        for (band = band0; band < band1; band += N) {
+            V v;
+            band = MIN(band, band1 - N);
+            v = V_MAX16(V_SUB16(V_LOAD(&mask[band]), vsf), V_ZERO);
+            V_STORE(&m[band], V_ADD16(V_AND(v, vmask), vfloor));
+        }
+    } else {
+        for (band = band0; band < band1; band++)
+            m[band] = (MAX(mask[band] - snr_offset - floor, 0) & 0x1FE0) + floor;
+    }
+}
+
+/**
+ * Same as a52_bit_alloc_calc_bap.  The masking value of each band is
+ * broadcast over the bins of the band, so the bins are done 2*N at a time
+ * whatever the band sizes.
+ */
+static inline void
+calc_bap(int16_t *mask, int16_t *psd, int start, int end, int snr_offset,
+         int floor, uint8_t *bap)
+{
+    // the broadcast of the last band may write up to N-1 bins past 253
+    int16_t mbin[256+N];
+    int16_t m[50];
+    int bin, band, band0, band1;
+
+    // special case, if snr offset is -960, set all bap's to zero
+    if (snr_offset == -960) {
+        memset(bap, 0, 256);
+        return;
+    }
+
+    band0 = a52_bin_to_band_tab[start];
+    band1 = a52_bin_to_band_tab[end-1] + 1;
+    band_masks(mask, band0, band1, snr_offset, floor, m);
+
+    for (band = band0; band < band1; band++) {
+        V vm = V_SET1_16(m[band]);
+        for (bin = a52_band_start_tab[band]; bin < a52_band_start_tab[band+1]; bin += N)
+            V_STORE(&mbin[bin], vm);
+    }
+
+    if (end - start >= 2*N) {
+        for (bin = start; bin < end; bin += 2*N) {
+            bin = MIN(bin, end - 2*N);
+            V_STORE(&bap[bin], bap_lookup(bap_address(&psd[bin], &mbin[bin]),
+                                          bap_address(&psd[bin+N], &mbin[bin+N])));
+        }
+    } else {
+        for (bin = start; bin < end; bin++)
+            bap[bin] = a52_bap_tab[CLIP((psd[bin] - mbin[bin]) >> 5, 0, 63)];
+    }
+}
+
+/**
+ * Same as count_mant in bitalloc.c.  The psd of an exponent is
+ * 3072 - (exp << 7), so the address of a histogram entry is the address
+ * of exponent 0 in its band, minus exp * 4.  That is broadcast over the
+ * entries of each wider band like the masking value in calc_bap, then the bits
+ * and the count of each grouped bap are summed 2*N entries at a time, each
+ * weighted by the number of bins of the entry.  The histogram is padded
+ * with entries of no bins, so the last vector needs no special case.
+ */
+static inline int
+count_mant(int16_t *mask, A52ExpHist *hist, int start, int end,
+           int snr_offset, int floor, int mant_cnt[5])
+{
+    // the broadcast may write N-1 entries past the last one, and the last
+    // vector reads up to 2*N-1 past it, which have no bins
+    int16_t addr0[256+2*N];
+    int16_t m[50];
+    V vbits = V_ZERO;
+    V vcnt[4] = { V_ZERO, V_ZERO, V_ZERO, V_ZERO };
+    int i, k, n, b, band, band0, band1;
+
+    if (snr_offset == -960) {
+        for (b = 1; b <= 4; b++)
+            mant_cnt[b] = 0;
+        return 0;
+    }
+
+    band0 = a52_bin_to_band_tab[start];
+    band1 = a52_bin_to_band_tab[end-1] + 1;
+    band_masks(mask, band0, band1, snr_offset, floor, m);
+
+    // the bands below 28 are one bin wide, so they have one entry each
+    band = MIN(MAX(band0, 28), band1);
+    i = band - band0;
+    if (i >= N) {
+        for (k = 0; k < i; k += N) {
+            k = MIN(k, i - N);
+            V_STORE(&addr0[k], V_SRAI16(V_SUB16(V_SET1_16(3072), V_LOAD(&m[band0+k])), 5));
+        }
+    } else {
+        for (k = 0; k < i; k++)
+            addr0[k] = (3072 - m[band0+k]) >> 5;
+    }
+    for (; band < band1; band++) {
+        V va = V_SET1_16((3072 - m[band]) >> 5);
+        for (k = i; k < hist->band_end[band]; k += N)
+            V_STORE(&addr0[k], va);
+        i = hist->band_end[band];
+    }
+    n = i;
+
+    for (k = 0; k < n; k += 2*N) {
+        V lo = V_SUB16(V_LOAD(&addr0[k]), V_SLLI16(V_LOAD_EXP(&hist->exp[k]), 2));
+        V hi = V_SUB16(V_LOAD(&addr0[k+N]), V_SLLI16(V_LOAD_EXP(&hist->exp[k+N]), 2));
+        V vcount = V_LOAD(&hist->count[k]);
+        V vbap, v;
+
+        lo = V_MIN16(V_MAX16(lo, V_ZERO), V_SET1_16(63));
+        hi = V_MIN16(V_MAX16(hi, V_ZERO), V_SET1_16(63));
+        vbap = bap_lookup(lo, hi);
+
+        // at most 16 bits times 24 bins, summed in 32 bits
+        v = mant_bits_lookup(vbap);
+        vbits = V_ADD32(vbits, V_MADD16(V_UNPACKLO8(v, V_ZERO), V_UNPACKLO8(vcount, V_ZERO)));
+        vbits = V_ADD32(vbits, V_MADD16(V_UNPACKHI8(v, V_ZERO), V_UNPACKHI8(vcount, V_ZERO)));
+
+        for (b = 1; b <= 4; b++) {
+            v = V_AND(V_CMPEQ8(vbap, V_SET1_8(b)), vcount);
+            vcnt[b-1] = V_ADD64(vcnt[b-1], V_SAD8(v, V_ZERO));
+        }
+    }
+
+    for (b = 1; b <= 4; b++)
+        mant_cnt[b] = v_hsum64(vcnt[b-1]);
+    return v_hsum32(vbits);
+}
+
+#endif /* X86_BITALLOC_COMMON_H */
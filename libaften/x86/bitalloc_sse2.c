@@ -0,0 +1,121 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * SSE2 bit allocation functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file x86/bitalloc_sse2.c
+ * A/52 sse2 optimized bit allocation functions
+ */
+
+#include "a52enc.h"
+#include "x86/simd_support.h"
+
+#define V               __m128i
+#define N               8
+#define V_LOAD(p)       _mm_loadu_si128((const __m128i *)(p))
+#define V_STORE(p, v)   _mm_storeu_si128((__m128i *)(p), v)
+#define V_LOAD_EXP(p)   _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p)), V_ZERO)
+#define V_SET1_8(x)     _mm_set1_epi8((char)(x))
+#define V_SET1_16       _mm_set1_epi16
+#define V_ADD16         _mm_add_epi16
+#define V_SUB16         _mm_sub_epi16
+#define V_SLLI16        _mm_slli_epi16
+#define V_SRAI16        _mm_srai_epi16
+#define V_MAX16         _mm_max_epi16
+#define V_MIN16         _mm_min_epi16
+#define V_AND           _mm_and_si128
+#define V_CMPEQ8        _mm_cmpeq_epi8
+#define V_UNPACKLO8     _mm_unpacklo_epi8
+#define V_UNPACKHI8     _mm_unpackhi_epi8
+#define V_MADD16        _mm_madd_epi16
+#define V_ADD32         _mm_add_epi32
+#define V_SAD8          _mm_sad_epu8
+#define V_ADD64         _mm_add_epi64
+#define V_ZERO          _mm_setzero_si128()
+
+/**
+ * Without a byte shuffle, a52_bap_tab is worked out from its steps.  From
+ * address 15 on it steps up every 4 addresses up to 14, which is a shift,
+ * and the other steps are counted with compares.  These are the addresses
+ * just before each of them.
+ */
+static const uint8_t bap_steps[7] = { 0, 5, 7, 10, 12, 14, 54 };
+
+static inline __m128i
+bap_lookup(__m128i a, __m128i b)
+{
+    __m128i addr = _mm_packus_epi16(a, b);
+    __m128i v = _mm_subs_epu8(addr, _mm_set1_epi8(15));
+    int i;
+
+    v = _mm_and_si128(_mm_srli_epi16(v, 2), _mm_set1_epi8(0x3F));
+    v = _mm_min_epu8(v, _mm_set1_epi8(8));
+    for (i = 0; i < 7; i++)
+        v = _mm_sub_epi8(v, _mm_cmpgt_epi8(addr, _mm_set1_epi8((char)bap_steps[i])));
+    return v;
+}
+
+/** bap-1 bits, except 14 for bap=14 and 16 for bap=15 */
+static inline __m128i
+mant_bits_lookup(__m128i bap)
+{
+    __m128i v = _mm_sub_epi8(bap, _mm_set1_epi8(1));
+
+    v = _mm_sub_epi8(v, _mm_cmpgt_epi8(bap, _mm_set1_epi8(13)));
+    v = _mm_sub_epi8(v, _mm_cmpgt_epi8(bap, _mm_set1_epi8(14)));
+    return _mm_and_si128(v, _mm_cmpgt_epi8(bap, _mm_set1_epi8(4)));
+}
+
+static inline int
+v_hsum32(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_srli_si128(v, 8));
+    v = _mm_add_epi32(v, _mm_srli_si128(v, 4));
+    return _mm_cvtsi128_si32(v);
+}
+
+static inline int
+v_hsum64(__m128i v)
+{
+    return _mm_cvtsi128_si32(_mm_add_epi64(v, _mm_srli_si128(v, 8)));
+}
+
+#include "x86/bitalloc_common.h"
+
+void
+bit_alloc_calc_psd_sse2(uint8_t *exp, int start, int end, int16_t *psd,
+                        int16_t *band_psd)
+{
+    calc_psd(exp, start, end, psd, band_psd);
+}
+
+void
+bit_alloc_calc_bap_sse2(int16_t *mask, int16_t *psd, int start, int end,
+                        int snr_offset, int floor, uint8_t *bap)
+{
+    calc_bap(mask, psd, start, end, snr_offset, floor, bap);
+}
+
+int
+bit_alloc_count_mant_sse2(int16_t *mask, A52ExpHist *hist, int start, int end,
+                          int snr_offset, int floor, int mant_cnt[5])
+{
+    return count_mant(mask, hist, start, end, snr_offset, floor, mant_cnt);
+}
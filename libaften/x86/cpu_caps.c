@@ -31,6 +31,19 @@
 /* caps2 */
 #define SSE3_BIT             0
 #define SSSE3_BIT            9
+#define FMA_BIT             12
+#define OSXSAVE_BIT         27
+#define AVX_BIT             28
+
+/* caps4 (structured extended features) */
+#define AVX2_BIT             5
+#define AVX512F_BIT         16
+#define AVX512BW_BIT        30
+
+/* XCR0: the OS saves the SSE and AVX register state */
+#define XCR0_SSE_AVX      0x06
+/* XCR0: the OS also saves the opmask and zmm register state */
+#define XCR0_AVX512       0xE0
 
 /* caps3 */
 #define AMD_3DNOW_BIT       31
@@ -52,6 +65,20 @@ static void cpu_caps_detect_x86(uint32_t *caps1, uint32_t *caps2, uint32_t *caps
 	__cpuid(registers, 0x80000001);
 	*caps3 = registers[3];
 }
+
+static void cpu_caps_detect_x86_ext(uint32_t *max_leaf, uint32_t *caps4)
+{
+	int registers[4];
+	__cpuid(registers, 0);
+	*max_leaf = registers[0];
+	__cpuidex(registers, 7, 0);
+	*caps4 = registers[1];
+}
+
+static uint32_t cpu_caps_detect_xcr0(void)
+{
+	return (uint32_t)_xgetbv(0);
+}
 #else
 #include "asm_support.h"
 
@@ -101,12 +128,74 @@ static void cpu_caps_detect_x86(uint32_t *caps1, uint32_t *caps2, uint32_t *caps
     *caps2 = c2;
     *caps3 = c3;
 }
+
+// leaf 7 is only valid if max_leaf says so
+static void cpu_caps_detect_x86_ext(uint32_t *max_leaf, uint32_t *caps4)
+{
+    uint32_t c1, c2;
+
+#if __GNUC__
+    asm volatile (
+#else
+  __asm {
+#endif
+        _mov(_b, _s)
+
+        // highest standard CPUID leaf
+        _mov(_(0x0), _eax)
+        _cpuid
+        _mov(_eax, param1)
+
+        // structured extended features - AVX2
+        _mov(_(0x7), _eax)
+        _xor(_ecx, _ecx)
+        _cpuid
+        _mov(_ebx, param2)
+
+        _mov(_s, _b)
+#if __GNUC__
+        :"=m"(c1), "=m"(c2)             /* output */
+        :                               /* input */
+        :"%eax", "%ecx", "%edx", "%esi" /* clobbered registers */
+    );
+#else
+ }
+#endif
+
+    *max_leaf = c1;
+    *caps4 = c2;
+}
+
+// must only be called if the OSXSAVE bit is set
+static uint32_t cpu_caps_detect_xcr0(void)
+{
+    uint32_t c1;
+
+#if __GNUC__
+    asm volatile (
+#else
+  __asm {
+#endif
+        _xor(_ecx, _ecx)
+        _xgetbv
+        _mov(_eax, param1)
+#if __GNUC__
+        :"=m"(c1)                       /* output */
+        :                               /* input */
+        :"%eax", "%ecx", "%edx"         /* clobbered registers */
+    );
+#else
+ }
+#endif
+
+    return c1;
+}
 #endif
 #endif
 
-static struct x86cpu_caps_s x86cpu_caps_compile = { 0, 0, 0, 0, 0, 0, 0, 0, 0};
-static struct x86cpu_caps_s x86cpu_caps_detect = { 1, 1, 1, 1, 1, 1, 1, 1, 1};
-struct x86cpu_caps_s x86cpu_caps_use = { 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static struct x86cpu_caps_s x86cpu_caps_compile = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static struct x86cpu_caps_s x86cpu_caps_detect = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+struct x86cpu_caps_s x86cpu_caps_use = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
 void cpu_caps_detect(void)
 {
@@ -126,6 +215,16 @@ void cpu_caps_detect(void)
 #ifdef HAVE_SSSE3
     x86cpu_caps_compile.ssse3 = 1;
 #endif
+#ifdef HAVE_AVX
+    x86cpu_caps_compile.avx = 1;
+#endif
+#ifdef HAVE_AVX2
+    x86cpu_caps_compile.avx2 = 1;
+    x86cpu_caps_compile.fma = 1;
+#endif
+#ifdef HAVE_AVX512BW
+    x86cpu_caps_compile.avx512bw = 1;
+#endif
 #ifdef HAVE_3DNOW
     x86cpu_caps_compile.amd_3dnow = 1;
 #endif
@@ -151,6 +250,26 @@ void cpu_caps_detect(void)
         x86cpu_caps_detect.sse3         = (caps2 >> SSE3_BIT) & 1;
         x86cpu_caps_detect.ssse3        = (caps2 >> SSSE3_BIT) & 1;
 
+        /* AVX needs support by the OS, which has to save the ymm registers */
+        x86cpu_caps_detect.avx  = 0;
+        x86cpu_caps_detect.avx2 = 0;
+        x86cpu_caps_detect.fma  = 0;
+        x86cpu_caps_detect.avx512bw = 0;
+        if (((caps2 >> OSXSAVE_BIT) & 1) && ((caps2 >> AVX_BIT) & 1) &&
+            (cpu_caps_detect_xcr0() & XCR0_SSE_AVX) == XCR0_SSE_AVX) {
+            uint32_t max_leaf, caps4;
+
+            cpu_caps_detect_x86_ext(&max_leaf, &caps4);
+            if (max_leaf < 7)
+                caps4 = 0;
+            x86cpu_caps_detect.avx  = 1;
+            x86cpu_caps_detect.avx2 = (caps4 >> AVX2_BIT) & 1;
+            x86cpu_caps_detect.fma  = (caps2 >> FMA_BIT) & 1;
+            x86cpu_caps_detect.avx512bw = ((caps4 >> AVX512F_BIT) & 1) &&
+                                          ((caps4 >> AVX512BW_BIT) & 1) &&
+                (cpu_caps_detect_xcr0() & XCR0_AVX512) == XCR0_AVX512;
+        }
+
         x86cpu_caps_detect.amd_3dnow    = (caps3 >> AMD_3DNOW_BIT) & 1;
         x86cpu_caps_detect.amd_3dnowext = (caps3 >> AMD_3DNOWEXT_BIT) & 1;
         x86cpu_caps_detect.amd_sse_mmx  = (caps3 >> AMD_SSE_MMX_BIT) & 1;
@@ -167,6 +286,10 @@ void cpu_caps_detect(void)
     x86cpu_caps_use.sse2         = x86cpu_caps_detect.sse2         & x86cpu_caps_compile.sse2;
     x86cpu_caps_use.sse3         = x86cpu_caps_detect.sse3         & x86cpu_caps_compile.sse3;
     x86cpu_caps_use.ssse3        = x86cpu_caps_detect.ssse3        & x86cpu_caps_compile.ssse3;
+    x86cpu_caps_use.avx          = x86cpu_caps_detect.avx          & x86cpu_caps_compile.avx;
+    x86cpu_caps_use.avx2         = x86cpu_caps_detect.avx2         & x86cpu_caps_compile.avx2;
+    x86cpu_caps_use.fma          = x86cpu_caps_detect.fma          & x86cpu_caps_compile.fma;
+    x86cpu_caps_use.avx512bw     = x86cpu_caps_detect.avx512bw     & x86cpu_caps_compile.avx512bw;
     x86cpu_caps_use.amd_3dnow    = x86cpu_caps_detect.amd_3dnow    & x86cpu_caps_compile.amd_3dnow;
     x86cpu_caps_use.amd_3dnowext = x86cpu_caps_detect.amd_3dnowext & x86cpu_caps_compile.amd_3dnowext;
     x86cpu_caps_use.amd_sse_mmx  = x86cpu_caps_detect.amd_sse_mmx  & x86cpu_caps_compile.amd_sse_mmx;
@@ -174,11 +297,24 @@ void cpu_caps_detect(void)
 
 void apply_simd_restrictions(AftenSimdInstructions *simd_instructions)
 {
+    /* the later extensions are VEX or EVEX encoded and need AVX, and the
+       AVX-512BW code is built on the AVX2 one, so they go with them */
+    if (!simd_instructions->avx) {
+        simd_instructions->avx2 = 0;
+        simd_instructions->fma  = 0;
+    }
+    if (!simd_instructions->avx2)
+        simd_instructions->avx512bw = 0;
+
     x86cpu_caps_use.mmx          &= simd_instructions->mmx;
     x86cpu_caps_use.sse          &= simd_instructions->sse;
     x86cpu_caps_use.sse2         &= simd_instructions->sse2;
     x86cpu_caps_use.sse3         &= simd_instructions->sse3;
     x86cpu_caps_use.ssse3        &= simd_instructions->ssse3;
+    x86cpu_caps_use.avx          &= simd_instructions->avx;
+    x86cpu_caps_use.avx2         &= simd_instructions->avx2;
+    x86cpu_caps_use.fma          &= simd_instructions->fma;
+    x86cpu_caps_use.avx512bw     &= simd_instructions->avx512bw;
     x86cpu_caps_use.amd_3dnow    &= simd_instructions->amd_3dnow;
     x86cpu_caps_use.amd_3dnowext &= simd_instructions->amd_3dnowext;
     x86cpu_caps_use.amd_sse_mmx  &= simd_instructions->amd_sse_mmx;
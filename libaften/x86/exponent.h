@@ -34,15 +34,32 @@
 
 #include "common.h"
 
+#ifdef HAVE_AVX512BW
+extern void exponent_min_avx512bw(uint8_t *expTarget, uint8_t *exp, uint8_t *exp1, int n);
+extern void encode_exp_blk_ch_avx512bw(uint8_t *exp, int ncoefs, int exp_strategy);
+extern int exponent_run_error_avx512bw(uint8_t **exp, int nblks, int ncoefs, int exp_strategy);
+#endif
+#ifdef HAVE_AVX2
+extern void exponent_min_avx2(uint8_t *expTarget, uint8_t *exp, uint8_t *exp1, int n);
+extern void encode_exp_blk_ch_avx2(uint8_t *exp, int ncoefs, int exp_strategy);
+extern int exponent_run_error_avx2(uint8_t **exp, int nblks, int ncoefs, int exp_strategy);
+#ifndef CONFIG_DOUBLE
+extern void extract_exponents_avx2(uint8_t *exp, FLOAT *coef, int n);
+#endif
+#endif
 #ifdef HAVE_SSE2
 extern void exponent_min_sse2(uint8_t *expTarget, uint8_t *exp, uint8_t *exp1, int n);
 extern void encode_exp_blk_ch_sse2(uint8_t *exp, int ncoefs, int exp_strategy);
-extern int exponent_sum_square_error_sse2(uint8_t *exp0, uint8_t *exp1, int ncoefs);
+extern int exponent_run_error_sse2(uint8_t **exp, int nblks, int ncoefs, int exp_strategy);
+#ifdef CONFIG_DOUBLE
+extern void extract_exponents_sse2_pd(uint8_t *exp, FLOAT *coef, int n);
+#else
+extern void extract_exponents_sse2(uint8_t *exp, FLOAT *coef, int n);
+#endif
 #endif
 #ifdef HAVE_MMX
 extern void exponent_min_mmx(uint8_t *expTarget, uint8_t *exp, uint8_t *exp1, int n);
 extern void encode_exp_blk_ch_mmx(uint8_t *exp, int ncoefs, int exp_strategy);
-extern int exponent_sum_square_error_mmx(uint8_t *exp0, uint8_t *exp1, int ncoefs);
 #endif
 
 #endif /* X86_EXPONENT_H */
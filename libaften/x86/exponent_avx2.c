@@ -0,0 +1,158 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * AVX2 exponent functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file x86/exponent_avx2.c
+ * A/52 avx2 optimized exponent functions
+ */
+
+#include "a52enc.h"
+#include "x86/simd_support.h"
+
+#define V               __m256i
+#define W               32
+#define V_LOAD(p)       _mm256_loadu_si256((const __m256i *)(p))
+#define V_STORE(p, v)   _mm256_storeu_si256((__m256i *)(p), v)
+#define V_MIN           _mm256_min_epu8
+#define V_ADDS          _mm256_adds_epu8
+#define V_SUBS          _mm256_subs_epu8
+#define V_AND           _mm256_and_si256
+#define V_OR            _mm256_or_si256
+#define V_SRLI16        _mm256_srli_epi16
+#define V_SLLI16        _mm256_slli_epi16
+#define V_SRLI32        _mm256_srli_epi32
+#define V_SLLI32        _mm256_slli_epi32
+#define V_SET1_8(x)     _mm256_set1_epi8((char)(x))
+#define V_SET1_16       _mm256_set1_epi16
+#define V_SET1_32       _mm256_set1_epi32
+#define V_UNPACKLO8     _mm256_unpacklo_epi8
+#define V_UNPACKHI8     _mm256_unpackhi_epi8
+#define V_MADD16        _mm256_madd_epi16
+#define V_ADD32         _mm256_add_epi32
+#define V_ZERO          _mm256_setzero_si256()
+#define V_ONES          _mm256_set1_epi8(-1)
+#define V_INDEX         _mm256_setr_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15, \
+                                         16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31)
+// the byte shifts work within 128-bit lanes, so the other lane is lined up
+// next to each one first
+#define V_SHL(v, n)     _mm256_alignr_epi8(v, _mm256_permute2x128_si256(v, V_ONES, 0x02), (16-(n)) & 15)
+#define V_SHR(v, n)     _mm256_alignr_epi8(_mm256_permute2x128_si256(v, V_ONES, 0x21), v, n)
+#define V_KEEP_LE(v, n) _mm256_andnot_si256(gt_mask(n), v)
+#define V_FILL_GT(v, n) _mm256_or_si256(v, gt_mask(n))
+
+/** bytes above n set */
+static inline __m256i
+gt_mask(int n)
+{
+    return _mm256_cmpgt_epi8(V_INDEX, _mm256_set1_epi8((char)MIN(n, 32)));
+}
+
+static inline int
+v_first(__m256i v)
+{
+    return _mm_cvtsi128_si32(_mm256_castsi256_si128(v)) & 0xFF;
+}
+
+static inline int
+v_last(__m256i v)
+{
+    return _mm256_extract_epi8(v, 31) & 0xFF;
+}
+
+static inline int
+v_hsum32(__m256i v)
+{
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v),
+                              _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1,0,3,2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2,3,0,1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+#include "x86/exponent_common.h"
+
+
+void
+exponent_min_avx2(uint8_t *expTarget, uint8_t *exp, uint8_t *exp1, int n)
+{
+    int i;
+
+    for (i = 0; i < (n & ~31); i += 32)
+        V_STORE(&expTarget[i], _mm256_min_epu8(V_LOAD(&exp[i]), V_LOAD(&exp1[i])));
+    if (i + 16 <= n) {
+        __m128i vexp = _mm_loadu_si128((__m128i*)&exp[i]);
+        __m128i vexp1 = _mm_loadu_si128((__m128i*)&exp1[i]);
+        _mm_storeu_si128((__m128i*)&expTarget[i], _mm_min_epu8(vexp, vexp1));
+        i += 16;
+    }
+    for (; i < n; ++i)
+        expTarget[i] = MIN(exp[i], exp1[i]);
+}
+
+
+void
+encode_exp_blk_ch_avx2(uint8_t *exp, int ncoefs, int exp_strategy)
+{
+    encode_exp_groups(exp, ncoefs, exp_strategy);
+}
+
+
+int
+exponent_run_error_avx2(uint8_t **exp, int nblks, int ncoefs, int exp_strategy)
+{
+    return run_error(exp, nblks, ncoefs, exp_strategy);
+}
+
+
+#ifndef CONFIG_DOUBLE
+/**
+ * 126 - biased exponent of 8 floats
+ */
+static inline __m256i
+exp_ps(const FLOAT *coef)
+{
+    __m256i v = _mm256_castps_si256(_mm256_loadu_ps(coef));
+    v = _mm256_and_si256(_mm256_srli_epi32(v, 23), _mm256_set1_epi32(0xFF));
+    return _mm256_sub_epi32(_mm256_set1_epi32(126), v);
+}
+
+/**
+ * Same as extract_exponents_sse2
+ */
+void
+extract_exponents_avx2(uint8_t *exp, FLOAT *coef, int n)
+{
+    const __m256i max_exp = _mm256_set1_epi16(24);
+    const __m256i lo_byte = _mm256_set1_epi16(0xFF);
+    // the packs work within 128-bit lanes, leaving the dwords in this order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int i;
+
+    for (i = 0; i < n; i += 32) {
+        __m256i e0 = _mm256_packs_epi32(exp_ps(&coef[i   ]), exp_ps(&coef[i+ 8]));
+        __m256i e2 = _mm256_packs_epi32(exp_ps(&coef[i+16]), exp_ps(&coef[i+24]));
+        e0 = _mm256_and_si256(_mm256_min_epi16(e0, max_exp), lo_byte);
+        e2 = _mm256_and_si256(_mm256_min_epi16(e2, max_exp), lo_byte);
+        e0 = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(e0, e2), order);
+        V_STORE(&exp[i], e0);
+    }
+}
+#endif /* CONFIG_DOUBLE */
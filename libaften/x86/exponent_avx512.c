@@ -0,0 +1,118 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * AVX-512BW exponent functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file x86/exponent_avx512.c
+ * A/52 avx-512bw optimized exponent functions
+ */
+
+#include "a52enc.h"
+#include "x86/simd_support.h"
+
+/** mask of the first n bytes, all of them from 64 on */
+static inline __mmask64
+mask_n(int n)
+{
+    return (n >= 64) ? ~(__mmask64)0 : ((__mmask64)1 << n) - 1;
+}
+
+#define V               __m512i
+#define W               64
+#define V_LOAD(p)       _mm512_loadu_si512((const void *)(p))
+#define V_STORE(p, v)   _mm512_storeu_si512((void *)(p), v)
+#define V_LOAD_N(p, n)  _mm512_maskz_loadu_epi8(mask_n(n), (const void *)(p))
+#define V_MIN           _mm512_min_epu8
+#define V_ADDS          _mm512_adds_epu8
+#define V_SUBS          _mm512_subs_epu8
+#define V_AND           _mm512_and_si512
+#define V_OR            _mm512_or_si512
+#define V_SRLI16        _mm512_srli_epi16
+#define V_SLLI16        _mm512_slli_epi16
+#define V_SRLI32        _mm512_srli_epi32
+#define V_SLLI32        _mm512_slli_epi32
+#define V_SET1_8(x)     _mm512_set1_epi8((char)(x))
+#define V_SET1_16       _mm512_set1_epi16
+#define V_SET1_32       _mm512_set1_epi32
+#define V_UNPACKLO8     _mm512_unpacklo_epi8
+#define V_UNPACKHI8     _mm512_unpackhi_epi8
+#define V_MADD16        _mm512_madd_epi16
+#define V_ADD32         _mm512_add_epi32
+#define V_ZERO          _mm512_setzero_si512()
+#define V_ONES          _mm512_set1_epi8(-1)
+#define V_INDEX         _mm512_set_epi8(63,62,61,60,59,58,57,56,55,54,53,52,51,50,49,48, \
+                                        47,46,45,44,43,42,41,40,39,38,37,36,35,34,33,32, \
+                                        31,30,29,28,27,26,25,24,23,22,21,20,19,18,17,16, \
+                                        15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0)
+// whole 128-bit lanes are moved with valignq, the rest within the lanes
+#define V_SHL(v, n)     ((n) >= 32 ? _mm512_alignr_epi64(v, V_ONES, 4) : \
+                         _mm512_alignr_epi8(v, _mm512_alignr_epi64(v, V_ONES, 6), (16-(n)) & 15))
+#define V_SHR(v, n)     ((n) >= 32 ? _mm512_alignr_epi64(V_ONES, v, 4) : \
+                         _mm512_alignr_epi8(_mm512_alignr_epi64(V_ONES, v, 2), v, (n) & 31))
+#define V_KEEP_LE(v, n) _mm512_maskz_mov_epi8(mask_n((n) + 1), v)
+#define V_FILL_GT(v, n) _mm512_mask_mov_epi8(V_ONES, mask_n((n) + 1), v)
+
+static inline int
+v_first(__m512i v)
+{
+    return _mm_cvtsi128_si32(_mm512_castsi512_si128(v)) & 0xFF;
+}
+
+static inline int
+v_last(__m512i v)
+{
+    return _mm_extract_epi8(_mm512_extracti32x4_epi32(v, 3), 15);
+}
+
+static inline int
+v_hsum32(__m512i v)
+{
+    return _mm512_reduce_add_epi32(v);
+}
+
+#include "x86/exponent_common.h"
+
+
+void
+exponent_min_avx512bw(uint8_t *expTarget, uint8_t *exp, uint8_t *exp1, int n)
+{
+    int i;
+
+    for (i = 0; i < (n & ~63); i += 64)
+        V_STORE(&expTarget[i], _mm512_min_epu8(V_LOAD(&exp[i]), V_LOAD(&exp1[i])));
+    if (i < n)
+        _mm512_mask_storeu_epi8(&expTarget[i], mask_n(n - i),
+                                _mm512_min_epu8(V_LOAD_N(&exp[i], n - i),
+                                                V_LOAD_N(&exp1[i], n - i)));
+}
+
+
+void
+encode_exp_blk_ch_avx512bw(uint8_t *exp, int ncoefs, int exp_strategy)
+{
+    encode_exp_groups(exp, ncoefs, exp_strategy);
+}
+
+
+int
+exponent_run_error_avx512bw(uint8_t **exp, int nblks, int ncoefs, int exp_strategy)
+{
+    return run_error(exp, nblks, ncoefs, exp_strategy);
+}
@@ -0,0 +1,316 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * Exponent strategy functions shared by the SSE2, AVX2 and AVX-512BW versions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation;
+ * version 2 of the License
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file x86/exponent_common.h
+ * Exponent grouping and strategy error, written once for all vector widths
+ *
+ * The including file defines the vector type V of W bytes and the
+ * operations V_LOAD, V_STORE (both unaligned), V_MIN (unsigned bytes),
+ * V_ADDS, V_SUBS (unsigned saturated bytes), V_AND, V_OR, V_SRLI16,
+ * V_SLLI16, V_SRLI32, V_SLLI32, V_SET1_8, V_SET1_16, V_SET1_32,
+ * V_UNPACKLO8, V_UNPACKHI8, V_MADD16, V_ADD32, V_ZERO and V_INDEX (bytes
+ * 0, 1, ... W-1).  V_SHL(v, n) and V_SHR(v, n) move the bytes n places up
+ * or down the whole vector, shifting in 0xFF, for n a power of 2 below W.
+ * V_KEEP_LE(v, n) zeroes the bytes above n, V_FILL_GT(v, n) sets them to
+ * 0xFF.  v_first(), v_last() and v_hsum32() return the first byte, the last
+ * byte and the sum of the 32-bit lanes.  If the instruction set can mask
+ * loads, V_LOAD_N(p, n) reads only the first n bytes.
+ *
+ * The exponents are worked on at coefficient resolution: each group of 1,
+ * 2 or 4 coefficients starts at a multiple of its size plus 1, so a vector
+ * loaded at such a position holds whole groups.
+ *
+ * The delta limit between the groups is a min-plus scan,
+ * v[j] = min(x[j], v[j-1] + 2) = min over i <= j of x[i] + 2*(j-i),
+ * which is done in log2(groups per vector) shifted steps inside each vector
+ * with saturated byte adds.  Only the value of the last group is carried
+ * from one vector to the next, so the serial part is one step per vector.
+ */
+
+#ifndef X86_EXPONENT_COMMON_H
+#define X86_EXPONENT_COMMON_H
+
+/** minimum of each group, left in its first byte */
+static inline V
+group_min(V v, int shift)
+{
+    if (shift == 1) {
+        v = V_MIN(v, V_SRLI16(v, 8));
+    } else if (shift == 2) {
+        v = V_MIN(v, V_SRLI32(v, 8));
+        v = V_MIN(v, V_SRLI32(v, 16));
+    }
+    return v;
+}
+
+/** copy the first byte of each group to the rest of the group */
+static inline V
+group_fill(V v, int shift)
+{
+    if (shift == 1) {
+        v = V_AND(v, V_SET1_16(0xFF));
+        v = V_OR(v, V_SLLI16(v, 8));
+    } else if (shift == 2) {
+        v = V_AND(v, V_SET1_32(0xFF));
+        v = V_OR(v, V_SLLI32(v, 8));
+        v = V_OR(v, V_SLLI32(v, 16));
+    }
+    return v;
+}
+
+static inline V
+abs_diff(V a, V b)
+{
+    return V_OR(V_SUBS(a, b), V_SUBS(b, a));
+}
+
+static inline V
+sum_squares(V acc, V d)
+{
+    V lo = V_UNPACKLO8(d, V_ZERO);
+    V hi = V_UNPACKHI8(d, V_ZERO);
+    return V_ADD32(acc, V_ADD32(V_MADD16(lo, lo), V_MADD16(hi, hi)));
+}
+
+/**
+ * Load the W exponents from position k of a 256 byte row.  The last vector
+ * of a row would end one byte past it, so it is loaded one byte early.
+ */
+static inline V
+load_exp(const uint8_t *row, int k)
+{
+#ifdef V_LOAD_N
+    return V_LOAD_N(&row[k], 256 - k);
+#else
+    if (k + W > 256)
+        return V_SHR(V_LOAD(&row[k-1]), 1);
+    return V_LOAD(&row[k]);
+#endif
+}
+
+/**
+ * 2 * (number of groups from the start of the vector up to each byte), or
+ * down to the end of the vector, counting the group of the byte itself
+ */
+static inline V
+group_ramp(int shift, int down)
+{
+    V v = V_INDEX;
+
+    if (down)
+        v = V_SUBS(V_SET1_8(W-1), v);
+    if (shift == 1)
+        v = V_AND(V_SRLI16(v, 1), V_SET1_8(0x7F));
+    else if (shift == 2)
+        v = V_AND(V_SRLI16(v, 2), V_SET1_8(0x3F));
+    v = V_ADDS(v, V_SET1_8(1));
+    return V_ADDS(v, v);
+}
+
+#define SCAN_UP(v, n, d)    v = V_MIN(v, V_ADDS(V_SHL(v, n), V_SET1_8(d)))
+#define SCAN_DOWN(v, n, d)  v = V_MIN(v, V_ADDS(V_SHR(v, n), V_SET1_8(d)))
+
+/** limit the increase from each group to the next inside the vector */
+static inline V
+scan_up(V v, int shift)
+{
+    if (shift == 0) {
+        SCAN_UP(v, 1, 2); SCAN_UP(v, 2, 4); SCAN_UP(v, 4, 8); SCAN_UP(v, 8, 16);
+#if W >= 32
+        SCAN_UP(v, 16, 32);
+#endif
+#if W >= 64
+        SCAN_UP(v, 32, 64);
+#endif
+    } else if (shift == 1) {
+        SCAN_UP(v, 2, 2); SCAN_UP(v, 4, 4); SCAN_UP(v, 8, 8);
+#if W >= 32
+        SCAN_UP(v, 16, 16);
+#endif
+#if W >= 64
+        SCAN_UP(v, 32, 32);
+#endif
+    } else {
+        SCAN_UP(v, 4, 2); SCAN_UP(v, 8, 4);
+#if W >= 32
+        SCAN_UP(v, 16, 8);
+#endif
+#if W >= 64
+        SCAN_UP(v, 32, 16);
+#endif
+    }
+    return v;
+}
+
+/** limit the decrease from each group to the next inside the vector */
+static inline V
+scan_down(V v, int shift)
+{
+    if (shift == 0) {
+        SCAN_DOWN(v, 1, 2); SCAN_DOWN(v, 2, 4); SCAN_DOWN(v, 4, 8); SCAN_DOWN(v, 8, 16);
+#if W >= 32
+        SCAN_DOWN(v, 16, 32);
+#endif
+#if W >= 64
+        SCAN_DOWN(v, 32, 64);
+#endif
+    } else if (shift == 1) {
+        SCAN_DOWN(v, 2, 2); SCAN_DOWN(v, 4, 4); SCAN_DOWN(v, 8, 8);
+#if W >= 32
+        SCAN_DOWN(v, 16, 16);
+#endif
+#if W >= 64
+        SCAN_DOWN(v, 32, 32);
+#endif
+    } else {
+        SCAN_DOWN(v, 4, 2); SCAN_DOWN(v, 8, 4);
+#if W >= 32
+        SCAN_DOWN(v, 16, 8);
+#endif
+#if W >= 64
+        SCAN_DOWN(v, 32, 16);
+#endif
+    }
+    return v;
+}
+
+/**
+ * Set dec to the minimum of the exponents of nblks blocks, grouped for the
+ * strategy given by shift, and limit the increase between the groups up to
+ * end.  Whole vectors are written, up to dec[256].  Returns the
+ * DC exponent, which is not constrained yet.
+ */
+static int
+merge_up(uint8_t *dec, uint8_t **exp, int nblks, int end, int shift)
+{
+    V ramp = group_ramp(shift, 0);
+    int b, k, v, dc;
+
+    dc = 15;
+    for (b = 0; b < nblks; b++)
+        dc = MIN(dc, exp[b][0]);
+
+    v = dc;
+    for (k = 1; k <= end; k += W) {
+        V vexp = load_exp(exp[0], k);
+        for (b = 1; b < nblks; b++)
+            vexp = V_MIN(vexp, load_exp(exp[b], k));
+        vexp = scan_up(group_fill(group_min(vexp, shift), shift), shift);
+        vexp = V_MIN(vexp, V_ADDS(V_SET1_8(v), ramp));
+        v = v_last(vexp);
+        V_STORE(&dec[k], vexp);
+    }
+    return dc;
+}
+
+/**
+ * Limit the decrease between the groups of the vector at k of dec, given
+ * v, the group after it.  Everything above end is ignored.
+ */
+static inline V
+clamp_down(const uint8_t *dec, int k, int end, int shift, V ramp, int v)
+{
+    V vdec = V_FILL_GT(V_LOAD(&dec[k]), end - k);
+
+    vdec = scan_down(vdec, shift);
+    return V_MIN(vdec, V_ADDS(V_SET1_8(v), ramp));
+}
+
+/**
+ * Same as encode_exp_blk_ch in exponent.c
+ */
+static inline void
+encode_exp_groups(uint8_t *exp, int ncoefs, int exp_strategy)
+{
+    // the last vector may end at 256
+    uint8_t dec[257];
+    int k, end, shift, v, dc;
+    V ramp;
+
+    shift = exp_strategy - 1;
+    end = (nexpgrptab[exp_strategy-1][ncoefs] * 3) << shift;
+    dc = merge_up(dec, &exp, 1, end, shift);
+
+    ramp = group_ramp(shift, 1);
+    v = 0xFF;
+    for (k = 1 + ((end - 1) & ~(W - 1)); k > 0 && end; k -= W) {
+        V vdec = clamp_down(dec, k, end, shift, ramp, v);
+        v = v_first(vdec);
+        V_STORE(&dec[k], vdec);
+    }
+    exp[0] = MIN(dc, v+2);
+
+    for (k = 1; k + W - 1 <= end; k += W)
+        V_STORE(&exp[k], V_LOAD(&dec[k]));
+    for (; k <= end; k++)
+        exp[k] = dec[k];
+}
+
+/**
+ * Same as exponent_run_error in exponent.c
+ */
+static inline int
+run_error(uint8_t **exp, int nblks, int ncoefs, int exp_strategy)
+{
+    uint8_t dec[257];
+    int b, k, end, last, shift, v, dc, err, exp_error;
+    V ramp, vacc = V_ZERO;
+
+    shift = exp_strategy - 1;
+    end = (nexpgrptab[exp_strategy-1][ncoefs] * 3) << shift;
+    dc = merge_up(dec, exp, nblks, end, shift);
+
+    // the decrease is limited going down, comparing to every block on the way
+    ramp = group_ramp(shift, 1);
+    last = MIN(end, ncoefs - 1);
+    v = 0xFF;
+    for (k = 1 + ((end - 1) & ~(W - 1)); k > 0 && end; k -= W) {
+        V vdec = clamp_down(dec, k, end, shift, ramp, v);
+        v = v_first(vdec);
+        if (k > last)
+            continue;
+        for (b = 0; b < nblks; b++) {
+            V vd = abs_diff(load_exp(exp[b], k), vdec);
+            vacc = sum_squares(vacc, V_KEEP_LE(vd, last - k));
+        }
+    }
+    dc = MIN(dc, v+2);
+    exp_error = v_hsum32(vacc);
+
+    // coefficients above the last group only get the minimum
+    for (k = end + 1; k < ncoefs; k++) {
+        v = exp[0][k];
+        for (b = 1; b < nblks; b++)
+            v = MIN(v, exp[b][k]);
+        for (b = 0; b < nblks; b++) {
+            err = exp[b][k] - v;
+            exp_error += err * err;
+        }
+    }
+    for (b = 0; b < nblks; b++) {
+        err = exp[b][0] - dc;
+        exp_error += err * err;
+    }
+    return exp_error;
+}
+
+#endif /* X86_EXPONENT_COMMON_H */
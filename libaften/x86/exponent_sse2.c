@@ -267,47 +267,145 @@ encode_exp_blk_ch_sse2(uint8_t *exp, int ncoefs, int exp_strategy)
     }
 }
 
+#define V               __m128i
+#define W               16
+#define V_LOAD(p)       _mm_loadu_si128((const __m128i *)(p))
+#define V_STORE(p, v)   _mm_storeu_si128((__m128i *)(p), v)
+#define V_MIN           _mm_min_epu8
+#define V_ADDS          _mm_adds_epu8
+#define V_SUBS          _mm_subs_epu8
+#define V_AND           _mm_and_si128
+#define V_OR            _mm_or_si128
+#define V_SRLI16        _mm_srli_epi16
+#define V_SLLI16        _mm_slli_epi16
+#define V_SRLI32        _mm_srli_epi32
+#define V_SLLI32        _mm_slli_epi32
+#define V_SET1_8(x)     _mm_set1_epi8((char)(x))
+#define V_SET1_16       _mm_set1_epi16
+#define V_SET1_32       _mm_set1_epi32
+#define V_UNPACKLO8     _mm_unpacklo_epi8
+#define V_UNPACKHI8     _mm_unpackhi_epi8
+#define V_MADD16        _mm_madd_epi16
+#define V_ADD32         _mm_add_epi32
+#define V_ZERO          _mm_setzero_si128()
+#define V_ONES          _mm_set1_epi8(-1)
+#define V_INDEX         _mm_setr_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15)
+#define V_SHL(v, n)     _mm_or_si128(_mm_slli_si128(v, n), _mm_srli_si128(V_ONES, 16-(n)))
+#define V_SHR(v, n)     _mm_or_si128(_mm_srli_si128(v, n), _mm_slli_si128(V_ONES, 16-(n)))
+#define V_KEEP_LE(v, n) _mm_andnot_si128(gt_mask(n), v)
+#define V_FILL_GT(v, n) _mm_or_si128(v, gt_mask(n))
+
+/** bytes above n set */
+static inline __m128i
+gt_mask(int n)
+{
+    return _mm_cmpgt_epi8(V_INDEX, _mm_set1_epi8((char)MIN(n, 16)));
+}
+
+static inline int
+v_first(__m128i v)
+{
+    return _mm_cvtsi128_si32(v) & 0xFF;
+}
+
+static inline int
+v_last(__m128i v)
+{
+    return _mm_extract_epi16(v, 7) >> 8;
+}
+
+static inline int
+v_hsum32(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+#include "x86/exponent_common.h"
+
 int
-exponent_sum_square_error_sse2(uint8_t *exp0, uint8_t *exp1, int ncoefs)
+exponent_run_error_sse2(uint8_t **exp, int nblks, int ncoefs, int exp_strategy)
 {
-    int i, err;
-    int exp_error = 0;
-    union {
-        __m128i v;
-        int32_t res[4];
-    } ures;
-    __m128i vzero = _mm_setzero_si128();
-    __m128i vres = vzero;
+    return run_error(exp, nblks, ncoefs, exp_strategy);
+}
 
-    for (i = 0; i < (ncoefs & ~15); i+=16) {
-        __m128i vexp = _mm_loadu_si128((__m128i*)&exp0[i]);
-        __m128i vexp2 = _mm_loadu_si128((__m128i*)&exp1[i]);
-#if 0
-        //safer but needed?
-        __m128i vexphi = _mm_unpackhi_epi8(vexp, vzero);
-        __m128i vexp2hi = _mm_unpackhi_epi8(vexp2, vzero);
-        __m128i vexplo = _mm_unpacklo_epi8(vexp, vzero);
-        __m128i vexp2lo = _mm_unpacklo_epi8(vexp2, vzero);
-        __m128i verrhi = _mm_sub_epi16(vexphi, vexp2hi);
-        __m128i verrlo = _mm_sub_epi16(vexplo, vexp2lo);
-#else
-        __m128i verr = _mm_sub_epi8(vexp, vexp2);
-        __m128i vsign = _mm_cmplt_epi8(verr, vzero);
-        __m128i verrhi = _mm_unpackhi_epi8(verr, vsign);
-        __m128i verrlo = _mm_unpacklo_epi8(verr, vsign);
-#endif
-        verrhi = _mm_madd_epi16(verrhi, verrhi);
-        verrlo = _mm_madd_epi16(verrlo, verrlo);
-        verrhi = _mm_add_epi32(verrhi, verrlo);
-        vres = _mm_add_epi32(vres, verrhi);
+
+#ifdef CONFIG_DOUBLE
+/**
+ * Biased exponents of 2 doubles as the low dwords of both quadwords.
+ */
+static inline __m128i
+biased_exp_pd(const FLOAT *coef)
+{
+    __m128i v = _mm_castpd_si128(_mm_load_pd(coef));
+    return _mm_and_si128(_mm_srli_epi64(v, 52), _mm_set1_epi32(0x7FF));
+}
+
+/**
+ * Same result as the C version: for a coefficient with biased exponent e,
+ * 23 - log2i(|c| * 2^24) is 1022 - e, and 24 once |c| * 2^24 drops below 1.
+ * Coefficients of 2.0 and above wrap around in the uint8_t just as in C.
+ */
+void
+extract_exponents_sse2_pd(uint8_t *exp, FLOAT *coef, int n)
+{
+    const __m128i bias = _mm_set1_epi32(1022);
+    const __m128i max_exp = _mm_set1_epi16(24);
+    const __m128i lo_byte = _mm_set1_epi16(0xFF);
+    int i;
+
+    for (i = 0; i < n; i += 8) {
+        __m128i e0 = biased_exp_pd(&coef[i  ]);
+        __m128i e1 = biased_exp_pd(&coef[i+2]);
+        __m128i e2 = biased_exp_pd(&coef[i+4]);
+        __m128i e3 = biased_exp_pd(&coef[i+6]);
+        // gather the low dwords: e0 = {0,1,2,3}, e2 = {4,5,6,7}
+        e0 = _mm_or_si128(e0, _mm_slli_epi64(e1, 32));
+        e2 = _mm_or_si128(e2, _mm_slli_epi64(e3, 32));
+        e0 = _mm_shuffle_epi32(e0, _MM_SHUFFLE(3,1,2,0));
+        e2 = _mm_shuffle_epi32(e2, _MM_SHUFFLE(3,1,2,0));
+        e0 = _mm_sub_epi32(bias, e0);
+        e2 = _mm_sub_epi32(bias, e2);
+        e0 = _mm_min_epi16(_mm_packs_epi32(e0, e2), max_exp);
+        e0 = _mm_and_si128(e0, lo_byte);
+        _mm_storel_epi64((__m128i*)&exp[i], _mm_packus_epi16(e0, e0));
     }
-    _mm_store_si128(&ures.v, vres);
-    ures.res[0]+=ures.res[1];
-    ures.res[2]+=ures.res[3];
-    exp_error += ures.res[0]+ures.res[2];
-    for (; i < ncoefs; ++i) {
-        err = exp0[i] - exp1[i];
-        exp_error += (err * err);
+}
+#else
+/**
+ * Biased exponents of 4 floats
+ */
+static inline __m128i
+biased_exp_ps(const FLOAT *coef)
+{
+    __m128i v = _mm_castps_si128(_mm_load_ps(coef));
+    return _mm_and_si128(_mm_srli_epi32(v, 23), _mm_set1_epi32(0xFF));
+}
+
+/**
+ * Same result as the C version: for a coefficient with biased exponent e,
+ * 23 - log2i(|c| * 2^24) is 126 - e, and 24 once |c| * 2^24 drops below 1.
+ * Coefficients of 1.0 and above wrap around in the uint8_t just as in C.
+ */
+void
+extract_exponents_sse2(uint8_t *exp, FLOAT *coef, int n)
+{
+    const __m128i bias = _mm_set1_epi32(126);
+    const __m128i max_exp = _mm_set1_epi16(24);
+    const __m128i lo_byte = _mm_set1_epi16(0xFF);
+    int i;
+
+    for (i = 0; i < n; i += 16) {
+        __m128i e0 = _mm_sub_epi32(bias, biased_exp_ps(&coef[i   ]));
+        __m128i e1 = _mm_sub_epi32(bias, biased_exp_ps(&coef[i+ 4]));
+        __m128i e2 = _mm_sub_epi32(bias, biased_exp_ps(&coef[i+ 8]));
+        __m128i e3 = _mm_sub_epi32(bias, biased_exp_ps(&coef[i+12]));
+        e0 = _mm_min_epi16(_mm_packs_epi32(e0, e1), max_exp);
+        e2 = _mm_min_epi16(_mm_packs_epi32(e2, e3), max_exp);
+        e0 = _mm_and_si128(e0, lo_byte);
+        e2 = _mm_and_si128(e2, lo_byte);
+        _mm_storeu_si128((__m128i*)&exp[i], _mm_packus_epi16(e0, e2));
     }
-    return exp_error;
 }
+#endif /* CONFIG_DOUBLE */
@@ -30,6 +30,7 @@
 #define _mov(x, y)  __st(mov x, y)
 #define _xor(x, y)  __st(xor x, y)
 #define _test(x, y) __st(test x, y)
+#define _xgetbv     _st(.byte 0x0f) _st(.byte 0x01) _st(.byte 0xd0)
 
 #define _(x)        $##x
 #define _l(x)       #x":\n\t"
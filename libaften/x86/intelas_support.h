@@ -30,6 +30,7 @@
 #define _mov(x, y)  __st(mov y, x)
 #define _xor(x, y)  __st(xor y, x)
 #define _test(x, y) __st(test y, x)
+#define _xgetbv     _emit 0x0f _emit 0x01 _emit 0xd0
 
 #define _(x)        x
 #define _l(x)       x##:
@@ -56,6 +56,18 @@ extern void mdct_init_sse(struct A52Context *ctx);
 #ifdef HAVE_SSE3
 extern void mdct_init_sse3(struct A52Context *ctx);
 #endif
+
+#ifdef HAVE_AVX2
+extern void mdct_init_avx2(struct A52Context *ctx);
+#endif
+#else
+#ifdef HAVE_SSE2
+extern void mdct_init_sse2_pd(struct A52Context *ctx);
+#endif
+
+#ifdef HAVE_AVX
+extern void mdct_init_avx_pd(struct A52Context *ctx);
 #endif
+#endif /* CONFIG_DOUBLE */
 
 #endif /* X86_MDCT_H */
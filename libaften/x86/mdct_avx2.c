@@ -0,0 +1,892 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * AVX2 MDCT functions
+ * This file is derived from libvorbis lancer patch
+ * Copyright (c) 2006-2007 prakash@punnoor.de
+ * Copyright (c) 2006, blacksword8192@hotmail.com
+ * Copyright (c) 2002, Xiph.org Foundation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the Xiph.org Foundation nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file x86/mdct_avx2.c
+ * MDCT file, optimized for the AVX2 and FMA instruction sets
+ *
+ * The loops work on two iterations of the SSE versions at once, one in each
+ * 128-bit lane.  The twiddle factors are rearranged from the SSE tables, so
+ * that a single load gives both lanes their factors.
+ */
+
+#include "a52enc.h"
+#include "x86/simd_support.h"
+#include "mdct_common_sse.h"
+
+
+/* lane 0 takes the first and third, lane 1 the second and fourth quarter */
+static const int perm_lanes[16] = {  0,  1,  2,  3,  8,  9, 10, 11,
+                                     4,  5,  6,  7, 12, 13, 14, 15 };
+/* mdct_butterfly_first_sse3 stores its upper half first */
+static const int perm_first[16] = { 12, 13, 14, 15,  8,  9, 10, 11,
+                                     4,  5,  6,  7,  0,  1,  2,  3 };
+/* two iterations of the rotation loop, 16 factors each */
+static const int perm_rotate[32] = {  0,  1,  2,  3, 16, 17, 18, 19,
+                                      4,  5,  6,  7, 20, 21, 22, 23,
+                                      8,  9, 10, 11, 24, 25, 26, 27,
+                                     12, 13, 14, 15, 28, 29, 30, 31 };
+
+
+static void
+permute_trig(FLOAT *dst, const FLOAT *src, int len, const int *perm, int block)
+{
+    int i, j;
+
+    for (i = 0; i < len; i += block)
+        for (j = 0; j < block; j++)
+            dst[i+j] = src[i+perm[j]];
+}
+
+/** reverses all 8 elements */
+static inline __m256
+mm256_reverse_ps(__m256 x)
+{
+    return _mm256_permutevar8x32_ps(x, _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+/**
+ * Butterfly stage shared by the first and the generic butterflies, which
+ * only differ in the layout of their twiddle factors.
+ */
+static inline void
+mdct_butterfly_avx2(const FLOAT *T, FLOAT *x, int points)
+{
+    float *x1 = x +  points     - 8;
+    float *x2 = x + (points>>1) - 8;
+
+    do {
+        __m256 YMM0, YMM1, YMM2;
+        YMM0     = _mm256_loadu_ps(x1);
+        YMM1     = _mm256_loadu_ps(x2);
+        YMM2     = _mm256_sub_ps(YMM0, YMM1);
+        YMM0     = _mm256_add_ps(YMM0, YMM1);
+        _mm256_storeu_ps(x1, YMM0);
+
+        YMM1     = _mm256_mul_ps(_mm256_moveldup_ps(YMM2), _mm256_loadu_ps(T+8));
+        YMM2     = _mm256_fmadd_ps(_mm256_movehdup_ps(YMM2), _mm256_loadu_ps(T), YMM1);
+        _mm256_storeu_ps(x2, YMM2);
+        T   += 16;
+        x1  -= 8;
+        x2  -= 8;
+    } while (x2 >= x);
+}
+
+/** N point first stage butterfly */
+static void
+mdct_butterfly_first_avx2(FLOAT *trig, FLOAT *x, int points)
+{
+    mdct_butterfly_avx2(trig, x, points);
+}
+
+/** N/stage point generic N stage butterfly */
+static void
+mdct_butterfly_generic_avx2(MDCTContext *mdct, FLOAT *x, int points, int trigint)
+{
+    switch (trigint) {
+    case  8:
+        mdct_butterfly_avx2(mdct->trig_butterfly_generic8_avx2, x, points);
+        break;
+    case 16:
+        mdct_butterfly_avx2(mdct->trig_butterfly_generic16_avx2, x, points);
+        break;
+    default:
+        // not reached for the transform sizes of A/52
+        mdct_butterfly_generic_sse3(mdct, x, points, trigint);
+        break;
+    }
+}
+
+static void
+mdct_butterflies_avx2(MDCTContext *mdct, FLOAT *x, int points)
+{
+    FLOAT *trig = mdct->trig_butterfly_first_avx2;
+    int stages = mdct->log2n-5;
+    int i, j;
+
+    if (--stages > 0)
+        mdct->mdct_butterfly_first(trig, x, points);
+
+    for (i = 1; --stages > 0; i++)
+        for (j = 0; j < (1<<i); j++)
+            mdct->mdct_butterfly_generic(mdct, x+(points>>i)*j, points>>i, 4<<i);
+
+    for (j = 0; j < points; j += 32)
+        mdct->mdct_butterfly_32(x+j);
+}
+
+static void
+mdct_bitreverse_avx2(MDCTContext *mdct, FLOAT *x)
+{
+    const __m256 PCS_RNRN = _mm256_castsi256_ps(_mm256_set_epi32(
+                            0x80000000, 0, 0x80000000, 0, 0x80000000, 0, 0x80000000, 0));
+    const __m256 PFV_0P5  = _mm256_set1_ps(0.5f);
+    int        n   = mdct->n;
+    int       *bit = mdct->bitrev;
+    float *w0      = x;
+    float *w1      = x = w0+(n>>1);
+    float *T       = mdct->trig_bitreverse_avx2;
+
+    do {
+        __m128d XMM0, XMM1;
+        __m256  YMM0, YMM1, YMM2, YMM3, YMM4, YMM5;
+        w1       -= 8;
+
+        // complex pairs x0/x2 and x1/x3 of both iterations
+        XMM0     = _mm_loadh_pd(_mm_load_sd((double *)(x+bit[0])), (double *)(x+bit[2]));
+        XMM1     = _mm_loadh_pd(_mm_load_sd((double *)(x+bit[4])), (double *)(x+bit[6]));
+        YMM0     = _mm256_castpd_ps(_mm256_insertf128_pd(_mm256_castpd128_pd256(XMM0), XMM1, 1));
+        XMM0     = _mm_loadh_pd(_mm_load_sd((double *)(x+bit[1])), (double *)(x+bit[3]));
+        XMM1     = _mm_loadh_pd(_mm_load_sd((double *)(x+bit[5])), (double *)(x+bit[7]));
+        YMM1     = _mm256_castpd_ps(_mm256_insertf128_pd(_mm256_castpd128_pd256(XMM0), XMM1, 1));
+
+        YMM2     = _mm256_add_ps(_mm256_moveldup_ps(YMM0), _mm256_moveldup_ps(YMM1));
+        YMM3     = _mm256_sub_ps(_mm256_movehdup_ps(YMM0), _mm256_movehdup_ps(YMM1));
+        YMM0     = _mm256_shuffle_ps(YMM0, YMM0, _MM_SHUFFLE(2,3,0,1));
+        YMM1     = _mm256_shuffle_ps(YMM1, YMM1, _MM_SHUFFLE(2,3,0,1));
+        YMM1     = _mm256_xor_ps(YMM1, PCS_RNRN);
+        YMM0     = _mm256_add_ps(YMM0, YMM1);
+        YMM0     = _mm256_mul_ps(YMM0, PFV_0P5);
+
+        YMM3     = _mm256_mul_ps(YMM3, _mm256_loadu_ps(T+8));
+        YMM2     = _mm256_fmadd_ps(YMM2, _mm256_loadu_ps(T), YMM3);
+
+        YMM4     = _mm256_add_ps(YMM0, YMM2);
+        YMM5     = _mm256_addsub_ps(_mm256_xor_ps(YMM0, PCS_RNRN), YMM2);
+        // the second iteration goes below the first one, pairs swapped
+        YMM5     = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(YMM5), _MM_SHUFFLE(0,1,2,3)));
+
+        _mm256_storeu_ps(w0, YMM4);
+        _mm256_storeu_ps(w1, YMM5);
+
+        T       += 16;
+        bit     += 8;
+        w0      += 8;
+    } while (w0 < w1);
+}
+
+/** loads 8 input samples at p, applies the window and the sign mask */
+static inline __m256
+load_windowed(const FLOAT *p, const FLOAT *w, __m256 neg)
+{
+    return _mm256_xor_ps(_mm256_mul_ps(_mm256_loadu_ps(p), _mm256_loadu_ps(w)), neg);
+}
+
+/** see mdct_pretwiddle_sse */
+static void
+mdct_pretwiddle_avx2(MDCTContext *mdct, FLOAT *w2, const FLOAT *const *x,
+                     const FLOAT *const *xw, int neg)
+{
+    const __m256 PCS_RRRR = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
+    int n = mdct->n;
+    int n2 = n>>1;
+    int n4 = n>>2;
+    int n8 = n>>3;
+    const float *x0 = x[2]+n4-8;
+    const float *w0 = xw[2]+n4-8;
+    const float *x1 = x[3];
+    const float *w1 = xw[3];
+    const float *T  = mdct->trig_forward_avx2;
+    __m256 ng[4];
+    int i, j;
+
+    for (i = 0; i < 4; i++)
+        ng[i] = (neg >> i) & 1 ? PCS_RRRR : _mm256_setzero_ps();
+
+    for (i = 0, j = n2-2; i < n8; i += 4, j -= 4) {
+        __m128  XMM0, XMM1;
+        __m256  YMM0, YMM1;
+        YMM0     = mm256_reverse_ps(load_windowed(x0, w0, ng[2]));
+        YMM0     = _mm256_add_ps(YMM0, load_windowed(x1, w1, ng[3]));
+        YMM1     = _mm256_shuffle_ps(YMM0, YMM0, _MM_SHUFFLE(2,2,1,1));
+        YMM0     = _mm256_shuffle_ps(YMM0, YMM0, _MM_SHUFFLE(0,0,3,3));
+        YMM1     = _mm256_mul_ps(YMM1, _mm256_loadu_ps(T+8));
+        YMM0     = _mm256_fmsub_ps(YMM0, _mm256_loadu_ps(T), YMM1);
+        XMM0     = _mm256_castps256_ps128(YMM0);
+        XMM1     = _mm256_extractf128_ps(YMM0, 1);
+        _mm_storeu_ps(w2+i  , _mm_movelh_ps(XMM0, XMM1));
+        _mm_storeu_ps(w2+j-2, _mm_movehl_ps(XMM0, XMM1));
+        x0  -= 8;
+        w0  -= 8;
+        x1  += 8;
+        w1  += 8;
+        T   += 16;
+    }
+
+    x0   = x[0];
+    w0   = xw[0];
+    x1   = x[1]+n4-8;
+    w1   = xw[1]+n4-8;
+
+    for (; i < n4; i += 4, j -= 4) {
+        __m128  XMM0, XMM1;
+        __m256  YMM0, YMM1;
+        YMM1     = mm256_reverse_ps(load_windowed(x1, w1, ng[1]));
+        YMM0     = _mm256_sub_ps(load_windowed(x0, w0, ng[0]), YMM1);
+        YMM1     = _mm256_shuffle_ps(YMM0, YMM0, _MM_SHUFFLE(2,2,1,1));
+        YMM0     = _mm256_shuffle_ps(YMM0, YMM0, _MM_SHUFFLE(0,0,3,3));
+        YMM1     = _mm256_mul_ps(YMM1, _mm256_loadu_ps(T+8));
+        YMM0     = _mm256_fmadd_ps(YMM0, _mm256_loadu_ps(T), YMM1);
+        XMM0     = _mm256_castps256_ps128(YMM0);
+        XMM1     = _mm256_extractf128_ps(YMM0, 1);
+        _mm_storeu_ps(w2+i  , _mm_movelh_ps(XMM0, XMM1));
+        _mm_storeu_ps(w2+j-2, _mm_movehl_ps(XMM0, XMM1));
+        x0  += 8;
+        w0  += 8;
+        x1  -= 8;
+        w1  -= 8;
+        T   += 16;
+    }
+}
+
+/**
+ * Two steps of the post-rotation: 8 coefficients from the front and,
+ * in *back, the 8 mirrored ones from the back of the output.
+ */
+static inline void
+mdct_rotate_avx2(const FLOAT *T, const FLOAT *w, __m256 *back, __m256 *front)
+{
+    __m256  YMM0, YMM1, YMM2, YMM3;
+    YMM0     = _mm256_loadu_ps(w  );
+    YMM1     = _mm256_loadu_ps(w+8);
+    YMM2     = _mm256_permute2f128_ps(YMM0, YMM1, 0x31);
+    YMM3     = _mm256_permute2f128_ps(YMM0, YMM1, 0x20);
+    YMM0     = _mm256_shuffle_ps(YMM2, YMM3, _MM_SHUFFLE(0,2,0,2));
+    YMM1     = _mm256_shuffle_ps(YMM2, YMM3, _MM_SHUFFLE(1,3,1,3));
+
+    YMM2     = _mm256_mul_ps(YMM1, _mm256_loadu_ps(T+8));
+    YMM2     = _mm256_fmsub_ps(YMM0, _mm256_loadu_ps(T), YMM2);
+    // the second iteration goes below the first one
+    *back    = _mm256_permute2f128_ps(YMM2, YMM2, 0x01);
+
+    YMM0     = _mm256_shuffle_ps(YMM0, YMM0, _MM_SHUFFLE(0,1,2,3));
+    YMM1     = _mm256_shuffle_ps(YMM1, YMM1, _MM_SHUFFLE(0,1,2,3));
+    YMM1     = _mm256_mul_ps(YMM1, _mm256_loadu_ps(T+24));
+    *front   = _mm256_fmadd_ps(YMM0, _mm256_loadu_ps(T+16), YMM1);
+}
+
+static void
+mdct_avx2(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
+{
+    MDCTContext *mdct = tmdct->mdct;
+    int n = mdct->n;
+    int n2 = n>>1;
+    int n4 = n>>2;
+    FLOAT *w = tmdct->buffer;
+    FLOAT *win = mdct->window;
+    const FLOAT *x[4]  = { in, in+n4, in+n2, in+n2+n4 };
+    const FLOAT *xw[4] = { win, win+n4, win+n2, win+n2+n4 };
+    float *x0;
+    float *T;
+    int i;
+
+    mdct_pretwiddle_avx2(mdct, w+n2, x, xw, 0);
+    mdct_butterflies_avx2(mdct, w+n2, n2);
+    mdct->mdct_bitreverse(mdct, w);
+
+    /* rotate + window */
+
+    T    = mdct->trig_forward_avx2+n;
+    x0    =out +n2;
+
+    for (i = 0; i < n4; i += 8) {
+        __m256  YMM0, YMM2;
+        x0  -= 8;
+        mdct_rotate_avx2(T, w, &YMM2, &YMM0);
+        _mm256_storeu_ps(x0, YMM2);
+        _mm256_storeu_ps(out+i, YMM0);
+        w   += 16;
+        T   += 32;
+    }
+}
+
+static void
+mdct_512_avx2(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
+{
+    mdct_avx2(tmdct, out, in);
+}
+
+/** interleaves a and b into 16 consecutive FLOATs at out */
+static inline void
+store_interleaved(FLOAT *out, __m256 a, __m256 b)
+{
+    __m256 YMM0 = _mm256_unpacklo_ps(a, b);
+    __m256 YMM1 = _mm256_unpackhi_ps(a, b);
+    _mm256_storeu_ps(out  , _mm256_permute2f128_ps(YMM0, YMM1, 0x20));
+    _mm256_storeu_ps(out+8, _mm256_permute2f128_ps(YMM0, YMM1, 0x31));
+}
+
+/** both short block transforms in one go, see mdct_256_sse */
+static void
+mdct_256_avx2(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
+{
+    MDCTContext *mdct = tmdct->mdct;
+    FLOAT *wa = tmdct->buffer;
+    FLOAT *wb = tmdct->buffer1;
+    const FLOAT *win = a52_window;
+    const FLOAT *xa[4]  = { in+64,  in+128,  in+192,  in      };
+    const FLOAT *xwa[4] = { win+64, win+128, win+192, win     };
+    const FLOAT *xb[4]  = { in+448, in+256,  in+320,  in+384  };
+    const FLOAT *xwb[4] = { win+448, win+256, win+320, win+384 };
+    float *T, *x0;
+    int i;
+
+    mdct_pretwiddle_avx2(mdct, wa+128, xa, xwa, 0x8);
+    mdct_pretwiddle_avx2(mdct, wb+128, xb, xwb, 0x9);
+    mdct_butterflies_avx2(mdct, wa+128, 128);
+    mdct_butterflies_avx2(mdct, wb+128, 128);
+    mdct->mdct_bitreverse(mdct, wa);
+    mdct->mdct_bitreverse(mdct, wb);
+
+    T    = mdct->trig_forward_avx2+256;
+    x0   = out+256;
+
+    for (i = 0; i < 128; i += 16) {
+        __m256  YMM0, YMM1, YMM2, YMM3;
+        x0  -= 16;
+        mdct_rotate_avx2(T, wa, &YMM0, &YMM2);
+        mdct_rotate_avx2(T, wb, &YMM1, &YMM3);
+        store_interleaved(x0, YMM0, YMM1);
+        store_interleaved(out+i, YMM2, YMM3);
+        wa  += 16;
+        wb  += 16;
+        T   += 32;
+    }
+}
+
+/*
+ * Batched transform
+ *
+ * Up to 8 windows are transposed, so that row k of the scratch buffer holds
+ * sample k of every window, one window per lane.  The scalar algorithm of
+ * mdct.c then runs unchanged on whole rows: the twiddle factors are
+ * broadcast, and the bit-reverse permutation only picks rows, so nothing is
+ * shuffled between the transposes at the start and the end.  Each twiddle
+ * factor is loaded once for all windows.
+ */
+
+#define ROW(x, i) ((x) + 8*(i))
+
+static inline __m256
+ld_row(const FLOAT *x, int i)
+{
+    return _mm256_load_ps(ROW(x, i));
+}
+
+static inline void
+st_row(FLOAT *x, int i, __m256 v)
+{
+    _mm256_store_ps(ROW(x, i), v);
+}
+
+/**
+ * Loads rows i+odd and i+odd+2 of the 8 windows and applies the window.
+ * Every iteration of the pre-twiddle reads exactly such a pair, so the
+ * input is transposed on the fly and never stored.
+ */
+static inline void
+load_row_pair(const FLOAT **src, const FLOAT *win, int i, int odd,
+              __m256 *r0, __m256 *r1)
+{
+    __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src[0]+i)), _mm_loadu_ps(src[4]+i), 1);
+    __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src[1]+i)), _mm_loadu_ps(src[5]+i), 1);
+    __m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src[2]+i)), _mm_loadu_ps(src[6]+i), 1);
+    __m256 d = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src[3]+i)), _mm_loadu_ps(src[7]+i), 1);
+    __m256 ab, cd;
+
+    if (odd) {
+        ab = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+        cd = _mm256_shuffle_ps(c, d, _MM_SHUFFLE(3,1,3,1));
+    } else {
+        ab = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+        cd = _mm256_shuffle_ps(c, d, _MM_SHUFFLE(2,0,2,0));
+    }
+    // a row is one sample of every window, so its window value is the same
+    // in all lanes
+    *r0 = _mm256_mul_ps(_mm256_shuffle_ps(ab, cd, _MM_SHUFFLE(2,0,2,0)),
+                        _mm256_broadcast_ss(&win[i+odd]));
+    *r1 = _mm256_mul_ps(_mm256_shuffle_ps(ab, cd, _MM_SHUFFLE(3,1,3,1)),
+                        _mm256_broadcast_ss(&win[i+odd+2]));
+}
+
+/**
+ * Transposes the 4x4 blocks within each 128-bit lane: afterwards r[k] holds
+ * 4 consecutive samples of window k in the low and window k+4 in the high
+ * lane.
+ */
+static inline void
+transpose_4x4_lanes(__m256 *r)
+{
+    __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+    __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+
+    r[0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1,0,1,0));
+    r[1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3,2,3,2));
+    r[2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1,0,1,0));
+    r[3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3,2,3,2));
+}
+
+/** stores rows i..i+7, given in r[0..7], to the count output windows */
+static inline void
+store_rows(FLOAT **out, int count, int i, __m256 *r)
+{
+    int j;
+
+    transpose_4x4_lanes(r);
+    transpose_4x4_lanes(r+4);
+    for (j = 0; j < 4 && j < count; j++) {
+        _mm_storeu_ps(out[j]+i  , _mm256_castps256_ps128(r[j]));
+        _mm_storeu_ps(out[j]+i+4, _mm256_castps256_ps128(r[j+4]));
+    }
+    for (j = 4; j < count; j++) {
+        _mm_storeu_ps(out[j]+i  , _mm256_extractf128_ps(r[j-4], 1));
+        _mm_storeu_ps(out[j]+i+4, _mm256_extractf128_ps(r[j], 1));
+    }
+}
+
+/** rows i and i+1 = (r0, r1) rotated by the twiddle factor at trig */
+static inline void
+rotate_rows(FLOAT *x, int i, __m256 r0, __m256 r1, const FLOAT *trig)
+{
+    __m256 t0 = _mm256_broadcast_ss(&trig[0]);
+    __m256 t1 = _mm256_broadcast_ss(&trig[1]);
+
+    st_row(x, i  , _mm256_fmadd_ps(r1, t1, _mm256_mul_ps(r0, t0)));
+    st_row(x, i+1, _mm256_fmsub_ps(r1, t0, _mm256_mul_ps(r0, t1)));
+}
+
+static inline void
+mdct_butterfly_8_soa(__m256 *x)
+{
+    __m256 r0 = _mm256_add_ps(x[6], x[2]);
+    __m256 r1 = _mm256_sub_ps(x[6], x[2]);
+    __m256 r2 = _mm256_add_ps(x[4], x[0]);
+    __m256 r3 = _mm256_sub_ps(x[4], x[0]);
+    __m256 r4 = _mm256_sub_ps(x[5], x[1]);
+    __m256 r5 = _mm256_sub_ps(x[7], x[3]);
+    __m256 r6 = _mm256_add_ps(x[5], x[1]);
+    __m256 r7 = _mm256_add_ps(x[7], x[3]);
+
+    x[6] = _mm256_add_ps(r0, r2);
+    x[4] = _mm256_sub_ps(r0, r2);
+    x[0] = _mm256_add_ps(r1, r4);
+    x[2] = _mm256_sub_ps(r1, r4);
+    x[3] = _mm256_add_ps(r5, r3);
+    x[1] = _mm256_sub_ps(r5, r3);
+    x[7] = _mm256_add_ps(r7, r6);
+    x[5] = _mm256_sub_ps(r7, r6);
+}
+
+static inline void
+mdct_butterfly_16_soa(__m256 *x)
+{
+    const __m256 pi2_8 = _mm256_set1_ps(AFT_PI2_8);
+    __m256 r0, r1;
+
+    r0    = _mm256_sub_ps(x[1], x[9]);
+    r1    = _mm256_sub_ps(x[0], x[8]);
+    x[8]  = _mm256_add_ps(x[8], x[0]);
+    x[9]  = _mm256_add_ps(x[9], x[1]);
+    x[0]  = _mm256_mul_ps(_mm256_add_ps(r0, r1), pi2_8);
+    x[1]  = _mm256_mul_ps(_mm256_sub_ps(r0, r1), pi2_8);
+
+    r0    = _mm256_sub_ps(x[3], x[11]);
+    r1    = _mm256_sub_ps(x[10], x[2]);
+    x[10] = _mm256_add_ps(x[10], x[2]);
+    x[11] = _mm256_add_ps(x[11], x[3]);
+    x[2]  = r0;
+    x[3]  = r1;
+
+    r0    = _mm256_sub_ps(x[12], x[4]);
+    r1    = _mm256_sub_ps(x[13], x[5]);
+    x[12] = _mm256_add_ps(x[12], x[4]);
+    x[13] = _mm256_add_ps(x[13], x[5]);
+    x[4]  = _mm256_mul_ps(_mm256_sub_ps(r0, r1), pi2_8);
+    x[5]  = _mm256_mul_ps(_mm256_add_ps(r0, r1), pi2_8);
+
+    r0    = _mm256_sub_ps(x[14], x[6]);
+    r1    = _mm256_sub_ps(x[15], x[7]);
+    x[14] = _mm256_add_ps(x[14], x[6]);
+    x[15] = _mm256_add_ps(x[15], x[7]);
+    x[6]  = r0;
+    x[7]  = r1;
+
+    mdct_butterfly_8_soa(x);
+    mdct_butterfly_8_soa(x+8);
+}
+
+/** 32 point butterfly on rows 0..31 of x */
+static void
+mdct_butterfly_32_soa(FLOAT *x)
+{
+    const __m256 pi1_8 = _mm256_set1_ps(AFT_PI1_8);
+    const __m256 pi2_8 = _mm256_set1_ps(AFT_PI2_8);
+    const __m256 pi3_8 = _mm256_set1_ps(AFT_PI3_8);
+    __m256 v[32];
+    __m256 r0, r1;
+    int i;
+
+    for (i = 0; i < 32; i++)
+        v[i] = ld_row(x, i);
+
+    r0    = _mm256_sub_ps(v[30], v[14]);
+    r1    = _mm256_sub_ps(v[31], v[15]);
+    v[30] = _mm256_add_ps(v[30], v[14]);
+    v[31] = _mm256_add_ps(v[31], v[15]);
+    v[14] = r0;
+    v[15] = r1;
+
+    r0    = _mm256_sub_ps(v[28], v[12]);
+    r1    = _mm256_sub_ps(v[29], v[13]);
+    v[28] = _mm256_add_ps(v[28], v[12]);
+    v[29] = _mm256_add_ps(v[29], v[13]);
+    v[12] = _mm256_fmsub_ps(r0, pi1_8, _mm256_mul_ps(r1, pi3_8));
+    v[13] = _mm256_fmadd_ps(r0, pi3_8, _mm256_mul_ps(r1, pi1_8));
+
+    r0    = _mm256_sub_ps(v[26], v[10]);
+    r1    = _mm256_sub_ps(v[27], v[11]);
+    v[26] = _mm256_add_ps(v[26], v[10]);
+    v[27] = _mm256_add_ps(v[27], v[11]);
+    v[10] = _mm256_mul_ps(_mm256_sub_ps(r0, r1), pi2_8);
+    v[11] = _mm256_mul_ps(_mm256_add_ps(r0, r1), pi2_8);
+
+    r0    = _mm256_sub_ps(v[24], v[8]);
+    r1    = _mm256_sub_ps(v[25], v[9]);
+    v[24] = _mm256_add_ps(v[24], v[8]);
+    v[25] = _mm256_add_ps(v[25], v[9]);
+    v[8]  = _mm256_fmsub_ps(r0, pi3_8, _mm256_mul_ps(r1, pi1_8));
+    v[9]  = _mm256_fmadd_ps(r1, pi3_8, _mm256_mul_ps(r0, pi1_8));
+
+    r0    = _mm256_sub_ps(v[22], v[6]);
+    r1    = _mm256_sub_ps(v[7], v[23]);
+    v[22] = _mm256_add_ps(v[22], v[6]);
+    v[23] = _mm256_add_ps(v[23], v[7]);
+    v[6]  = r1;
+    v[7]  = r0;
+
+    r0    = _mm256_sub_ps(v[4], v[20]);
+    r1    = _mm256_sub_ps(v[5], v[21]);
+    v[20] = _mm256_add_ps(v[20], v[4]);
+    v[21] = _mm256_add_ps(v[21], v[5]);
+    v[4]  = _mm256_fmadd_ps(r1, pi1_8, _mm256_mul_ps(r0, pi3_8));
+    v[5]  = _mm256_fmsub_ps(r1, pi3_8, _mm256_mul_ps(r0, pi1_8));
+
+    r0    = _mm256_sub_ps(v[2], v[18]);
+    r1    = _mm256_sub_ps(v[3], v[19]);
+    v[18] = _mm256_add_ps(v[18], v[2]);
+    v[19] = _mm256_add_ps(v[19], v[3]);
+    v[2]  = _mm256_mul_ps(_mm256_add_ps(r1, r0), pi2_8);
+    v[3]  = _mm256_mul_ps(_mm256_sub_ps(r1, r0), pi2_8);
+
+    r0    = _mm256_sub_ps(v[0], v[16]);
+    r1    = _mm256_sub_ps(v[1], v[17]);
+    v[16] = _mm256_add_ps(v[16], v[0]);
+    v[17] = _mm256_add_ps(v[17], v[1]);
+    v[0]  = _mm256_fmadd_ps(r1, pi3_8, _mm256_mul_ps(r0, pi1_8));
+    v[1]  = _mm256_fmsub_ps(r1, pi1_8, _mm256_mul_ps(r0, pi3_8));
+
+    mdct_butterfly_16_soa(v);
+    mdct_butterfly_16_soa(v+16);
+
+    for (i = 0; i < 32; i++)
+        st_row(x, i, v[i]);
+}
+
+/**
+ * Generic butterfly stage on rows.  The first stage is the same with a
+ * trigint of 4.
+ */
+static void
+mdct_butterfly_generic_soa(const FLOAT *trig, FLOAT *x, int points, int trigint)
+{
+    FLOAT *x1 = ROW(x,  points     - 8);
+    FLOAT *x2 = ROW(x, (points>>1) - 8);
+    int i;
+
+    do {
+        for (i = 6; i >= 0; i -= 2) {
+            __m256 a0 = ld_row(x1, i  );
+            __m256 a1 = ld_row(x1, i+1);
+            __m256 b0 = ld_row(x2, i  );
+            __m256 b1 = ld_row(x2, i+1);
+            st_row(x1, i  , _mm256_add_ps(a0, b0));
+            st_row(x1, i+1, _mm256_add_ps(a1, b1));
+            rotate_rows(x2, i, _mm256_sub_ps(a0, b0), _mm256_sub_ps(a1, b1), trig);
+            trig += trigint;
+        }
+        x1 = ROW(x1, -8);
+        x2 = ROW(x2, -8);
+    } while (x2 >= x);
+}
+
+static void
+mdct_butterflies_soa(MDCTContext *mdct, FLOAT *x, int points)
+{
+    FLOAT *trig = mdct->trig;
+    int stages = mdct->log2n-5;
+    int i, j;
+
+    if (--stages > 0)
+        mdct_butterfly_generic_soa(trig, x, points, 4);
+
+    for (i = 1; --stages > 0; i++)
+        for (j = 0; j < (1<<i); j++)
+            mdct_butterfly_generic_soa(trig, ROW(x, (points>>i)*j), points>>i, 4<<i);
+
+    for (j = 0; j < points; j += 32)
+        mdct_butterfly_32_soa(ROW(x, j));
+}
+
+static void
+mdct_bitreverse_soa(MDCTContext *mdct, FLOAT *w)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    int n = mdct->n;
+    int *bit = mdct->bitrev;
+    FLOAT *x = ROW(w, n>>1);
+    FLOAT *trig = mdct->trig+n;
+    int w0 = 0;
+    int w1 = n>>1;
+
+    do {
+        __m256 x0r, x0i, x1r, x1i, r0, r1, r2, r3, t0, t1;
+
+        w1 -= 4;
+
+        x0r = ld_row(x, bit[0]);
+        x0i = ld_row(x, bit[0]+1);
+        x1r = ld_row(x, bit[1]);
+        x1i = ld_row(x, bit[1]+1);
+        t0  = _mm256_broadcast_ss(&trig[0]);
+        t1  = _mm256_broadcast_ss(&trig[1]);
+        r0  = _mm256_sub_ps(x0i, x1i);
+        r1  = _mm256_add_ps(x0r, x1r);
+        r2  = _mm256_fmadd_ps(r1, t0, _mm256_mul_ps(r0, t1));
+        r3  = _mm256_fmsub_ps(r1, t1, _mm256_mul_ps(r0, t0));
+        r0  = _mm256_mul_ps(_mm256_add_ps(x0i, x1i), half);
+        r1  = _mm256_mul_ps(_mm256_sub_ps(x0r, x1r), half);
+        st_row(w, w0  , _mm256_add_ps(r0, r2));
+        st_row(w, w1+2, _mm256_sub_ps(r0, r2));
+        st_row(w, w0+1, _mm256_add_ps(r1, r3));
+        st_row(w, w1+3, _mm256_sub_ps(r3, r1));
+
+        x0r = ld_row(x, bit[2]);
+        x0i = ld_row(x, bit[2]+1);
+        x1r = ld_row(x, bit[3]);
+        x1i = ld_row(x, bit[3]+1);
+        t0  = _mm256_broadcast_ss(&trig[2]);
+        t1  = _mm256_broadcast_ss(&trig[3]);
+        r0  = _mm256_sub_ps(x0i, x1i);
+        r1  = _mm256_add_ps(x0r, x1r);
+        r2  = _mm256_fmadd_ps(r1, t0, _mm256_mul_ps(r0, t1));
+        r3  = _mm256_fmsub_ps(r1, t1, _mm256_mul_ps(r0, t0));
+        r0  = _mm256_mul_ps(_mm256_add_ps(x0i, x1i), half);
+        r1  = _mm256_mul_ps(_mm256_sub_ps(x0r, x1r), half);
+        st_row(w, w0+2, _mm256_add_ps(r0, r2));
+        st_row(w, w1  , _mm256_sub_ps(r0, r2));
+        st_row(w, w0+3, _mm256_add_ps(r1, r3));
+        st_row(w, w1+1, _mm256_sub_ps(r3, r1));
+
+        trig += 4;
+        bit  += 4;
+        w0   += 4;
+    } while (w0 < w1);
+}
+
+static void
+mdct_batch_avx2(MDCTThreadContext *tmdct, FLOAT **out, FLOAT **in, int count,
+                int ncoefs)
+{
+    MDCTContext *mdct = tmdct->mdct;
+    int n = mdct->n;
+    int n2 = n>>1;
+    int n4 = n>>2;
+    int n8 = n>>3;
+    FLOAT *w = (FLOAT *)(((uintptr_t)tmdct->batch_buffer + 31) & ~(uintptr_t)31);
+    FLOAT *w2 = ROW(w, n2);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 scale = _mm256_set1_ps(mdct->scale);
+    const FLOAT *win = mdct->window;
+    const FLOAT *src[8];
+    FLOAT *trig;
+    __m256 a0, a2, b0, b2, r[8];
+    int i, j, x0, x1;
+
+    // unused lanes just repeat the first window
+    for (j = 0; j < 8; j++)
+        src[j] = in[j < count ? j : 0];
+
+    x0 = n2+n4;
+    x1 = x0+1;
+    trig = mdct->trig + n2;
+    for (i = 0; i < n8; i += 2) {
+        x0 -= 4;
+        trig -= 2;
+        load_row_pair(src, win, x0, 0, &a0, &a2);
+        load_row_pair(src, win, x1-1, 1, &b0, &b2);
+        rotate_rows(w2, i, _mm256_add_ps(a2, b0), _mm256_add_ps(a0, b2), trig);
+        x1 += 4;
+    }
+
+    x1 = 1;
+    for (; i < n2-n8; i += 2) {
+        trig -= 2;
+        x0 -= 4;
+        load_row_pair(src, win, x0, 0, &a0, &a2);
+        load_row_pair(src, win, x1-1, 1, &b0, &b2);
+        rotate_rows(w2, i, _mm256_sub_ps(a2, b0), _mm256_sub_ps(a0, b2), trig);
+        x1 += 4;
+    }
+
+    x0 = n;
+    for (; i < n2; i += 2) {
+        trig -= 2;
+        x0 -= 4;
+        load_row_pair(src, win, x0, 0, &a0, &a2);
+        load_row_pair(src, win, x1-1, 1, &b0, &b2);
+        rotate_rows(w2, i, _mm256_sub_ps(_mm256_sub_ps(zero, a2), b0),
+                           _mm256_sub_ps(_mm256_sub_ps(zero, a0), b2), trig);
+        x1 += 4;
+    }
+
+    mdct_butterflies_soa(mdct, w2, n2);
+    mdct_bitreverse_soa(mdct, w);
+
+    // output rows i and n2-1-i come from the same work rows, so the rows
+    // are rotated and stored 8 at a time from both ends.  Blocks above the
+    // coded bandwidth are skipped.
+    for (i = 0; i < n4; i += 8) {
+        int front = i < ncoefs;
+        int back_needed = n2-8-i < ncoefs;
+        __m256 back[8];
+
+        if (!front && !back_needed)
+            continue;
+        trig = mdct->trig + n2 + 2*i;
+        for (j = 0; j < 8; j++) {
+            __m256 v0 = ld_row(w, 2*(i+j));
+            __m256 v1 = ld_row(w, 2*(i+j)+1);
+            __m256 t0 = _mm256_broadcast_ss(&trig[2*j]);
+            __m256 t1 = _mm256_broadcast_ss(&trig[2*j+1]);
+            r[j]      = _mm256_mul_ps(_mm256_fmadd_ps(v0, t0, _mm256_mul_ps(v1, t1)), scale);
+            back[7-j] = _mm256_mul_ps(_mm256_fmsub_ps(v0, t1, _mm256_mul_ps(v1, t0)), scale);
+        }
+        if (front)
+            store_rows(out, count, i, r);
+        if (back_needed)
+            store_rows(out, count, n2-8-i, back);
+    }
+}
+
+static void
+mdct_direct_avx2(MDCTContext *mdct, FLOAT *out, FLOAT *in, int ncoefs)
+{
+    FLOAT *trig = mdct->direct_trig;
+    int n = mdct->n;
+    __m256 acc0, acc1, acc2, acc3, acc4, acc5, acc6, acc7, h0, h1;
+    FLOAT sum[8];
+    int i, k;
+
+    acc0 = acc1 = acc2 = acc3 = acc4 = acc5 = acc6 = acc7 = _mm256_setzero_ps();
+
+    // every input vector is loaded once for all 8 coefficients
+    for (i = 0; i < n; i += 8) {
+        __m256 x = _mm256_loadu_ps(in + i);
+        acc0 = _mm256_fmadd_ps(x, _mm256_loadu_ps(trig +     i), acc0);
+        acc1 = _mm256_fmadd_ps(x, _mm256_loadu_ps(trig +   n+i), acc1);
+        acc2 = _mm256_fmadd_ps(x, _mm256_loadu_ps(trig + 2*n+i), acc2);
+        acc3 = _mm256_fmadd_ps(x, _mm256_loadu_ps(trig + 3*n+i), acc3);
+        acc4 = _mm256_fmadd_ps(x, _mm256_loadu_ps(trig + 4*n+i), acc4);
+        acc5 = _mm256_fmadd_ps(x, _mm256_loadu_ps(trig + 5*n+i), acc5);
+        acc6 = _mm256_fmadd_ps(x, _mm256_loadu_ps(trig + 6*n+i), acc6);
+        acc7 = _mm256_fmadd_ps(x, _mm256_loadu_ps(trig + 7*n+i), acc7);
+    }
+
+    h0 = _mm256_hadd_ps(_mm256_hadd_ps(acc0, acc1), _mm256_hadd_ps(acc2, acc3));
+    h1 = _mm256_hadd_ps(_mm256_hadd_ps(acc4, acc5), _mm256_hadd_ps(acc6, acc7));
+    _mm_storeu_ps(sum  , _mm_add_ps(_mm256_castps256_ps128(h0), _mm256_extractf128_ps(h0, 1)));
+    _mm_storeu_ps(sum+4, _mm_add_ps(_mm256_castps256_ps128(h1), _mm256_extractf128_ps(h1, 1)));
+    for (k = 0; k < ncoefs; k++)
+        out[k] = sum[k];
+}
+
+static void
+mdct_ctx_init_avx2(MDCTContext *mdct, int n)
+{
+    int n2 = n>>1;
+    int n4 = n>>2;
+
+    mdct_ctx_init_sse(mdct, n);
+
+    mdct->trig_bitreverse_avx2 = aligned_malloc(sizeof(FLOAT)*n2);
+    permute_trig(mdct->trig_bitreverse_avx2, mdct->trig_bitreverse, n2, perm_lanes, 16);
+
+    mdct->trig_forward_avx2 = aligned_malloc(sizeof(FLOAT)*n*2);
+    permute_trig(mdct->trig_forward_avx2, mdct->trig_forward, n, perm_lanes, 16);
+    permute_trig(mdct->trig_forward_avx2+n, mdct->trig_forward+n, n, perm_rotate, 32);
+
+    mdct->trig_butterfly_first_avx2 = aligned_malloc(sizeof(FLOAT)*n2);
+    permute_trig(mdct->trig_butterfly_first_avx2, mdct->trig_butterfly_first, n2, perm_first, 16);
+
+    mdct->trig_butterfly_generic8_avx2 = aligned_malloc(sizeof(FLOAT)*n2);
+    permute_trig(mdct->trig_butterfly_generic8_avx2, mdct->trig_butterfly_generic8, n2, perm_lanes, 16);
+
+    mdct->trig_butterfly_generic16_avx2 = aligned_malloc(sizeof(FLOAT)*n4);
+    permute_trig(mdct->trig_butterfly_generic16_avx2, mdct->trig_butterfly_generic16, n4, perm_lanes, 16);
+
+    mdct->mdct_direct = mdct_direct_avx2;
+    mdct->mdct_bitreverse = mdct_bitreverse_avx2;
+    mdct->mdct_butterfly_generic = mdct_butterfly_generic_avx2;
+    mdct->mdct_butterfly_first = mdct_butterfly_first_avx2;
+    mdct->mdct_butterfly_32 = mdct_butterfly_32_sse3;
+}
+
+void
+mdct_init_avx2(A52Context *ctx)
+{
+    mdct_ctx_init_avx2(&ctx->mdct_ctx_512, 512);
+    mdct_ctx_init_avx2(&ctx->mdct_ctx_256, 256);
+
+    ctx->mdct_ctx_512.mdct = mdct_512_avx2;
+    ctx->mdct_ctx_256.mdct = mdct_256_avx2;
+
+    ctx->mdct_ctx_512.mdct_batch = mdct_batch_avx2;
+    // 512 rows of 8, plus alignment
+    ctx->mdct_ctx_512.batch_buffer_size = 512 * 8 + 8;
+}
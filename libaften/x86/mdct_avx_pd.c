@@ -0,0 +1,94 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * This file is derived from libvorbis
+ * Copyright (c) 2002, Xiph.org Foundation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the Xiph.org Foundation nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file x86/mdct_avx_pd.c
+ * Double precision MDCT, optimized for the AVX instruction set
+ *
+ * Four windows are transformed at once, see mdct_common_pd.h.  The short
+ * block transforms stay with the SSE2 version, they only make a pair.
+ * No FMA is used, so the results match the C version.
+ */
+
+#include "a52enc.h"
+#include "x86/simd_support.h"
+
+#ifdef CONFIG_DOUBLE
+
+#define V           __m256d
+#define LANES       4
+#define V_ADD       _mm256_add_pd
+#define V_SUB       _mm256_sub_pd
+#define V_MUL       _mm256_mul_pd
+#define V_XOR       _mm256_xor_pd
+#define V_SET1      _mm256_set1_pd
+#define V_LOAD      _mm256_load_pd
+#define V_STORE     _mm256_store_pd
+#define V_ZERO      _mm256_setzero_pd()
+
+/** sample i of the window in each lane */
+static inline V
+load_lanes(const FLOAT *const *p, int i)
+{
+    return _mm256_set_pd(p[3][i], p[2][i], p[1][i], p[0][i]);
+}
+
+/** stores rows i..i+3, given in r[0..3], to the count output windows */
+static inline void
+store_rows(FLOAT **out, int count, int i, V *r)
+{
+    V t0 = _mm256_unpacklo_pd(r[0], r[1]);
+    V t1 = _mm256_unpackhi_pd(r[0], r[1]);
+    V t2 = _mm256_unpacklo_pd(r[2], r[3]);
+    V t3 = _mm256_unpackhi_pd(r[2], r[3]);
+
+    _mm256_storeu_pd(out[0]+i, _mm256_permute2f128_pd(t0, t2, 0x20));
+    if (count > 1)
+        _mm256_storeu_pd(out[1]+i, _mm256_permute2f128_pd(t1, t3, 0x20));
+    if (count > 2)
+        _mm256_storeu_pd(out[2]+i, _mm256_permute2f128_pd(t0, t2, 0x31));
+    if (count > 3)
+        _mm256_storeu_pd(out[3]+i, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+#include "mdct_common_pd.h"
+
+void
+mdct_init_avx_pd(A52Context *ctx)
+{
+    ctx->mdct_ctx_512.mdct_batch = mdct_batch_soa;
+    ctx->mdct_ctx_512.batch_buffer_size = SOA_BUFFER_SIZE(512);
+}
+
+#endif /* CONFIG_DOUBLE */
@@ -0,0 +1,457 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * This file is derived from libvorbis
+ * Copyright (c) 2002, Xiph.org Foundation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the Xiph.org Foundation nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file x86/mdct_common_pd.h
+ * Double precision MDCT on rows, shared by the SSE2 and AVX versions
+ *
+ * Several windows are transformed at once, one per lane, so row k of the
+ * work buffer holds sample k of every window.  The scalar algorithm of
+ * mdct.c runs on whole rows with the same operations in the same order, so
+ * the results are identical to the C version.
+ *
+ * The including file defines the vector type V, the number of LANES, the
+ * V_* operations, load_lanes() and store_rows().
+ */
+
+#ifndef MDCT_COMMON_PD_H
+#define MDCT_COMMON_PD_H
+
+#define ROW(x, i) ((x) + LANES*(i))
+
+/**
+ * Input of the transform in each lane.  Quarter q of lane l starts at
+ * x[q][l], its window at w[q][l], and neg[q] holds the sign bits it is
+ * flipped with.
+ */
+typedef struct SoaInput {
+    const FLOAT *x[4][LANES];
+    const FLOAT *w[4][LANES];
+    V neg[4];
+} SoaInput;
+
+static inline V
+ld_row(const FLOAT *x, int i)
+{
+    return V_LOAD(ROW(x, i));
+}
+
+static inline void
+st_row(FLOAT *x, int i, V v)
+{
+    V_STORE(ROW(x, i), v);
+}
+
+/** row i of quarter q, windowed and with the sign bits in neg flipped */
+static inline V
+load_input_row(const SoaInput *src, int q, int i, V neg)
+{
+    return V_XOR(V_MUL(load_lanes(src->x[q], i), load_lanes(src->w[q], i)), neg);
+}
+
+/** rows i and i+1 = (r0, r1) rotated by the twiddle factor at trig */
+static inline void
+rotate_rows(FLOAT *x, int i, V r0, V r1, const FLOAT *trig)
+{
+    V t0 = V_SET1(trig[0]);
+    V t1 = V_SET1(trig[1]);
+
+    st_row(x, i  , V_ADD(V_MUL(r1, t1), V_MUL(r0, t0)));
+    st_row(x, i+1, V_SUB(V_MUL(r1, t0), V_MUL(r0, t1)));
+}
+
+/** see mdct_pretwiddle_pairs in mdct.c */
+static inline void
+pretwiddle_pairs_soa(FLOAT *w2, const FLOAT *trig, int count, const SoaInput *src,
+                     int q0, int i0, V n0, int q1, int i1, V n1)
+{
+    int i;
+
+    for (i = 0; i < count; i += 2) {
+        V a0, a2, b0, b2;
+        i0 -= 4;
+        trig -= 2;
+        a2 = load_input_row(src, q0, i0+2, n0);
+        a0 = load_input_row(src, q0, i0  , n0);
+        b0 = load_input_row(src, q1, i1  , n1);
+        b2 = load_input_row(src, q1, i1+2, n1);
+        rotate_rows(w2, i, V_ADD(a2, b0), V_ADD(a0, b2), trig);
+        i1 += 4;
+    }
+}
+
+static void
+mdct_pretwiddle_soa(MDCTContext *mdct, FLOAT *w2, const SoaInput *src)
+{
+    const V sign = V_SET1(-0.0);
+    int n = mdct->n;
+    int n2 = n>>1;
+    int n4 = n>>2;
+    int n8 = n>>3;
+    FLOAT *trig = mdct->trig + n2;
+
+    pretwiddle_pairs_soa(w2, trig, n8, src,
+                         2, n4, src->neg[2], 3, 1, src->neg[3]);
+    pretwiddle_pairs_soa(ROW(w2, n8), trig-n8, n8, src,
+                         1, n4, src->neg[1], 0, 1, V_XOR(src->neg[0], sign));
+    pretwiddle_pairs_soa(ROW(w2, n4), trig-n4, n8, src,
+                         0, n4, src->neg[0], 1, 1, V_XOR(src->neg[1], sign));
+    pretwiddle_pairs_soa(ROW(w2, n4+n8), trig-n4-n8, n8, src,
+                         3, n4, V_XOR(src->neg[3], sign), 2, 1, V_XOR(src->neg[2], sign));
+}
+
+static inline void
+mdct_butterfly_8_soa(V *x)
+{
+    V r0 = V_ADD(x[6], x[2]);
+    V r1 = V_SUB(x[6], x[2]);
+    V r2 = V_ADD(x[4], x[0]);
+    V r3 = V_SUB(x[4], x[0]);
+
+    x[6] = V_ADD(r0, r2);
+    x[4] = V_SUB(r0, r2);
+
+    r0   = V_SUB(x[5], x[1]);
+    r2   = V_SUB(x[7], x[3]);
+    x[0] = V_ADD(r1, r0);
+    x[2] = V_SUB(r1, r0);
+
+    r0   = V_ADD(x[5], x[1]);
+    r1   = V_ADD(x[7], x[3]);
+    x[3] = V_ADD(r2, r3);
+    x[1] = V_SUB(r2, r3);
+    x[7] = V_ADD(r1, r0);
+    x[5] = V_SUB(r1, r0);
+}
+
+static inline void
+mdct_butterfly_16_soa(V *x)
+{
+    const V pi2_8 = V_SET1(AFT_PI2_8);
+    V r0 = V_SUB(x[1], x[9]);
+    V r1 = V_SUB(x[0], x[8]);
+
+    x[8]  = V_ADD(x[8], x[0]);
+    x[9]  = V_ADD(x[9], x[1]);
+    x[0]  = V_MUL(V_ADD(r0, r1), pi2_8);
+    x[1]  = V_MUL(V_SUB(r0, r1), pi2_8);
+
+    r0    = V_SUB(x[3], x[11]);
+    r1    = V_SUB(x[10], x[2]);
+    x[10] = V_ADD(x[10], x[2]);
+    x[11] = V_ADD(x[11], x[3]);
+    x[2]  = r0;
+    x[3]  = r1;
+
+    r0    = V_SUB(x[12], x[4]);
+    r1    = V_SUB(x[13], x[5]);
+    x[12] = V_ADD(x[12], x[4]);
+    x[13] = V_ADD(x[13], x[5]);
+    x[4]  = V_MUL(V_SUB(r0, r1), pi2_8);
+    x[5]  = V_MUL(V_ADD(r0, r1), pi2_8);
+
+    r0    = V_SUB(x[14], x[6]);
+    r1    = V_SUB(x[15], x[7]);
+    x[14] = V_ADD(x[14], x[6]);
+    x[15] = V_ADD(x[15], x[7]);
+    x[6]  = r0;
+    x[7]  = r1;
+
+    mdct_butterfly_8_soa(x);
+    mdct_butterfly_8_soa(x+8);
+}
+
+/** 32 point butterfly on rows 0..31 of x */
+static void
+mdct_butterfly_32_soa(FLOAT *x)
+{
+    const V pi1_8 = V_SET1(AFT_PI1_8);
+    const V pi2_8 = V_SET1(AFT_PI2_8);
+    const V pi3_8 = V_SET1(AFT_PI3_8);
+    V v[32];
+    V r0, r1;
+    int i;
+
+    for (i = 0; i < 32; i++)
+        v[i] = ld_row(x, i);
+
+    r0    = V_SUB(v[30], v[14]);
+    r1    = V_SUB(v[31], v[15]);
+    v[30] = V_ADD(v[30], v[14]);
+    v[31] = V_ADD(v[31], v[15]);
+    v[14] = r0;
+    v[15] = r1;
+
+    r0    = V_SUB(v[28], v[12]);
+    r1    = V_SUB(v[29], v[13]);
+    v[28] = V_ADD(v[28], v[12]);
+    v[29] = V_ADD(v[29], v[13]);
+    v[12] = V_SUB(V_MUL(r0, pi1_8), V_MUL(r1, pi3_8));
+    v[13] = V_ADD(V_MUL(r0, pi3_8), V_MUL(r1, pi1_8));
+
+    r0    = V_SUB(v[26], v[10]);
+    r1    = V_SUB(v[27], v[11]);
+    v[26] = V_ADD(v[26], v[10]);
+    v[27] = V_ADD(v[27], v[11]);
+    v[10] = V_MUL(V_SUB(r0, r1), pi2_8);
+    v[11] = V_MUL(V_ADD(r0, r1), pi2_8);
+
+    r0    = V_SUB(v[24], v[8]);
+    r1    = V_SUB(v[25], v[9]);
+    v[24] = V_ADD(v[24], v[8]);
+    v[25] = V_ADD(v[25], v[9]);
+    v[8]  = V_SUB(V_MUL(r0, pi3_8), V_MUL(r1, pi1_8));
+    v[9]  = V_ADD(V_MUL(r1, pi3_8), V_MUL(r0, pi1_8));
+
+    r0    = V_SUB(v[22], v[6]);
+    r1    = V_SUB(v[7], v[23]);
+    v[22] = V_ADD(v[22], v[6]);
+    v[23] = V_ADD(v[23], v[7]);
+    v[6]  = r1;
+    v[7]  = r0;
+
+    r0    = V_SUB(v[4], v[20]);
+    r1    = V_SUB(v[5], v[21]);
+    v[20] = V_ADD(v[20], v[4]);
+    v[21] = V_ADD(v[21], v[5]);
+    v[4]  = V_ADD(V_MUL(r1, pi1_8), V_MUL(r0, pi3_8));
+    v[5]  = V_SUB(V_MUL(r1, pi3_8), V_MUL(r0, pi1_8));
+
+    r0    = V_SUB(v[2], v[18]);
+    r1    = V_SUB(v[3], v[19]);
+    v[18] = V_ADD(v[18], v[2]);
+    v[19] = V_ADD(v[19], v[3]);
+    v[2]  = V_MUL(V_ADD(r1, r0), pi2_8);
+    v[3]  = V_MUL(V_SUB(r1, r0), pi2_8);
+
+    r0    = V_SUB(v[0], v[16]);
+    r1    = V_SUB(v[1], v[17]);
+    v[16] = V_ADD(v[16], v[0]);
+    v[17] = V_ADD(v[17], v[1]);
+    v[0]  = V_ADD(V_MUL(r1, pi3_8), V_MUL(r0, pi1_8));
+    v[1]  = V_SUB(V_MUL(r1, pi1_8), V_MUL(r0, pi3_8));
+
+    mdct_butterfly_16_soa(v);
+    mdct_butterfly_16_soa(v+16);
+
+    for (i = 0; i < 32; i++)
+        st_row(x, i, v[i]);
+}
+
+/**
+ * Generic butterfly stage on rows.  The first stage is the same with a
+ * trigint of 4.
+ */
+static void
+mdct_butterfly_generic_soa(const FLOAT *trig, FLOAT *x, int points, int trigint)
+{
+    FLOAT *x1 = ROW(x,  points     - 8);
+    FLOAT *x2 = ROW(x, (points>>1) - 8);
+    int i;
+
+    do {
+        for (i = 6; i >= 0; i -= 2) {
+            V a0 = ld_row(x1, i  );
+            V a1 = ld_row(x1, i+1);
+            V b0 = ld_row(x2, i  );
+            V b1 = ld_row(x2, i+1);
+            st_row(x1, i  , V_ADD(a0, b0));
+            st_row(x1, i+1, V_ADD(a1, b1));
+            rotate_rows(x2, i, V_SUB(a0, b0), V_SUB(a1, b1), trig);
+            trig += trigint;
+        }
+        x1 = ROW(x1, -8);
+        x2 = ROW(x2, -8);
+    } while (x2 >= x);
+}
+
+static void
+mdct_butterflies_soa(MDCTContext *mdct, FLOAT *x, int points)
+{
+    FLOAT *trig = mdct->trig;
+    int stages = mdct->log2n-5;
+    int i, j;
+
+    if (--stages > 0)
+        mdct_butterfly_generic_soa(trig, x, points, 4);
+
+    for (i = 1; --stages > 0; i++)
+        for (j = 0; j < (1<<i); j++)
+            mdct_butterfly_generic_soa(trig, ROW(x, (points>>i)*j), points>>i, 4<<i);
+
+    for (j = 0; j < points; j += 32)
+        mdct_butterfly_32_soa(ROW(x, j));
+}
+
+static void
+mdct_bitreverse_soa(MDCTContext *mdct, FLOAT *w)
+{
+    const V half = V_SET1(0.5);
+    int n = mdct->n;
+    int *bit = mdct->bitrev;
+    FLOAT *x = ROW(w, n>>1);
+    FLOAT *trig = mdct->trig+n;
+    int w0 = 0;
+    int w1 = n>>1;
+
+    do {
+        V x0r, x0i, x1r, x1i, r0, r1, r2, r3, t0, t1;
+
+        w1 -= 4;
+
+        x0r = ld_row(x, bit[0]);
+        x0i = ld_row(x, bit[0]+1);
+        x1r = ld_row(x, bit[1]);
+        x1i = ld_row(x, bit[1]+1);
+        t0  = V_SET1(trig[0]);
+        t1  = V_SET1(trig[1]);
+        r0  = V_SUB(x0i, x1i);
+        r1  = V_ADD(x0r, x1r);
+        r2  = V_ADD(V_MUL(r1, t0), V_MUL(r0, t1));
+        r3  = V_SUB(V_MUL(r1, t1), V_MUL(r0, t0));
+        r0  = V_MUL(V_ADD(x0i, x1i), half);
+        r1  = V_MUL(V_SUB(x0r, x1r), half);
+        st_row(w, w0  , V_ADD(r0, r2));
+        st_row(w, w1+2, V_SUB(r0, r2));
+        st_row(w, w0+1, V_ADD(r1, r3));
+        st_row(w, w1+3, V_SUB(r3, r1));
+
+        x0r = ld_row(x, bit[2]);
+        x0i = ld_row(x, bit[2]+1);
+        x1r = ld_row(x, bit[3]);
+        x1i = ld_row(x, bit[3]+1);
+        t0  = V_SET1(trig[2]);
+        t1  = V_SET1(trig[3]);
+        r0  = V_SUB(x0i, x1i);
+        r1  = V_ADD(x0r, x1r);
+        r2  = V_ADD(V_MUL(r1, t0), V_MUL(r0, t1));
+        r3  = V_SUB(V_MUL(r1, t1), V_MUL(r0, t0));
+        r0  = V_MUL(V_ADD(x0i, x1i), half);
+        r1  = V_MUL(V_SUB(x0r, x1r), half);
+        st_row(w, w0+2, V_ADD(r0, r2));
+        st_row(w, w1  , V_SUB(r0, r2));
+        st_row(w, w0+3, V_ADD(r1, r3));
+        st_row(w, w1+1, V_SUB(r3, r1));
+
+        trig += 4;
+        bit  += 4;
+        w0   += 4;
+    } while (w0 < w1);
+}
+
+/**
+ * Post-rotation of LANES output rows from i up into front, and of the
+ * mirrored rows at the back of the output into back, in ascending order.
+ */
+static inline void
+mdct_rotate_soa(MDCTContext *mdct, const FLOAT *w, int i, V *front, V *back)
+{
+    const V scale = V_SET1(mdct->scale);
+    const FLOAT *trig = mdct->trig + (mdct->n>>1) + 2*i;
+    int j;
+
+    for (j = 0; j < LANES; j++) {
+        V v0 = ld_row(w, 2*(i+j));
+        V v1 = ld_row(w, 2*(i+j)+1);
+        V t0 = V_SET1(trig[2*j]);
+        V t1 = V_SET1(trig[2*j+1]);
+        front[j]         = V_MUL(V_ADD(V_MUL(v0, t0), V_MUL(v1, t1)), scale);
+        back[LANES-1-j]  = V_MUL(V_SUB(V_MUL(v0, t1), V_MUL(v1, t0)), scale);
+    }
+}
+
+/** aligns the scratch buffer for whole-row loads and stores */
+static inline FLOAT *
+soa_buffer(MDCTThreadContext *tmdct)
+{
+    uintptr_t align = LANES * sizeof(FLOAT) - 1;
+    return (FLOAT *)(((uintptr_t)tmdct->batch_buffer + align) & ~align);
+}
+
+/** scratch space the row transforms need, in FLOATs */
+#define SOA_BUFFER_SIZE(n) (((n)+2) * LANES + LANES)
+
+/** transforms up to LANES windows, one per lane */
+static void
+mdct_lanes_soa(MDCTThreadContext *tmdct, FLOAT **out, FLOAT **in, int count,
+               int ncoefs)
+{
+    MDCTContext *mdct = tmdct->mdct;
+    int n = mdct->n;
+    int n2 = n>>1;
+    int n4 = n>>2;
+    FLOAT *w = soa_buffer(tmdct);
+    SoaInput src;
+    V front[LANES], back[LANES];
+    int i, q, l;
+
+    // unused lanes just repeat the first window
+    for (q = 0; q < 4; q++) {
+        for (l = 0; l < LANES; l++) {
+            src.x[q][l] = in[l < count ? l : 0] + q*n4;
+            src.w[q][l] = mdct->window + q*n4;
+        }
+        src.neg[q] = V_ZERO;
+    }
+
+    mdct_pretwiddle_soa(mdct, ROW(w, n2), &src);
+    mdct_butterflies_soa(mdct, ROW(w, n2), n2);
+    mdct_bitreverse_soa(mdct, w);
+
+    // blocks above the coded bandwidth are skipped
+    for (i = 0; i < n4; i += LANES) {
+        int front_needed = i < ncoefs;
+        int back_needed = n2-LANES-i < ncoefs;
+
+        if (!front_needed && !back_needed)
+            continue;
+        mdct_rotate_soa(mdct, w, i, front, back);
+        if (front_needed)
+            store_rows(out, count, i, front);
+        if (back_needed)
+            store_rows(out, count, n2-LANES-i, back);
+    }
+}
+
+static void
+mdct_batch_soa(MDCTThreadContext *tmdct, FLOAT **out, FLOAT **in, int count,
+               int ncoefs)
+{
+    int i;
+
+    for (i = 0; i < count; i += LANES)
+        mdct_lanes_soa(tmdct, out+i, in+i, MIN(count-i, LANES), ncoefs);
+}
+
+#endif /* MDCT_COMMON_PD_H */
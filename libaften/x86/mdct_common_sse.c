@@ -144,31 +144,46 @@ mdct_butterflies_sse(MDCTContext *mdct, FLOAT *x, int points)
         mdct->mdct_butterfly_32(x+j);
 }
 
+/** loads 4 input samples at p, applies the window and the sign mask */
+static inline __m128
+load_windowed(const FLOAT *p, const FLOAT *w, __m128 neg)
+{
+    return _mm_xor_ps(_mm_mul_ps(_mm_load_ps(p), _mm_load_ps(w)), neg);
+}
+
+/**
+ * Pre-twiddles the input into w2.  Quarter q of the transform input starts
+ * at x[q], its window at xw[q], and it is negated if bit q of neg is set.
+ * Each loop reads every quarter in one direction only.
+ */
 static void
-mdct_sse(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
+mdct_pretwiddle_sse(MDCTContext *mdct, FLOAT *w2, const FLOAT *const *x,
+                    const FLOAT *const *xw, int neg)
 {
-    MDCTContext *mdct = tmdct->mdct;
     int n = mdct->n;
     int n2 = n>>1;
     int n4 = n>>2;
     int n8 = n>>3;
-    FLOAT *w = tmdct->buffer;
-    FLOAT *w2 = w+n2;
-    float *x0    = in+n2+n4-8;
-    float *x1    = in+n2+n4;
-    float *T     = mdct->trig_forward;
-
+    const float *x0 = x[2]+n4-8;
+    const float *w0 = xw[2]+n4-8;
+    const float *x1 = x[3];
+    const float *w1 = xw[3];
+    const float *T  = mdct->trig_forward;
+    __m128 ng[4];
     int i, j;
 
+    for (i = 0; i < 4; i++)
+        ng[i] = (neg >> i) & 1 ? PCS_RRRR.v : _mm_setzero_ps();
+
 #ifdef __INTEL_COMPILER
 #pragma warning(disable : 592)
 #endif
     for (i = 0, j = n2-2; i < n8; i += 4, j -= 4) {
         __m128  XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7;
-        XMM0     = _mm_load_ps(x0    + 4);
-        XMM4     = _mm_load_ps(x0       );
-        XMM1     = _mm_load_ps(x0+i*4+ 8);
-        XMM5     = _mm_load_ps(x0+i*4+12);
+        XMM0     = load_windowed(x0+4, w0+4, ng[2]);
+        XMM4     = load_windowed(x0  , w0  , ng[2]);
+        XMM1     = load_windowed(x1  , w1  , ng[3]);
+        XMM5     = load_windowed(x1+4, w1+4, ng[3]);
         XMM2     = _mm_load_ps(T   );
         XMM3     = _mm_load_ps(T+ 4);
         XMM6     = _mm_load_ps(T+ 8);
@@ -194,18 +209,23 @@ mdct_sse(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
         _mm_storel_pi((__m64*)(w2+i+2), XMM4);
         _mm_storeh_pi((__m64*)(w2+j-2), XMM4);
         x0  -= 8;
+        w0  -= 8;
+        x1  += 8;
+        w1  += 8;
         T   += 16;
     }
 
-    x0   = in;
-    x1   = in+n2-8;
+    x0   = x[0];
+    w0   = xw[0];
+    x1   = x[1]+n4-8;
+    w1   = xw[1]+n4-8;
 
     for (; i < n4; i += 4, j -= 4) {
         __m128  XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7;
-        XMM1     = _mm_load_ps(x1+4);
-        XMM5     = _mm_load_ps(x1  );
-        XMM0     = _mm_load_ps(x0  );
-        XMM4     = _mm_load_ps(x0+4);
+        XMM1     = load_windowed(x1+4, w1+4, ng[1]);
+        XMM5     = load_windowed(x1  , w1  , ng[1]);
+        XMM0     = load_windowed(x0  , w0  , ng[0]);
+        XMM4     = load_windowed(x0+4, w0+4, ng[0]);
         XMM2     = _mm_load_ps(T   );
         XMM3     = _mm_load_ps(T+ 4);
         XMM6     = _mm_load_ps(T+ 8);
@@ -231,14 +251,62 @@ mdct_sse(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
         _mm_storel_pi((__m64*)(w2+i+2), XMM4);
         _mm_storeh_pi((__m64*)(w2+j-2), XMM4);
         x0  += 8;
+        w0  += 8;
         x1  -= 8;
+        w1  -= 8;
         T   += 16;
     }
 #ifdef __INTEL_COMPILER
 #pragma warning(default : 592)
 #endif
+}
 
-    mdct_butterflies_sse(mdct, w2, n2);
+/**
+ * One step of the post-rotation: 4 coefficients from the front and,
+ * in *back, the 4 mirrored ones from the back of the output.
+ */
+static inline void
+mdct_rotate_sse(const FLOAT *T, const FLOAT *w, __m128 *back, __m128 *front)
+{
+    __m128  XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7;
+    XMM0     = _mm_load_ps(w+4);
+    XMM4     = _mm_load_ps(w  );
+    XMM2     = XMM0;
+    XMM1     = _mm_load_ps(T   );
+    XMM3     = _mm_load_ps(T+ 4);
+    XMM6     = _mm_load_ps(T+ 8);
+    XMM7     = _mm_load_ps(T+12);
+    XMM0     = _mm_shuffle_ps(XMM0, XMM4,_MM_SHUFFLE(0,2,0,2));
+    XMM2     = _mm_shuffle_ps(XMM2, XMM4,_MM_SHUFFLE(1,3,1,3));
+    XMM4     = XMM0;
+    XMM5     = XMM2;
+    XMM0     = _mm_mul_ps(XMM0, XMM1);
+    XMM2     = _mm_mul_ps(XMM2, XMM3);
+    XMM4     = _mm_shuffle_ps(XMM4, XMM4, _MM_SHUFFLE(0,1,2,3));
+    XMM5     = _mm_shuffle_ps(XMM5, XMM5, _MM_SHUFFLE(0,1,2,3));
+    XMM4     = _mm_mul_ps(XMM4, XMM6);
+    XMM5     = _mm_mul_ps(XMM5, XMM7);
+    *back    = _mm_sub_ps(XMM0, XMM2);
+    *front   = _mm_add_ps(XMM4, XMM5);
+}
+
+static void
+mdct_sse(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
+{
+    MDCTContext *mdct = tmdct->mdct;
+    int n = mdct->n;
+    int n2 = n>>1;
+    int n4 = n>>2;
+    FLOAT *w = tmdct->buffer;
+    FLOAT *win = mdct->window;
+    const FLOAT *x[4]  = { in, in+n4, in+n2, in+n2+n4 };
+    const FLOAT *xw[4] = { win, win+n4, win+n2, win+n2+n4 };
+    float *x0;
+    float *T;
+    int i;
+
+    mdct_pretwiddle_sse(mdct, w+n2, x, xw, 0);
+    mdct_butterflies_sse(mdct, w+n2, n2);
     mdct->mdct_bitreverse(mdct, w);
 
     /* roatate + window */
@@ -247,27 +315,9 @@ mdct_sse(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
     x0    =out +n2;
 
     for (i = 0; i < n4; i += 4) {
-        __m128  XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7;
+        __m128  XMM0, XMM4;
         x0  -= 4;
-        XMM0     = _mm_load_ps(w+4);
-        XMM4     = _mm_load_ps(w  );
-        XMM2     = XMM0;
-        XMM1     = _mm_load_ps(T   );
-        XMM3     = _mm_load_ps(T+ 4);
-        XMM6     = _mm_load_ps(T+ 8);
-        XMM7     = _mm_load_ps(T+12);
-        XMM0     = _mm_shuffle_ps(XMM0, XMM4,_MM_SHUFFLE(0,2,0,2));
-        XMM2     = _mm_shuffle_ps(XMM2, XMM4,_MM_SHUFFLE(1,3,1,3));
-        XMM4     = XMM0;
-        XMM5     = XMM2;
-        XMM0     = _mm_mul_ps(XMM0, XMM1);
-        XMM2     = _mm_mul_ps(XMM2, XMM3);
-        XMM4     = _mm_shuffle_ps(XMM4, XMM4, _MM_SHUFFLE(0,1,2,3));
-        XMM5     = _mm_shuffle_ps(XMM5, XMM5, _MM_SHUFFLE(0,1,2,3));
-        XMM4     = _mm_mul_ps(XMM4, XMM6);
-        XMM5     = _mm_mul_ps(XMM5, XMM7);
-        XMM0     = _mm_sub_ps(XMM0, XMM2);
-        XMM4     = _mm_add_ps(XMM4, XMM5);
+        mdct_rotate_sse(T, w, &XMM0, &XMM4);
         _mm_store_ps(x0    , XMM0);
         _mm_store_ps(out +i, XMM4);
         w   += 8;
@@ -276,67 +326,92 @@ mdct_sse(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
 }
 
 void
-mdct_512_sse(A52ThreadContext *tctx, FLOAT *out, FLOAT *in)
+mdct_512_sse(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
 {
-    mdct_sse(&tctx->mdct_tctx_512, out, in);
+    mdct_sse(tmdct, out, in);
 }
 
+/**
+ * Both short block transforms in one go, see mdct_256 in mdct.c.  The
+ * rotations of the two transforms run side by side, so their coefficients
+ * are interleaved in registers.
+ */
 void
-mdct_256_sse(A52ThreadContext *tctx, FLOAT *out, FLOAT *in)
+mdct_256_sse(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
 {
-    FLOAT *coef_a, *coef_b, *xx;
-    int i, j;
-
-    coef_a = in;
-    coef_b = &in[128];
-    xx = tctx->mdct_tctx_256.buffer1;
-
-    memcpy(xx, in+64, 192 * sizeof(FLOAT));
-    xx += 192;
-    for (i = 0; i < 64; i += 4) {
-        __m128 XMM0 = _mm_load_ps(in + i);
-        XMM0 = _mm_xor_ps(XMM0, PCS_RRRR.v);
-        _mm_store_ps(xx + i, XMM0);
+    MDCTContext *mdct = tmdct->mdct;
+    FLOAT *wa = tmdct->buffer;
+    FLOAT *wb = tmdct->buffer1;
+    const FLOAT *win = a52_window;
+    const FLOAT *xa[4]  = { in+64,  in+128,  in+192,  in      };
+    const FLOAT *xwa[4] = { win+64, win+128, win+192, win     };
+    const FLOAT *xb[4]  = { in+448, in+256,  in+320,  in+384  };
+    const FLOAT *xwb[4] = { win+448, win+256, win+320, win+384 };
+    float *T, *x0;
+    int i;
+
+    mdct_pretwiddle_sse(mdct, wa+128, xa, xwa, 0x8);
+    mdct_pretwiddle_sse(mdct, wb+128, xb, xwb, 0x9);
+    mdct_butterflies_sse(mdct, wa+128, 128);
+    mdct_butterflies_sse(mdct, wb+128, 128);
+    mdct->mdct_bitreverse(mdct, wa);
+    mdct->mdct_bitreverse(mdct, wb);
+
+    T    = mdct->trig_forward+256;
+    x0   = out+256;
+
+    for (i = 0; i < 128; i += 8) {
+        __m128  XMM0, XMM1, XMM2, XMM3;
+        x0  -= 8;
+        mdct_rotate_sse(T, wa, &XMM0, &XMM2);
+        mdct_rotate_sse(T, wb, &XMM1, &XMM3);
+        _mm_store_ps(x0     , _mm_unpacklo_ps(XMM0, XMM1));
+        _mm_store_ps(x0   +4, _mm_unpackhi_ps(XMM0, XMM1));
+        _mm_store_ps(out+i  , _mm_unpacklo_ps(XMM2, XMM3));
+        _mm_store_ps(out+i+4, _mm_unpackhi_ps(XMM2, XMM3));
+        wa  += 8;
+        wb  += 8;
+        T   += 16;
     }
-    xx -= 192;
-
-    mdct_sse(&tctx->mdct_tctx_256, coef_a, xx);
+}
 
-    in += 256 + 192;
-    for (i = 0; i < 64; i += 4) {
-        __m128 XMM0 = _mm_load_ps(in + i);
-        XMM0 = _mm_xor_ps(XMM0, PCS_RRRR.v);
-        _mm_store_ps(xx + i, XMM0);
-    }
-    in -= 256 + 192;
-
-    memcpy(xx+64, in+256, 128 * sizeof(FLOAT));
-    xx += 192;
-    in += 256 + 128;
-    for (i = 0; i < 64; i += 4) {
-        __m128 XMM0 = _mm_load_ps(in + i);
-        XMM0 = _mm_xor_ps(XMM0, PCS_RRRR.v);
-        _mm_store_ps(xx + i, XMM0);
-    }
-    xx -= 192;
-    in -= 256 + 128;
-
-    mdct_sse(&tctx->mdct_tctx_256, coef_b, xx);
-
-    for (i = 0, j = 0; i < 128; i += 4, j += 8) {
-        __m128 XMM0 = _mm_load_ps(coef_a + i);
-        __m128 XMM1 = _mm_load_ps(coef_b + i);
-        __m128 XMM2 = _mm_unpacklo_ps(XMM0, XMM1);
-        __m128 XMM3 = _mm_unpackhi_ps(XMM0, XMM1);
-        _mm_store_ps(out + j  , XMM2);
-        _mm_store_ps(out + j+4, XMM3);
+static void
+mdct_direct_sse(MDCTContext *mdct, FLOAT *out, FLOAT *in, int ncoefs)
+{
+    FLOAT *T = mdct->direct_trig;
+    int n = mdct->n;
+    __m128 XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7;
+    ALIGN16(FLOAT) sum[8];
+    int i, k;
+
+    XMM0 = XMM1 = XMM2 = XMM3 = XMM4 = XMM5 = XMM6 = XMM7 = _mm_setzero_ps();
+
+    // every input vector is loaded once for all 8 coefficients
+    for (i = 0; i < n; i += 4) {
+        __m128 X = _mm_load_ps(in + i);
+        XMM0 = _mm_add_ps(XMM0, _mm_mul_ps(X, _mm_load_ps(T +     i)));
+        XMM1 = _mm_add_ps(XMM1, _mm_mul_ps(X, _mm_load_ps(T +   n+i)));
+        XMM2 = _mm_add_ps(XMM2, _mm_mul_ps(X, _mm_load_ps(T + 2*n+i)));
+        XMM3 = _mm_add_ps(XMM3, _mm_mul_ps(X, _mm_load_ps(T + 3*n+i)));
+        XMM4 = _mm_add_ps(XMM4, _mm_mul_ps(X, _mm_load_ps(T + 4*n+i)));
+        XMM5 = _mm_add_ps(XMM5, _mm_mul_ps(X, _mm_load_ps(T + 5*n+i)));
+        XMM6 = _mm_add_ps(XMM6, _mm_mul_ps(X, _mm_load_ps(T + 6*n+i)));
+        XMM7 = _mm_add_ps(XMM7, _mm_mul_ps(X, _mm_load_ps(T + 7*n+i)));
     }
+
+    _MM_TRANSPOSE4_PS(XMM0, XMM1, XMM2, XMM3);
+    _MM_TRANSPOSE4_PS(XMM4, XMM5, XMM6, XMM7);
+    _mm_store_ps(sum  , _mm_add_ps(_mm_add_ps(XMM0, XMM1), _mm_add_ps(XMM2, XMM3)));
+    _mm_store_ps(sum+4, _mm_add_ps(_mm_add_ps(XMM4, XMM5), _mm_add_ps(XMM6, XMM7)));
+    for (k = 0; k < ncoefs; k++)
+        out[k] = sum[k];
 }
 
 void
 mdct_ctx_init_sse(MDCTContext *mdct, int n)
 {
     mdct_ctx_init(mdct, n);
+    mdct->mdct_direct = mdct_direct_sse;
     {
         __m128  pscalem  = _mm_set_ps1(mdct->scale);
         float *T, *S;
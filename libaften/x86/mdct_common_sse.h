@@ -47,10 +47,14 @@
 
 void mdct_butterfly_16_sse(FLOAT *x);
 
-void mdct_512_sse(struct A52ThreadContext *tctx, FLOAT *out, FLOAT *in);
+void mdct_512_sse(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in);
 
-void mdct_256_sse(struct A52ThreadContext *tctx, FLOAT *out, FLOAT *in);
+void mdct_256_sse(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in);
 
 void mdct_ctx_init_sse(MDCTContext *mdct, int n);
 
+void mdct_butterfly_32_sse3(FLOAT *x);
+
+void mdct_butterfly_generic_sse3(MDCTContext *mdct, FLOAT *x, int points, int trigint);
+
 #endif /* MDCT_COMMON_SSE_H */
@@ -0,0 +1,128 @@
+/**
+ * Aften: A/52 audio encoder
+ *
+ * This file is derived from libvorbis
+ * Copyright (c) 2002, Xiph.org Foundation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the Xiph.org Foundation nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file x86/mdct_sse2_pd.c
+ * Double precision MDCT, optimized for the SSE2 instruction set
+ *
+ * Two windows are transformed at once, see mdct_common_pd.h.  The two
+ * short block transforms make such a pair, and since their coefficients
+ * are interleaved in the output, each row is stored as it is.
+ */
+
+#include "a52enc.h"
+#include "x86/simd_support.h"
+
+#ifdef CONFIG_DOUBLE
+
+#define V           __m128d
+#define LANES       2
+#define V_ADD       _mm_add_pd
+#define V_SUB       _mm_sub_pd
+#define V_MUL       _mm_mul_pd
+#define V_XOR       _mm_xor_pd
+#define V_SET1      _mm_set1_pd
+#define V_LOAD      _mm_load_pd
+#define V_STORE     _mm_store_pd
+#define V_ZERO      _mm_setzero_pd()
+
+/** sample i of the window in each lane */
+static inline V
+load_lanes(const FLOAT *const *p, int i)
+{
+    return _mm_loadh_pd(_mm_load_sd(p[0]+i), p[1]+i);
+}
+
+/** stores rows i and i+1, given in r[0..1], to the count output windows */
+static inline void
+store_rows(FLOAT **out, int count, int i, V *r)
+{
+    _mm_storeu_pd(out[0]+i, _mm_unpacklo_pd(r[0], r[1]));
+    if (count > 1)
+        _mm_storeu_pd(out[1]+i, _mm_unpackhi_pd(r[0], r[1]));
+}
+
+#include "mdct_common_pd.h"
+
+/**
+ * Both short block transforms, see mdct_256 in mdct.c.  Lane 0 takes the
+ * first, lane 1 the second transform.
+ */
+static void
+mdct_256_sse2_pd(MDCTThreadContext *tmdct, FLOAT *out, FLOAT *in)
+{
+    MDCTContext *mdct = tmdct->mdct;
+    FLOAT *w = soa_buffer(tmdct);
+    const FLOAT *win = a52_window;
+    static const int offset[4][2] = { {  64, 448 }, { 128, 256 },
+                                      { 192, 320 }, {   0, 384 } };
+    SoaInput src;
+    V front[LANES], back[LANES];
+    int i, q, l;
+
+    for (q = 0; q < 4; q++) {
+        for (l = 0; l < 2; l++) {
+            src.x[q][l] = in  + offset[q][l];
+            src.w[q][l] = win + offset[q][l];
+        }
+    }
+    src.neg[0] = _mm_set_pd(-0.0, 0.0);
+    src.neg[1] = V_ZERO;
+    src.neg[2] = V_ZERO;
+    src.neg[3] = V_SET1(-0.0);
+
+    mdct_pretwiddle_soa(mdct, ROW(w, 128), &src);
+    mdct_butterflies_soa(mdct, ROW(w, 128), 128);
+    mdct_bitreverse_soa(mdct, w);
+
+    for (i = 0; i < 64; i += LANES) {
+        mdct_rotate_soa(mdct, w, i, front, back);
+        _mm_storeu_pd(out+2*i        , front[0]);
+        _mm_storeu_pd(out+2*i+2      , front[1]);
+        _mm_storeu_pd(out+2*(126-i)  , back[0]);
+        _mm_storeu_pd(out+2*(126-i)+2, back[1]);
+    }
+}
+
+void
+mdct_init_sse2_pd(A52Context *ctx)
+{
+    ctx->mdct_ctx_512.mdct_batch = mdct_batch_soa;
+    ctx->mdct_ctx_512.batch_buffer_size = SOA_BUFFER_SIZE(512);
+
+    ctx->mdct_ctx_256.mdct = mdct_256_sse2_pd;
+    ctx->mdct_ctx_256.batch_buffer_size = SOA_BUFFER_SIZE(256);
+}
+
+#endif /* CONFIG_DOUBLE */
@@ -50,7 +50,7 @@ static const union __m128f PFV_0P5 = {{0.5f, 0.5f, 0.5f, 0.5f}};
 
 
 /** 32 point butterfly */
-static void
+void
 mdct_butterfly_32_sse3(FLOAT *x) {
     static _MM_ALIGN16 const float PFV0[4] = { -AFT_PI3_8, -AFT_PI1_8,
                                                -AFT_PI2_8, -AFT_PI2_8 };
@@ -171,7 +171,7 @@ mdct_butterfly_first_sse3(FLOAT *trig, FLOAT *x, int points)
 }
 
 /** N/stage point generic N stage butterfly */
-static void
+void
 mdct_butterfly_generic_sse3(MDCTContext *mdct, FLOAT *x, int points, int trigint)
 {
     float *T;
@@ -71,6 +71,10 @@ union __m128iui {
 
 #undef _mm_lddqu_ps
 #define _mm_lddqu_ps(x) _mm_castsi128_ps(_mm_lddqu_si128((__m128i*)(x)))
+
+#if defined(USE_AVX) || defined(USE_AVX2) || defined(USE_AVX512BW)
+#include <immintrin.h>
+#endif /* USE_AVX || USE_AVX2 || USE_AVX512BW */
 #endif /* USE_SSE3 */
 #endif /* USE_SSE2 */
 